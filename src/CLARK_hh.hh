@@ -34,13 +34,20 @@
 #include <vector>
 #include <iostream>
 #include <cstdlib>
+#include <cmath>
 #include "./dataType.hh"
 #include "./HashTableStorage_hh.hh"
+#include "./contiguousToSpaced_hh.hh"
 #include "./spacedKmer.hh"
 #include "./FileHandlerQ.hh"
 #include "./FileHandlerA.hh"
 #include "./FileHandler.hh"
 #include "./HashTop.hh"
+#include "./readEncoder.hh"
+#include "./resultCache.hh"
+#include "./syncmerFilter.hh"
+#include "./motherIndex.hh"
+#include "./buildCheckpoint.hh"
 #include "FILEex.h"
 
 #define MAXRSIZE	10000
@@ -51,6 +58,61 @@
 #define MINGMSP		0.06
 #define	MXNMLEN		1000
 
+// Scoring of the objects in the mmap'ed modes
+#define SCORE_DEFAULT		1	// Default mode, highest score with early termination
+#define SCORE_EXPRESS		2	// Express mode, first hit of non-overlapping k-mers
+#define SCORE_EXPRESSLIGHT	3	// Express mode with the light database, first hit
+#define EARLYSTEP		16	// Full mode, positions between two checks for early termination
+#define CASCADE_MINHITS		2	// Cascade mode, minimum of hits of the best target in the sampled vote
+#define CASCADE_MINCONF		0.9	// Cascade mode, minimum confidence score of the sampled vote
+#define STRIDE_MINVOTES		8	// Adaptive stride, hits expected in the sampled vote
+#define STRIDE_MINSAMPLES	4	// Adaptive stride, minimum of k-mers in the sampled vote
+#define STRIDE_MINDENSITY	0.05	// Adaptive stride, lower bound of the hit density
+#define DUSTWINDOW		64	// Pre-filter, length of the windows scored for low complexity
+#define NBRANKS			6	// Ranks of the lineage (species, genus, family, order, class, phylum)
+#define MERGEPARTS		64	// Merge of partial builds, files of the specific k-mers by range of buckets
+
+//	STRUCT
+//	Name: mergedKmer
+//	Implementation notes: Specific k-mer of a merged database and its label, ordered as in the database (by
+//	bucket, then by key).
+//
+struct mergedKmer
+{
+	uint64_t	Kmer;
+	ILBL		Label;
+	bool operator<(const mergedKmer& _o) const
+	{	return Kmer % HTSIZE < _o.Kmer % HTSIZE || (Kmer % HTSIZE == _o.Kmer % HTSIZE && Kmer < _o.Kmer);	}
+};
+
+//	STRUCT
+//	Name: dbOptions
+//	Implementation notes: Options of the database given to CLARK at its construction (placement in memory,
+//	format and way of building), all off by default.
+//
+struct dbOptions
+{
+	dbOptions(): numaPolicy(NUMA_NONE), pages(PAGES_DEFAULT), sharedMemory(false), dbFormat(CDB_LEGACY), syncmer(0),
+		incremental(false), partial(false), indexes(NULL), lineage(NULL), subset(NULL), subsetFolder(NULL),
+		dedup(false), checkpoint(0), resume(false)
+	{}
+
+	size_t		numaPolicy;	// Placement of the database (numaPolicy)
+	size_t		pages;		// Pages of the database (memoryArena)
+	bool		sharedMemory;	// Database in shared memory (sharedSegment)
+	size_t		dbFormat;	// Format of the container (CDB_LEGACY for the files of the tables)
+	size_t		syncmer;	// Length of the s-mers of the open syncmers (0: all k-mers)
+	bool		incremental;	// Database updated from the index of the previous build
+	bool		partial;	// Mother table of the targets only, saved to be merged
+	const char*	indexes;	// Mother tables of partial builds to merge (file listing them)
+	const char*	lineage;	// Lineage of the labels for a multi-rank database
+	const char*	subset;		// Targets of the database to extract the database from
+	const char*	subsetFolder;	// Directory of that database
+	bool		dedup;		// Exact duplicates of a target of the same label skipped
+	size_t		checkpoint;	// Minutes between two checkpoints of the build (0: none)
+	bool		resume;		// Build resumed from its last checkpoint
+};
+
 template <typename HKMERr>
 class CLARK
 {
@@ -98,7 +160,7 @@ class CLARK
 		std::vector< ITYPE>                     m_objectsNorm;
 		bool					m_isFastaFile;
 
-		// choice 0: Full, 1:Default, 2: Fast, 3: Spectrum
+		// choice 0: Full, 1:Default, 2: Fast, 3: Spectrum, 4: Cascade
 		size_t					m_mode; 
 		std::vector< std::vector<ILBL> >        m_targetsBest;
 		std::vector< std::vector<size_t> > 	m_seqSNames;
@@ -134,6 +196,29 @@ class CLARK
 		bool 					m_spectrumAnalysis;
 		bool					m_isPaired;
 		bool					m_isExtended;
+		size_t					m_confidenceBins;	// Full mode, early termination if > 0
+		size_t					m_stride;		// Stride of the sampled vote, adaptive if 0
+		size_t					m_dustThreshold;	// Pre-filter, masks windows with a higher DUST score if > 0
+		size_t					m_minQuality;		// Pre-filter, masks fastq bases with a lower quality if > 0
+		std::vector<uint64_t>			m_skippedKmers;		// Pre-filter, k-mers not queried (per thread)
+		resultCache				m_cache;		// Results of objects already scored
+		const size_t				m_numaPolicy;		// Placement of the database (numaPolicy)
+		const size_t				m_pages;		// Pages of the database (memoryArena)
+		const bool				m_sharedMemory;		// Database in shared memory (sharedSegment)
+		const bool				m_container;		// Database in one file (dbContainer)
+		const size_t				m_dbFormat;		// Format of the container built (CDB_RAW or CDB_PACKED)
+		const syncmerFilter			m_syncmer;		// K-mers kept in the database and in the objects
+		const bool				m_incremental;		// Database updated from the index of the previous build
+		const bool				m_partial;		// Mother table of the targets only, saved to be merged
+		const bool				m_dedup;		// Exact duplicates of a target of the same label skipped
+		const size_t				m_checkpoint;		// Minutes between two checkpoints of the build (0: none)
+		const bool				m_resume;		// Build resumed from its last checkpoint
+		const std::string			m_lineageFile;		// Multi-rank database, lineage of the labels if not empty
+		std::vector<uint8_t>			m_ranks;		// Multi-rank database, rank of each label
+		std::vector<ILBL>			m_parents;		// Multi-rank database, parent of each label (NOLABEL if none)
+		size_t					m_rank;			// Multi-rank database, rank of the queries
+		std::vector<ILBL>			m_rankLabels;		// Multi-rank database, label at m_rank of each label
+		bool					m_pinThreads;		// Classification threads pinned to cores
 
 		// Tables for storing temp results in default mode
 		std::vector< std::vector <ITYPE> >	m_ITables;
@@ -142,10 +227,6 @@ class CLARK
 
 		// Tables storing common and repetitive values for reading sequences
 		int					m_Letter[256];
-		int					m_table[256];
-		int					m_rTable[256];
-		uint64_t		    		m_pTable[4];
-		std::vector< std::vector<uint64_t> >	m_powerTable;
 		int	 				m_separators[256];
 
 	public:
@@ -161,7 +242,8 @@ class CLARK
 				const uint64_t&		_iterKmers,
 				const size_t& 		_nbCPU,
 				const ITYPE&		_samplingFactor,
-				const bool& 		_mmapLoading 	= false
+				const bool& 		_mmapLoading 	= false,
+				const dbOptions&	_options	= dbOptions()
 		     );
 
 		~CLARK();
@@ -180,7 +262,9 @@ class CLARK
 				const ITYPE& 		_minCountO,
 				const bool& 		_spectrumAnalysis = false,
 				const bool&		_isExtended     = false,	
-				const bool&             _useWeight      = true
+				const bool&             _useWeight      = true,
+				const size_t&		_confidenceBins = 0,
+				const size_t&		_stride		= 0
 			);
 
 		void run(const char*			_pairedfile1,
@@ -190,12 +274,42 @@ class CLARK
                                 const ITYPE&            _minCountO,
                                 const bool&             _spectrumAnalysis = false,
                                 const bool&             _isExtended     = false,
-                                const bool&             _useWeight      = true
+                                const bool&             _useWeight      = true,
+                                const size_t&           _confidenceBins = 0,
+                                const size_t&           _stride         = 0
                         );
 
 		void clear();
 
+		void setPrefilter(const size_t&		_dustThreshold,
+				const size_t&		_minQuality
+				);
+
+		void setCache(const size_t&		_megabytes
+				);
+
+		void setBloom(const size_t&		_bitsPerKey,
+				const size_t&		_megabytes = 0
+				);
+
+		void setPinning(const bool&		_pinThreads
+				)
+		{	m_pinThreads = _pinThreads;	}
+
+		void setRank(const size_t&		_rank
+				);
+
 	private:
+		// Label of a hit at the rank of the queries (multi-rank database): false if the k-mer is not discriminative at it
+		bool atRank(ILBL&			_label
+				) const
+		{
+			if (m_rankLabels.empty())
+			{	return true;	}
+			_label = m_rankLabels[_label];
+			return _label != NOLABEL;
+		}
+
 		void loadComputeObjectsSpectrumData();
 
 		void createTargetFilesNames(std::vector< std::string >& 	_filesHT, 
@@ -213,6 +327,26 @@ class CLARK
 				const std::vector<std::string>& 		_filesHTC
 				) const;
 
+		template <typename ELMTr>
+		bool addTargetKmers(TargetReader&				_reader,
+				EHashtable<HKMERr, ELMTr>&			_ht,
+				const std::string&				_id,
+				const ILBL&					_tgt_id,
+				const size_t&					_gap,
+				size_t&						_nt,
+				size_t*						_kept = NULL
+				) const;
+
+		template <size_t K, typename ELMTr>
+		bool addTargetKmers(TargetReader&				_reader,
+				EHashtable<HKMERr, ELMTr>&			_ht,
+				const std::string&				_id,
+				const ILBL&					_tgt_id,
+				const size_t&					_gap,
+				size_t&						_nt,
+				size_t*						_kept = NULL
+				) const;
+
 		bool getObjectsDataSpectrum(FILE * 				fileToScore
 				);
 
@@ -223,24 +357,80 @@ class CLARK
 
 		void getObjectsDataCompute(const uint8_t *			_map,
 				const size_t& 					nb,
-				FILE*             				_fout
+				FILE*             				_fout,
+				const size_t&					_score
+				);
+
+		void getFastqStarts(const uint8_t *				_map,
+				const size_t& 					nb
 				);
 
-		void getObjectsDataComputeFast(const uint8_t *			_map,
+		template <size_t SCORE>
+		void dispatchObjects(const uint8_t *				_map,
 				const size_t& 					nb,
-				FILE*                   		        _fout
+				const bool&					_fastq
 				);
 
-		void getObjectsDataComputeFastLight(const uint8_t *  		_map,
-				const size_t&                  			 nb,
-				FILE*            			   	_fout
+		template <size_t K, bool FASTQ, size_t SCORE>
+		void scanObjects(const uint8_t *				_map,
+				const size_t& 					nb
 				);
 
+		template <size_t K>
+		ILBL getExpressHit(const readEncoder&				_encoder,
+				const uint8_t*					_seq,
+				const size_t&					_len,
+				const size_t&					_thread
+				) const;
+
 		void getObjectsDataComputeFastSpaced(const bool&		isfasta,
 				const char*                                     filename,
 				const char*  
 				);
 
+		size_t getKmerHits(const readEncoder&				_encoder,
+				const size_t&					_step,
+				HashTop&					_hStore,
+				const size_t&					_thread
+				) const;
+
+		template <size_t K>
+		size_t getKmerHits(const readEncoder&				_encoder,
+				const size_t&					_step,
+				HashTop&					_hStore,
+				const size_t&					_thread
+				) const;
+
+		size_t getSpacedHits(const readEncoder&			_encoder,
+				const size_t&					_step,
+				HashTop&					_hStore,
+				const size_t&					_thread
+				) const;
+
+		template <size_t K>
+		size_t getSpacedHits(const readEncoder&			_encoder,
+				const size_t&					_step,
+				HashTop&					_hStore,
+				const size_t&					_thread
+				) const;
+
+		ITYPE scoreObject(const readEncoder&				_encoder,
+				HashTop&					_hStore,
+				double&						_density,
+				uint64_t&					_saved,
+				uint64_t&					_rescored,
+				const size_t&					_thread
+				) const;
+
+		size_t filterObject(readEncoder&				_encoder,
+				const uint8_t*					_qual,
+				const size_t&					_qualLength
+				) const;
+
+		size_t getStride(const size_t&					_size,
+				const double&					_density
+				) const;
+
 		bool getTargetsData(const char* 				_filesName, 
 				std::vector< std::string >&		 	_filesHT, 
 				std::vector< std::string >&		 	_filesHTC,
@@ -270,9 +460,69 @@ class CLARK
 				const char* 					_fileResult
 				) const;
 
+		void makeSpacedTargetSets();
+
+		bool updateSpecificTargetSets(const bool&			_dbPresent
+				) const;
+
+		void noteUpdate(const std::string&				_note
+				) const;
+
+		void writeIndex(const EHashtable<HKMERr, lElement>&		_ht
+				) const;
+
+		void mergeSpecificTargetSets(const char*			_indexes
+				) const;
+
+		bool fingerprintTarget(TargetReader&				_reader,
+				sequenceFingerprint&				_fingerprint
+				) const;
+
+		bool sameTargets(const size_t&					_kept,
+				const size_t&					_target,
+				std::vector<uint8_t>&				_sequence,
+				size_t&						_tracked
+				) const;
+
+		void findDuplicateTargets(std::vector<bool>&			_duplicate
+				) const;
+
+		std::string getCheckpointName() const;
+
+		void checkpointBuild(EHashtable<HKMERr, lElement>&		_ht,
+				const size_t&					_cursor,
+				const size_t&					_nt,
+				buildCheckpoint&				_journal
+				) const;
+
+		size_t resumeBuild(EHashtable<HKMERr, lElement>&		_ht,
+				size_t&						_nt,
+				buildCheckpoint&				_journal
+				) const;
+
+		void extractSpecificTargetSets(const char*			_targets,
+				const char*					_folder
+				) const;
+
+		void getIndexName(char * 					_name
+				) const;
+
+		void loadLineage();
+
 		void getdbName(char * 						_dbname,
-				const int& 					_htID  = 0    	
+				const int& 					_htID  = 0,
+				const char*					_folder = NULL,
+				const size_t&					_nbLabels = 0
 			      ) const;
+
+		void getdbSettings(dbContainer::Header&				_settings
+				) const;
+
+		bool checkContainer(const bool&					_legacyPresent
+				);
+
+		void packContainer(const bool&					_removeLegacy
+				);
 };
 
 #endif
@@ -314,22 +564,41 @@ CLARK<HKMERr>::CLARK(const size_t& 	_kmerLength,
 		const uint64_t&		_iterKmers,
 		const size_t& 		_nbCPU,
 		const ITYPE&            _samplingFactor,	
-		const bool&     	_mmapLoading
+		const bool&     	_mmapLoading,
+		const dbOptions&	_options
 		): 
-	m_nbCPU(_nbCPU), 
-	m_kmerSize(_kmerLength), m_k((uint8_t) _kmerLength), m_weight(_weight),
+	m_weight(_weight),
 	m_nbObjects(0),
-	m_folder(_folderName), 
-	m_minCountTarget(_minCountT), 
-	m_powerTable(m_kmerSize),
 	m_isFastaFile(true),
-	m_useWeight(true),
-	m_iterKmers(_iterKmers),
+	m_posReads(_nbCPU),
 	m_isLightLoading(_isLightLoading),
 	m_isSpacedLoading(_isSpacedLoading),
-	m_posReads(_nbCPU),
+	m_folder(_folderName), 
+	m_nbCPU(_nbCPU), 
+	m_kmerSize(_kmerLength), m_k((uint8_t) _kmerLength),
+	m_minCountTarget(_minCountT), 
+	m_iterKmers(_iterKmers),
+	m_useWeight(true),
 	m_isPaired(false),
-	m_isExtended(false)
+	m_isExtended(false),
+	m_confidenceBins(0),
+	m_stride(0),
+	m_dustThreshold(0),
+	m_minQuality(0),
+	m_numaPolicy(_options.numaPolicy),
+	m_pages(_options.pages),
+	m_sharedMemory(_options.sharedMemory),
+	m_container(_options.dbFormat != CDB_LEGACY && !_isSpacedLoading),
+	m_dbFormat(_options.dbFormat),
+	m_syncmer(_kmerLength, _options.syncmer),
+	m_incremental(_options.incremental),
+	m_partial(_options.partial),
+	m_dedup(_options.dedup),
+	m_checkpoint(_options.checkpoint),
+	m_resume(_options.resume),
+	m_lineageFile(_options.lineage != NULL ? _options.lineage: ""),
+	m_rank(0),
+	m_pinThreads(false)
 {
 
 #ifdef _OPENMP
@@ -348,42 +617,14 @@ CLARK<HKMERr>::CLARK(const size_t& 	_kmerLength,
 	m_ITables.resize(m_nbCPU);
 	m_Indexes.resize(m_nbCPU);
 
-	size_t base = 1;
-	for(size_t p = 0; p < m_kmerSize ; p++)
-	{       
-		m_powerTable[p].resize(4);
-		m_powerTable[p][0] = 0; m_powerTable[p][1] = base; m_powerTable[p][2] = base*2; m_powerTable[p][3] = base*3;  
-		base *= 4;
-	}
-	m_pTable[0] = m_powerTable[m_kmerSize-1][0]; 
-	m_pTable[1] = m_powerTable[m_kmerSize-1][1];
-	m_pTable[2] = m_powerTable[m_kmerSize-1][2];
-	m_pTable[3] = m_powerTable[m_kmerSize-1][3];
-
 	for(size_t t = 0; t < 256 ; t++)
-	{	m_table[t] = -1; m_separators[t] = 0; m_rTable[t] = -1;	m_Letter[t] = -1;}
+	{	m_separators[t] = 0; m_Letter[t] = -1;}
 
 	// Letter definition (Fastq files)
 	for(size_t t = 65; t < 91; t++)
 	{	m_Letter[t] = 0;}
 	for(size_t t = 97; t < 123; t++)
 	{       m_Letter[t] = 0;}
-	// Nucleotide definitions (DNA)
-	m_table['A'] = 0;	m_table['C'] = 1;       m_table['G'] = 2;	m_table['T'] = 3;
-	m_table['a'] = 0;       m_table['c'] = 1;       m_table['g'] = 2;       m_table['t'] = 3;
-	// Nucleotide definitions (RNA)
-	m_table['U'] = 3; 	m_table['u'] = 3;
-
-	// Other symbol definitions
-	m_table['>'] = -2;	m_table['\n']= -10;
-	// Reverse - Nucleotide definitions (DNA)
-	m_rTable['A'] = 3;      m_rTable['C'] = 2;       m_rTable['G'] = 1;       m_rTable['T'] = 0;
-	m_rTable['a'] = 3;      m_rTable['c'] = 2;       m_rTable['g'] = 1;       m_rTable['t'] = 0;
-	// Reverse - Nucleotide definitions (RNA)
-	m_rTable['U'] = 0;      m_rTable['u'] = 0;
-
-	// Reverse - Other symbol definitions
-	m_rTable['>'] = -2;     m_rTable['\n']= -10;
 
 	m_separators[' '] = 1;	m_separators['\t'] = 1; 	m_separators['\n'] = 1;
 
@@ -394,10 +635,54 @@ CLARK<HKMERr>::CLARK(const size_t& 	_kmerLength,
 	}
 	vector<string> filesHT, filesHTC;
 	size_t sizeMotherHT = 0;
-	if (!getTargetsData(_filesName, filesHT, filesHTC, _creatingkmfiles, _samplingFactor))
+	const bool present = getTargetsData(_filesName, filesHT, filesHTC, _creatingkmfiles, _samplingFactor);
+	if (m_incremental && !m_labels_c.empty())
+	{	cerr << "The incremental update of the database is not available with centromere labels: ignored." << endl;	}
+	if (!m_ranks.empty() && !m_labels_c.empty())
+	{
+		cerr << "The multi-rank database is not available with centromere labels." << endl;
+		exit(1);
+	}
+	if ((m_partial || _options.indexes != NULL) && !m_labels_c.empty())
+	{
+		cerr << "The partial builds and their merge are not available with centromere labels." << endl;
+		exit(1);
+	}
+	if ((m_checkpoint > 0 || m_resume) && !m_labels_c.empty())
+	{	cerr << "The checkpoints of the build are not available with centromere labels: ignored." << endl;	}
+	if (m_dedup && m_minCountTarget > 0)
+	{	cerr << "The duplicates of targets count in the k-mers kept with a minimum count (-t): '--dedup' ignored." << endl;	}
+	if (_options.subset != NULL && !m_labels_c.empty())
+	{
+		cerr << "The extraction of a database is not available with centromere labels." << endl;
+		exit(1);
+	}
+	if (m_partial)
+	{
+		cerr << "Starting the creation of the mother table of the targets for a merge..." << endl;
+		makeSpecificTargetSets(filesHT, filesHTC);
+		m_centralHt = NULL;
+		return;
+	}
+	if (!(m_incremental && m_labels_c.empty() ? updateSpecificTargetSets(present): present))
 	{
-		cerr << "Starting the creation of the database of targets specific " << m_kmerSize << "-mers from input files..." << endl;
-		sizeMotherHT = makeSpecificTargetSets(filesHT, filesHTC);
+		if (m_isSpacedLoading)
+		{	makeSpacedTargetSets();	}
+		else
+		{
+			if (_options.indexes != NULL)
+			{	mergeSpecificTargetSets(_options.indexes);	}
+			else if (_options.subset != NULL)
+			{	extractSpecificTargetSets(_options.subset, _options.subsetFolder);	}
+			else
+			{
+				cerr << "Starting the creation of the database of targets specific " << m_kmerSize << "-mers from input files..." << endl;
+				sizeMotherHT = makeSpecificTargetSets(filesHT, filesHTC);
+			}
+			noteUpdate("");
+			if (m_container)
+			{	packContainer(true);	}
+		}
 	}
 	loadSpecificTargetSets(filesHT, filesHTC, sizeMotherHT, _samplingFactor, _mmapLoading);
 
@@ -407,6 +692,8 @@ CLARK<HKMERr>::CLARK(const size_t& 	_kmerLength,
 		m_ITables[t].resize(m_labels.size() + m_labels_c.size());
 		m_Indexes[t].resize(m_labels.size() + m_labels_c.size());
 	}
+	if (!m_ranks.empty())
+	{	setRank(m_rank);	}
 }
 
 	template <typename HKMERr>
@@ -441,6 +728,31 @@ void CLARK<HKMERr>::clear()
 	m_ResultsCentral.clear();
 	m_resultsFast.clear();
 	m_scoresLines.clear();
+	m_skippedKmers.assign(m_nbCPU, 0);
+	m_cache.reset();
+}
+
+	template <typename HKMERr>
+void CLARK<HKMERr>::setPrefilter(const size_t& _dustThreshold, const size_t& _minQuality)
+{
+	m_dustThreshold = _dustThreshold;
+	m_minQuality 	= _minQuality;
+}
+
+	template <typename HKMERr>
+void CLARK<HKMERr>::setCache(const size_t& _megabytes)
+{
+	m_cache.init(_megabytes << 20);
+}
+
+	template <typename HKMERr>
+void CLARK<HKMERr>::setBloom(const size_t& _bitsPerKey, const size_t& _megabytes)
+{
+	if (_bitsPerKey == 0)
+	{	return;	}
+	m_centralHt->BuildFilter(_bitsPerKey, _megabytes << 20, m_nbCPU);
+	const bloomFilter& filter = m_centralHt->GetFilter();
+	cerr << "Bloom filter built (" << filter.getBytes() / 1000000 << " MB, expected false positive rate: " << 100.0*filter.getRate() << "%)" << endl;
 }
 
 template <typename HKMERr>
@@ -482,12 +794,14 @@ void CLARK<HKMERr>::createTargetFilesNames(vector<string>& _filesHT, vector<stri
 }
 
 	template <typename HKMERr>
-void CLARK<HKMERr>::run(const char* _filesToObjects, const char* _fileToResults, const size_t& _mode, const ITYPE& _minCountO, const bool& _spectrumAnalysis, const bool& _isExtended, const bool&  _useWeight)
+void CLARK<HKMERr>::run(const char* _filesToObjects, const char* _fileToResults, const size_t& _mode, const ITYPE& _minCountO, const bool& _spectrumAnalysis, const bool& _isExtended, const bool&  _useWeight, const size_t& _confidenceBins, const size_t& _stride)
 {
 	FILE* fd = fopen(_fileToResults, "r");
 	m_isPaired = false;
 	m_isExtended = _isExtended;
-	string mode(_mode == 0 ? "Full": (_mode == 1? "Default" : (_mode == 2? "Express":"Spectrum")));
+	m_confidenceBins = _confidenceBins;
+	m_stride = _stride;
+	string mode(_mode == 0 ? "Full": (_mode == 1? "Default" : (_mode == 2? "Express": (_mode == 3? "Spectrum":"Cascade"))));
 	if (fd == NULL )
 	{
 		cerr << "Mode: " << mode<< ",\tProcessing file: " << _filesToObjects << ",\t using "<< m_nbCPU << " CPU." <<  endl;
@@ -529,12 +843,14 @@ void CLARK<HKMERr>::run(const char* _filesToObjects, const char* _fileToResults,
 }
 
         template <typename HKMERr>
-void CLARK<HKMERr>::run(const char* _pairedfile1, const char* _pairedfile2, const char* _fileToResults, const size_t& _mode, const ITYPE& _minCountO, const bool& _spectrumAnalysis, const bool& _isExtended, const bool&  _useWeight)
+void CLARK<HKMERr>::run(const char* _pairedfile1, const char* _pairedfile2, const char* _fileToResults, const size_t& _mode, const ITYPE& _minCountO, const bool& _spectrumAnalysis, const bool& _isExtended, const bool&  _useWeight, const size_t& _confidenceBins, const size_t& _stride)
 {
         FILE* fd 	= fopen(_fileToResults, "r");
         m_isPaired 	= true;
         m_isExtended 	= _isExtended;
-        string mode(_mode == 0 ? "Full": (_mode == 1? "Default" : (_mode == 2? "Express":"Spectrum")));
+        m_confidenceBins = _confidenceBins;
+        m_stride 	= _stride;
+        string mode(_mode == 0 ? "Full": (_mode == 1? "Default" : (_mode == 2? "Express": (_mode == 3? "Spectrum":"Cascade"))));
 	char * mergedFiles = NULL;
         if (fd == NULL )
         {
@@ -656,7 +972,7 @@ void CLARK<HKMERr>::runSimple(const char* _fileTofilesname, const char* _fileRes
 	{
 		gettimeofday(&requestStart, NULL);
 		///////////////////////////////////////////////////////////////////////
-		getObjectsDataComputeFast(map, fileSize, _fout);
+		getObjectsDataCompute(map, fileSize, _fout, SCORE_EXPRESS);
 		///////////////////////////////////////////////////////////////////////
 		gettimeofday(&requestEnd, NULL);
 		fclose(_fout);
@@ -674,7 +990,7 @@ void CLARK<HKMERr>::runSimple(const char* _fileTofilesname, const char* _fileRes
 	{
 		gettimeofday(&requestStart, NULL);
 		///////////////////////////////////////////////////////////////////////
-		getObjectsDataComputeFastLight(map, fileSize, _fout);
+		getObjectsDataCompute(map, fileSize, _fout, SCORE_EXPRESSLIGHT);
 		///////////////////////////////////////////////////////////////////////
 		gettimeofday(&requestEnd, NULL);
 		fclose(_fout);
@@ -692,7 +1008,7 @@ void CLARK<HKMERr>::runSimple(const char* _fileTofilesname, const char* _fileRes
 	{
 		gettimeofday(&requestStart, NULL);
 		///////////////////////////////////////////////////////////////////////
-		getObjectsDataCompute(map, fileSize, _fout);
+		getObjectsDataCompute(map, fileSize, _fout, SCORE_DEFAULT);
 		///////////////////////////////////////////////////////////////////////
 		gettimeofday(&requestEnd, NULL);
 		fclose(_fout);
@@ -721,7 +1037,7 @@ void CLARK<HKMERr>::runSimple(const char* _fileTofilesname, const char* _fileRes
 		////////////////////////////////////////////////////////////////////////
 		return;
 	}
-	if (m_mode == 0 || (m_mode == 1 && m_isSpacedLoading))
+	if (m_mode == 0 || m_mode == 4 || (m_mode == 1 && m_isSpacedLoading))
 	{
 		bool isfasta = fline[0] == '>';
 		if (!isfasta && fline[0] != '@')
@@ -806,7 +1122,7 @@ void CLARK<HKMERr>::loadComputeObjectsSpectrumData()
 				if (val > m_minCountObject)
 				{
 					bKmer = line;
-					if (m_centralHt->queryElement(bKmer, h))
+					if (m_centralHt->queryElement(bKmer, h, 0) && atRank(h))
 					{	
 						//m_ResultsCentral[h][t] += (m_useWeight) ? val: 1;	
 						hStore.insert(h,m_useWeight?val:1);
@@ -831,253 +1147,1259 @@ void CLARK<HKMERr>::loadComputeObjectsSpectrumData()
 }
 
 template <typename HKMERr>
-void CLARK<HKMERr>::getdbName(char *   _dbname, const int& _htID) const
+void CLARK<HKMERr>::getdbName(char *   _dbname, const int& _htID, const char* _folder, const size_t& _nbLabels) const
 {
-	size_t sizeHTS =  m_labels.size() + m_labels_c.size();
+	// Database of this directory and targets, or of the directory _folder and _nbLabels labels if given
+	const char* folder = _folder != NULL ? _folder: m_folder;
+	size_t sizeHTS = _folder != NULL ? _nbLabels: m_labels.size() + m_labels_c.size();
 	if (m_isLightLoading)
 	{
-		sprintf(_dbname,"%sdb_central_k%lu_t%lu_s%lu_m%lu_light_%lu.tsk",m_folder,(size_t)m_kmerSize,sizeHTS,(size_t) HTSIZE,(size_t)m_minCountTarget,(size_t) m_iterKmers);
+		sprintf(_dbname,"%sdb_central_k%lu_t%lu_s%lu_m%lu_light_%lu.tsk",folder,(size_t)m_kmerSize,sizeHTS,(size_t) HTSIZE,(size_t)m_minCountTarget,(size_t) m_iterKmers);
+	}
+	else if (m_weight == m_kmerSize && m_syncmer.isEnabled())
+	{
+		sprintf(_dbname,"%sdb_central_k%lu_t%lu_s%lu_m%lu_sync%lu.tsk",folder,(size_t)m_kmerSize,sizeHTS,(size_t) HTSIZE,(size_t)m_minCountTarget,m_syncmer.getS());
 	}
 	else if (m_weight == m_kmerSize)
 	{
-		sprintf(_dbname,"%sdb_central_k%lu_t%lu_s%lu_m%lu.tsk",m_folder,(size_t)m_kmerSize,sizeHTS,(size_t) HTSIZE,(size_t)m_minCountTarget);
+		sprintf(_dbname,"%sdb_central_k%lu_t%lu_s%lu_m%lu.tsk",folder,(size_t)m_kmerSize,sizeHTS,(size_t) HTSIZE,(size_t)m_minCountTarget);
+	}
+	else if (_htID > 0)
+	{
+		sprintf(_dbname,"%s%s/db_central_k%lu_t%lu_s%lu_m%lu_w%lu.tsk",folder, m_DSS[_htID-1].getFolder().c_str(),(size_t)m_kmerSize,sizeHTS,(size_t)HTSIZE,(size_t)m_minCountTarget,m_weight);
+
 	}
 	else
 	{
-		sprintf(_dbname,"%s%s/db_central_k%lu_t%lu_s%lu_m%lu_w%lu.tsk",m_folder, m_DSS[_htID-1].getFolder().c_str(),(size_t)m_kmerSize,sizeHTS,(size_t)HTSIZE,(size_t)m_minCountTarget,m_weight);
+		// Table of all the seeds
+		sprintf(_dbname,"%sdb_central_k%lu_t%lu_s%lu_m%lu_w%lu",folder,(size_t)m_kmerSize,sizeHTS,(size_t)HTSIZE,(size_t)m_minCountTarget,m_weight);
+		for(size_t u = 0; u < m_DSS.size(); u++)
+		{	sprintf(_dbname + strlen(_dbname), "_%s", m_DSS[u].getName().c_str());	}
+		strcat(_dbname, ".tsk");
+	}
+	if (!m_ranks.empty())
+	{	strcpy(_dbname + strlen(_dbname) - 4, "_ranks.tsk");	}
+}
+
+	template <typename HKMERr>
+void CLARK<HKMERr>::loadLineage()
+{
+	// Multi-rank database: the nodes above the labels of the targets in the lineage file (getfilesToTaxNodes:
+	// file, taxon ID, then the nodes from species to phylum, UNKNOWN if none) are added as labels. A k-mer
+	// found in several labels gets their lowest common ancestor (EHashtable::SetLineage), so that it is
+	// counted at its rank and the ranks above (setRank).
+	FILE * fd = fopen(m_lineageFile.c_str(), "r");
+	if (fd == NULL)
+	{
+		cerr << "Failed to open the lineage file: " << m_lineageFile << endl;
+		exit(1);
+	}
+	// Rank and parent of each node (first lineage found)
+	std::map< string, std::pair<uint8_t, string> > nodes;
+	std::vector<char> sep;
+	sep.push_back(' ');
+	sep.push_back('\t');
+	sep.push_back('\r');
+	std::vector<std::string> ele;
+	string line;
+	while (getLineFromFile(fd, line))
+	{
+		ele.clear();
+		getElementsFromLine(line, sep, ele);
+		if (ele.size() < 2 + NBRANKS)
+		{	continue;	}
+		for(size_t r = 0; r < NBRANKS; r++)
+		{
+			if (ele[2 + r] == "UNKNOWN")
+			{	continue;	}
+			size_t p = r + 1;
+			while (p < NBRANKS && ele[2 + p] == "UNKNOWN")
+			{	p++;	}
+			nodes.insert(std::make_pair(ele[2 + r], std::make_pair((uint8_t) r, p < NBRANKS ? ele[2 + p]: string(""))));
+		}
+	}
+	fclose(fd);
+	// Labels of the targets, then their ancestors as they are found
+	std::map<string, ILBL> ids;
+	for(size_t l = 0; l < m_labels.size(); l++)
+	{	ids[m_labels[l]] = l;	}
+	const size_t nbLabels = m_labels.size();
+	m_rank = NBRANKS;
+	for(size_t l = 0; l < m_labels.size(); l++)
+	{
+		std::map< string, std::pair<uint8_t, string> >::const_iterator it = nodes.find(m_labels[l]);
+		if (it == nodes.end())
+		{
+			cerr << "The label " << m_labels[l] << " is not in the lineage file: its k-mers are counted at its own rank only." << endl;
+			m_ranks.push_back(0);
+			m_parents.push_back(NOLABEL);
+			continue;
+		}
+		m_ranks.push_back(it->second.first);
+		m_rank = l < nbLabels && it->second.first < m_rank ? it->second.first: m_rank;
+		if (it->second.second.empty())
+		{
+			m_parents.push_back(NOLABEL);
+			continue;
+		}
+		if (ids.find(it->second.second) == ids.end())
+		{
+			ids[it->second.second] = m_labels.size();
+			m_labels.push_back(it->second.second);
+		}
+		m_parents.push_back(ids[it->second.second]);
+	}
+	// Queries at the rank of the labels of the targets by default
+	m_rank = m_rank < NBRANKS ? m_rank: 0;
+}
 
+	template <typename HKMERr>
+void CLARK<HKMERr>::setRank(const size_t& _rank)
+{
+	// Label of each label at the rank _rank: its ancestor of this rank, none if its rank is higher (its k-mers are
+	// not discriminative at this rank) or if it has no ancestor of this rank
+	if (m_ranks.empty())
+	{	return;	}
+	m_rank = _rank;
+	m_rankLabels.assign(m_labels.size() + 1, NOLABEL);
+	for(size_t l = 0; l < m_ranks.size(); l++)
+	{
+		ILBL a = l;
+		while (a != NOLABEL && m_ranks[a] < m_rank)
+		{	a = m_parents[a];	}
+		m_rankLabels[l] = a != NOLABEL && m_ranks[a] == m_rank ? a: NOLABEL;
 	}
 }
 
 	template <typename HKMERr>
-void CLARK<HKMERr>::loadSpecificTargetSets(const vector<string>& _filesHT, 
-		const vector<string>& 	_filesHTC, 
-		const size_t& 		_sizeMotherHT,
-		const ITYPE& 		_samplingFactor,	
-		const bool&  		_mmapLoading
-		)
+void CLARK<HKMERr>::getIndexName(char * _name) const
+{
+	// Mother table of the builds of this directory (any targets, any minimum count). The table of a partial
+	// build (canonical keys) has its own name, so that it does not replace the index of the incremental builds,
+	// with a hash (FNV-1a) of its targets, so that the partial builds of other shares in the directory are kept.
+	sprintf(_name,"%sdb_mother_k%lu_s%lu",m_folder,(size_t)m_kmerSize,(size_t) HTSIZE);
+	if (m_syncmer.isEnabled())
+	{	sprintf(_name + strlen(_name),"_sync%lu",m_syncmer.getS());	}
+	if (m_partial)
+	{
+		uint64_t h = 0xcbf29ce484222325ULL;
+		char position[64];
+		for(size_t t = 0; t < m_targetsID.size(); t++)
+		{
+			sprintf(position, "\t%lu\t%lu\t", m_targetsID[t].offset, m_targetsID[t].length);
+			const string target = m_targetsID[t].filePath + position + m_targetsID[t].id + "\n";
+			for(size_t c = 0; c < target.size(); c++)
+			{	h = (h ^ (uint8_t) target[c]) * 0x100000001b3ULL;	}
+		}
+		sprintf(_name + strlen(_name),"_part_%016llx",(unsigned long long) h);
+	}
+	strcat(_name, MXEXT);
+}
+
+	template <typename HKMERr>
+void CLARK<HKMERr>::writeIndex(const EHashtable<HKMERr, lElement>& _ht) const
 {
-	size_t kmersLoaded = 0;
-	ITYPE minCount = m_minCountTarget;
-	m_centralHt = new EHashtable<HKMERr, bigElement>(m_weight, m_labels, m_labels_c, m_DSS);
 	char * cfname = (char*) calloc(MXNMLEN, sizeof(char));
-	size_t fileSize = 0;
+	getIndexName(cfname);
+	vector<string> targets, ids;
+	char position[64];
+	for(size_t t = 0; t < m_targetsID.size(); t++)
+	{
+		sprintf(position, "\t%lu\t%lu", m_targetsID[t].offset, m_targetsID[t].length);
+		targets.push_back(m_targetsID[t].filePath + position);
+		ids.push_back(m_targetsID[t].id);
+	}
+	cerr << "Saving the index of the build [" << cfname << "]..." << endl;
+	if (!motherIndex::write(string(cfname), m_kmerSize, m_syncmer.getS(), m_partial, sizeof(HKMERr), sizeof(htCell<HKMERr, lElement>), targets, ids, _ht.GetLabels(), _ht, 2))
+	{
+		cerr << "Failed to write the index " << cfname << (m_partial ? "." : ": the next update will rebuild the database.") << endl;
+		if (m_partial)
+		{	exit(1);	}
+	}
+	free(cfname);
+	cfname = NULL;
+}
 
-	if (m_isSpacedLoading /*m_kmerSize != m_weight*/)
+	template <typename HKMERr>
+void CLARK<HKMERr>::mergeSpecificTargetSets(const char* _indexes) const
+{
+	// Database from the mother tables of partial builds (one per line of _indexes), each one over a share of
+	// the targets. The keys are in canonical orientation, so the occurrences of a k-mer are in the same bucket
+	// of every table: buckets are merged one at a time (tables in the order of their first target, the label
+	// and the orientation of the first occurrence (lElement::Reversed) kept as by addElement), then the rules
+	// of RemoveCommon applied. A k-mer kept is stored in this orientation, as by a single build, so it can be in
+	// another bucket: the k-mers kept are first written in MERGEPARTS files by range of buckets, then each file
+	// is sorted and its buckets written as by Write. Same database as a single build when the targets of each
+	// partial build are consecutive in the targets file.
+	FILE * fd = fopen(_indexes, "r");
+	if (fd == NULL)
+	{
+		cerr << "Failed to open the list of partial builds: " << _indexes << endl;
+		exit(1);
+	}
+	vector<string> files;
+	string line;
+	while (getLineFromFile(fd, line))
 	{
-		vector<string> names;
-		for(size_t u = 0; u < m_DSS.size(); u++)
+		if (!line.empty())
+		{	files.push_back(line);	}
+	}
+	fclose(fd);
+	// Targets and labels of the targets file: every target in one table exactly
+	std::map<string, string> targets;
+	std::map<string, size_t> positions;
+	std::map<string, ILBL> labelsId;
+	char position[64];
+	for(size_t t = 0; t < m_targetsID.size(); t++)
+	{
+		sprintf(position, "\t%lu\t%lu", m_targetsID[t].offset, m_targetsID[t].length);
+		targets[m_targetsID[t].filePath + position] = m_targetsID[t].id;
+		positions[m_targetsID[t].filePath + position] = t;
+	}
+	for(size_t l = 0; l < m_labels.size(); l++)
+	{	labelsId[m_labels[l]] = l;	}
+	labelsId[""] = m_labels.size();
+	vector<motherIndex*> parts(files.size());
+	vector< vector<ILBL> > labels(files.size());
+	vector< std::pair<size_t, size_t> > order(files.size());
+	for(size_t p = 0; p < files.size(); p++)
+	{
+		order[p] = std::make_pair(m_targetsID.size(), p);
+		parts[p] = new motherIndex();
+		if (!parts[p]->open(files[p], m_kmerSize, m_syncmer.getS(), sizeof(HKMERr), sizeof(htCell<HKMERr, lElement>)) ||
+			!parts[p]->isCanonical())
 		{
-			getdbName(cfname, u+1);
-			string val(cfname);
-			names.push_back(val);
+			cerr << "Failed to read " << files[p] << " as the table of a partial build of the same settings." << endl;
+			exit(1);
 		}
-		cerr << "Loading databases of spaced k-mers... " << endl;
-		m_centralHt->AddDB(names, fileSize, _samplingFactor);
-		cerr << "Loading done (" << fileSize / 1000000<<" MB read, with sampling factor " << _samplingFactor << ", " << m_centralHt->Size() << " spaced k-mers stored)" << endl;	
-		free(cfname);
-		cfname = NULL;
-		return;
+		for(size_t t = 0; t < parts[p]->getTargets().size(); t++)
+		{
+			std::map<string, string>::iterator it = targets.find(parts[p]->getTargets()[t]);
+			if (it == targets.end() || it->second != parts[p]->getIds()[t])
+			{
+				cerr << "The target " << parts[p]->getTargets()[t].substr(0, parts[p]->getTargets()[t].find('\t')) << " of " << files[p] << " is not in the targets file, or twice in the partial builds." << endl;
+				exit(1);
+			}
+			targets.erase(it);
+			order[p].first = min(order[p].first, positions[parts[p]->getTargets()[t]]);
+		}
+		labels[p].resize(parts[p]->getLabels().size());
+		for(size_t l = 0; l < labels[p].size(); l++)
+		{
+			std::map<string, ILBL>::const_iterator it = labelsId.find(parts[p]->getLabels()[l]);
+			if (it == labelsId.end())
+			{
+				cerr << "The label " << parts[p]->getLabels()[l] << " of " << files[p] << " is not in the targets file." << endl;
+				exit(1);
+			}
+			labels[p][l] = it->second;
+		}
+		if (!parts[p]->openTable())
+		{
+			cerr << "Failed to read " << files[p] << endl;
+			exit(1);
+		}
+	}
+	if (!targets.empty())
+	{
+		cerr << "The target " << targets.begin()->first.substr(0, targets.begin()->first.find('\t')) << " is in no partial build (" << targets.size() << " missing)." << endl;
+		exit(1);
 	}
+	// Tables in the order of their first target in the targets file, as the targets of a single build
+	std::sort(order.begin(), order.end());
+	vector<string> sortedFiles(files.size());
+	vector<motherIndex*> sortedParts(files.size());
+	vector< vector<ILBL> > sortedLabels(files.size());
+	for(size_t p = 0; p < files.size(); p++)
+	{
+		sortedFiles[p] = files[order[p].second];
+		sortedParts[p] = parts[order[p].second];
+		sortedLabels[p].swap(labels[order[p].second]);
+	}
+	files.swap(sortedFiles);
+	parts.swap(sortedParts);
+	labels.swap(sortedLabels);
+	cerr << "Merging the tables of " << files.size() << " partial builds..." << endl;
+	char * cfname = (char*) calloc(MXNMLEN + 4, sizeof(char));
 	getdbName(cfname);
-	cerr << "Loading database [" << cfname << ".*] ..." << endl;
-	if (m_centralHt->Read(cfname, fileSize, m_nbCPU, _samplingFactor, _mmapLoading))
+	const string db(cfname);
+	FILE * fd_l = fopen((db + ".lb").c_str(), "w+");
+	FILE * fd_k = fopen((db + ".ky").c_str(), "w+");
+	FILE * fd_s = fopen((db + ".sz").c_str(), "w+");
+	if (fd_l == NULL || fd_k == NULL || fd_s == NULL)
 	{
-		cerr << "Loading done (database size: " << fileSize / 1000000<<" MB read, with sampling factor " << _samplingFactor << ")" << endl;
-		free(cfname);
-		cfname = NULL;
-		return;
+		cerr << "Failed to create the database " << db << endl;
+		exit(1);
 	}
-	if ( _filesHT.size() + _filesHTC.size() == 0)
+	vector<FILE*> fd_m(MERGEPARTS);
+	for(size_t r = 0; r < MERGEPARTS; r++)
 	{
-		cerr << "Failed to find the database." << endl;
-		exit(-1);	
+		sprintf(position, ".mg%lu", r);
+		fd_m[r] = fopen((db + position).c_str(), "w+");
+		if (fd_m[r] == NULL)
+		{
+			cerr << "Failed to create the file " << db << position << endl;
+			exit(1);
+		}
 	}
-}
-
-template <typename HKMERr>
-size_t CLARK<HKMERr>::makeSpecificTargetSets(const vector<string>& _filesHT, const vector<string>& _filesHTC) const
-{
-	size_t 	nt = 0;
-	if (m_isLightLoading)
+	vector< vector< htCell<HKMERr, lElement> > > cells(files.size());
+	vector<size_t> heads(files.size());
+	vector<HKMERr> keys;
+	vector<ILBL> lbls;
+	loadIndex index;
+	uint64_t nbElement = 0, nbMother = 0;
+	for(size_t b = 0; b < HTSIZE; b++)
 	{
-		EHashtable<HKMERr, lElement> commonKmersHT(m_kmerSize, m_labels, m_labels_c);
-		for(size_t t = 0 ; t < m_targetsID.size(); t++)
+		for(size_t p = 0; p < files.size(); p++)
 		{
-			TargetReader targetReader(m_targetsID[t]);
-			if (!targetReader.open())
-			{	cerr << "Failed to open " << m_targetsID[t].filePath << endl;
-				continue;
+			if (!parts[p]->readBucket(b, cells[p]))
+			{
+				cerr << "Failed to read " << files[p] << endl;
+				exit(1);
 			}
-			ILBL tgt_id;
-			commonKmersHT.getTargetID(m_targetsID[t].id, tgt_id);
-			char c[MAXRSIZE];
-			size_t len = targetReader.readChunk(c), i = 0;
-			uint64_t _km_f = 0, _km_r = 0;
-			uint8_t cpt = 0;
-			uint64_t iter = 0;
-			if (len > 0 && c[0] == '>')
+			for(size_t u = 0; u < cells[p].size(); u++)
+			{	cells[p][u].CElement.Label = labels[p][cells[p][u].CElement.Label];	}
+			heads[p] = 0;
+		}
+		keys.clear();
+		lbls.clear();
+		while (true)
+		{
+			// Smallest key of the buckets, cells of this key combined (as addElement over the targets in order)
+			size_t first = files.size();
+			for(size_t p = 0; p < files.size(); p++)
 			{
-				while (len != 0)
-				{
-					while( i < len)
-					{
-						if (m_table[c[i]] >= 0)
-						{
-							nt++;
-							_km_r <<= 2;    
-							_km_r += 3 - m_table[c[i]];
-							if (cpt  == m_kmerSize - 1)
-							{
-								//[/////////////////////////////////////////////////////////////////////
-								if ( iter % m_iterKmers == 0  )
-								{       commonKmersHT.addElement(_km_r, m_targetsID[t].id, tgt_id, 1);}
-								_km_r = 0; cpt = 0; 
-								i++;
-								iter++;
-								continue;
-								//]//////////////////////////////////////////////////////////////////////
-							}
-							cpt++;  
-							i++;
-							continue;
-						}
-						if (m_table[c[i]] == -10)
-						{       i++;
-							continue;   }
-						if (m_table[c[i]] == -1)
-						{        nt++; _km_r = 0; cpt = 0; i++;
-							continue;  }
-						if (m_table[c[i]] == -2)
-						{
-							_km_r = 0; cpt = 0; 
-							while (len != 0)
-							{
-								while(i < len && c[i] != '\n')
-								{       i++;}
-								if (i < len)
-								{   break;}
-								len = targetReader.readChunk(c);
-								i = 0;
-							}
-							i++;
-							continue;
-						}
-						cerr << m_targetsID[t].filePath << ": " ;
-						cerr << "Failed to process sequence -- wrong character found [ASCII]: " << (size_t) c << endl;
-					}
-					len = targetReader.readChunk(c);
-					i = 0;
-				}
-				targetReader.close();
-				cerr << "\r Progress report: (" <<t+1<< "/"<<m_targetsID.size()<<")    ";
-				continue;
+				if (heads[p] < cells[p].size() && (first == files.size() || cells[p][heads[p]].CKey < cells[first][heads[first]].CKey))
+				{	first = p;	}
 			}
-			if (len > 0 && c[0] == '@')
+			if (first == files.size())
+			{	break;	}
+			const HKMERr key = cells[first][heads[first]].CKey;
+			lElement e = cells[first][heads[first]++].CElement;
+			for(size_t p = first + 1; p < files.size(); p++)
 			{
-				while (len != 0)
-				{
-					while(i < len && c[i] != '\n')
-					{       i++;}
-					if (i < len)
-					{   break;}
-					len = targetReader.readChunk(c);
-					i = 0;
-				}
-				i++;
-				while (len != 0)
+				if (heads[p] < cells[p].size() && cells[p][heads[p]].CKey == key)
 				{
-					while( i < len)
-					{
-						if (m_table[c[i]] >= 0)
-						{
-							nt++;
-							_km_r <<= 2; 
-							_km_r += 3 - m_table[c[i]];
-							if (cpt  == m_kmerSize - 1)
-							{
-								//[/////////////////////////////////////////////////////////////////////
-								if ( iter % m_iterKmers == 0 )
-								{       commonKmersHT.addElement(_km_r, m_targetsID[t].id, tgt_id, 1);}
-								_km_r = 0; cpt = 0; 
-								i++;
-								iter++;
-								continue;
-								//]//////////////////////////////////////////////////////////////////////
-							}
-							cpt++;
-							i++;
-							continue;
-						}
-						if (m_table[c[i]] == -10)
-						{
-							_km_r = 0; cpt = 0;
-							// Pass third line
-							i++;
-							while (len != 0)
-							{
-								while(i < len && c[i] != '\n')
-								{       i++;}
-								if (i < len)
-								{   break;}
-								len = targetReader.readChunk(c);
-								i = 0;
-							}
-							i++;
-							// Pass fouth line
-							while (len != 0)
-							{
-								while(i < len && c[i] != '\n')
-								{       i++;}
-								if (i < len)
-								{   break;}
-								len = targetReader.readChunk(c);
-								i = 0;
-							}
-							i++;
-							// Pass first line
-							while (len != 0)
-							{
-								while(i < len && c[i] != '\n')
-								{       i++;}
-								if (i < len)
-								{   break;}
-								len = targetReader.readChunk(c);
-								i = 0;
-							}
-							i++;
-							continue;
-						}
-						if (m_table[c[i]] == -1)
-						{
-							nt++;
-							_km_r = 0; cpt = 0; 
-							i++;
-							continue;
-						}
-						cerr << m_targetsID[t].filePath << ": " ;
-						cerr << "Failed to process sequence -- wrong character found [ASCII]: " << (size_t) c << endl;
-					}
-					len = targetReader.readChunk(c);
-					i = 0;
+					const lElement& o = cells[p][heads[p]++].CElement;
+					if ((o.GetMultiplicity() | 1) != 1 || o.Label != e.Label)
+					{	e.IncreaseMultiplicity(2);	}
+					e.Set(e.Label, e.GetCount() + o.GetCount() < 255 ? e.GetCount() + o.GetCount(): 254);
 				}
-				targetReader.close();
-				cerr << "\r Progress report: (" <<t+1<< "/"<<m_targetsID.size()<<")              ";
-				continue;
 			}
-			targetReader.reset();
-			string s_kmer = "";
-			ITYPE val = 0;
-			uint8_t counter = 0;
-			while (targetReader.getFirstAndSecondElementInLine(s_kmer, val))
+			nbMother++;
+			if ((e.GetMultiplicity() | 1) == 1 && e.GetCount() > m_minCountTarget)
 			{
-				if (s_kmer.size() >= m_kmerSize && counter % m_iterKmers == 0 && val > m_minCountTarget)
+				mergedKmer m;
+				m.Kmer = (uint64_t) key * HTSIZE + b;
+				if (e.Reversed())
+				{	getReverseComplement(m.Kmer, m_kmerSize, m.Kmer);	}
+				m.Label = e.Label;
+				if (fwrite(&m, sizeof(mergedKmer), 1, fd_m[m.Kmer % HTSIZE * MERGEPARTS / HTSIZE]) != 1)
 				{
-					commonKmersHT.addElement(s_kmer, m_targetsID[t].id, (size_t) val);
-					counter = 0;
+					cerr << "Failed to write the k-mers of the database " << db << endl;
+					exit(1);
 				}
-				counter++;
-				continue;
+			}
+		}
+	}
+	for(size_t p = 0; p < files.size(); p++)
+	{	delete parts[p];	}
+	vector<mergedKmer> kmers;
+	size_t b = 0;
+	for(size_t r = 0; r < MERGEPARTS; r++)
+	{
+		kmers.resize(ftell(fd_m[r]) / sizeof(mergedKmer));
+		rewind(fd_m[r]);
+		if (!kmers.empty() && fread(&kmers.front(), sizeof(mergedKmer), kmers.size(), fd_m[r]) != kmers.size())
+		{
+			cerr << "Failed to read the k-mers of the database " << db << endl;
+			exit(1);
+		}
+		fclose(fd_m[r]);
+		sprintf(position, ".mg%lu", r);
+		remove((db + position).c_str());
+		std::sort(kmers.begin(), kmers.end());
+		size_t u = 0;
+		for(; b < HTSIZE && b * MERGEPARTS / HTSIZE == r; b++)
+		{
+			keys.clear();
+			lbls.clear();
+			for(; u < kmers.size() && kmers[u].Kmer % HTSIZE == b; u++)
+			{
+				keys.push_back(kmers[u].Kmer / HTSIZE);
+				lbls.push_back(kmers[u].Label);
+			}
+			const uint8_t size = index.push(keys.size());
+			fwrite(&size, 1, 1, fd_s);
+			if (!keys.empty())
+			{
+				fwrite(&keys.front(), sizeof(HKMERr), keys.size(), fd_k);
+				fwrite(&lbls.front(), sizeof(ILBL), lbls.size(), fd_l);
+			}
+			nbElement += keys.size();
+		}
+	}
+	fclose(fd_l);
+	fclose(fd_k);
+	fclose(fd_s);
+	index.write(db);
+	index.writeLong(db + ".sx");
+	free(cfname);
+	cfname = NULL;
+	cerr << "Mother Hashtable successfully merged. " << nbMother << " " << m_kmerSize << "-mers stored." << endl;
+	cerr << nbElement << " " << m_kmerSize << "-mers successfully stored in database." << endl;
+}
+
+	template <typename HKMERr>
+void CLARK<HKMERr>::extractSpecificTargetSets(const char* _targets, const char* _folder) const
+{
+	// Database of the labels of this targets file from the database of the targets _targets in _folder (same
+	// settings): its files (or its container) are read by blocks of buckets, and only the k-mers of these labels
+	// are kept, with the IDs of this targets file. The buckets are the same (HTSIZE), the keys and labels fewer.
+	FILE * fd = fopen(_targets, "r");
+	if (fd == NULL)
+	{
+		cerr << "Failed to open targets data in file: " << _targets << endl;
+		exit(1);
+	}
+	// Labels of the source targets, in the order of getTargetsData
+	vector<string> names(1, "NA"), ele;
+	std::map<string, ILBL> ids;
+	for(size_t l = 0; l < m_labels.size(); l++)
+	{	ids[m_labels[l]] = l;	}
+	std::vector<char> sep;
+	sep.push_back(' ');
+	sep.push_back('\t');
+	sep.push_back('\r');
+	string line;
+	while (getLineFromFile(fd, line))
+	{
+		ele.clear();
+		getElementsFromLine(line, sep, ele);
+		if (ele.size() > 2)
+		{
+			cerr << "The extraction of a database is not available with centromere labels." << endl;
+			exit(1);
+		}
+		if (ele.size() > 1 && std::find(names.begin(), names.end(), ele[1]) == names.end())
+		{	names.push_back(ele[1]);	}
+	}
+	fclose(fd);
+	vector<ILBL> labels(names.size() - 1, NOLABEL);
+	size_t nbKept = 0;
+	for(size_t l = 0; l < labels.size(); l++)
+	{
+		std::map<string, ILBL>::const_iterator it = ids.find(names[l + 1]);
+		if (it != ids.end())
+		{
+			labels[l] = it->second;
+			nbKept++;
+		}
+	}
+	if (nbKept < m_labels.size())
+	{	cerr << "Warning: " << m_labels.size() - nbKept << " label(s) of the targets are not in " << _targets << ": no k-mer for them." << endl;	}
+	cerr << "Warning: the k-mers extracted are specific with respect to all the targets of " << _targets << ". The k-mers shared" << endl;
+	cerr << "only by targets kept are missing (a database built from the targets kept would have them)." << endl;
+
+	char * cfname = (char*) calloc(MXNMLEN, sizeof(char));
+	string folder(_folder);
+	if (folder[folder.size()-1] != '/')
+	{	folder.push_back('/');	}
+	getdbName(cfname, 0, folder.c_str(), labels.size());
+	const string source(cfname);
+	getdbName(cfname);
+	const string db(cfname);
+	free(cfname);
+	cfname = NULL;
+	// Source: legacy files, or container
+	dbContainer container;
+	FILE * fd_ss = fopen((source + ".sz").c_str(), "r");
+	FILE * fd_sk = fopen((source + ".ky").c_str(), "r");
+	FILE * fd_sl = fopen((source + ".lb").c_str(), "r");
+	const bool legacy = fd_ss != NULL && fd_sk != NULL && fd_sl != NULL;
+	vector<uint8_t> sizes(legacy ? HTSIZE: 0);
+	loadIndex index;
+	if (legacy)
+	{
+		if (fread(&sizes.front(), 1, HTSIZE, fd_ss) != HTSIZE || !index.readLong(source + ".sx"))
+		{
+			cerr << "Failed to read the database " << source << endl;
+			exit(1);
+		}
+		index.build(&sizes.front(), HTSIZE, m_nbCPU);
+	}
+	else
+	{
+		dbContainer::Header settings;
+		getdbSettings(settings);
+		string reason;
+		if (!container.open(source + CDBEXT, m_nbCPU, true) || !container.isCompatible(settings, names, reason))
+		{
+			cerr << "Failed to find the database of " << _targets << " in " << folder << " with these settings: " << source << ".*" << endl;
+			exit(1);
+		}
+		index.setLong((const std::pair<uint64_t, uint64_t>*) container.getSection(CDB_LONG), container.getHeader().sections[CDB_LONG].length / sizeof(std::pair<uint64_t, uint64_t>));
+		index.build(container.getSection(CDB_SIZES), HTSIZE, m_nbCPU);
+	}
+	cerr << "Extracting the database of " << m_labels.size() << " label(s) from " << source << "..." << endl;
+	FILE * fd_l = fopen((db + ".lb").c_str(), "w+");
+	FILE * fd_k = fopen((db + ".ky").c_str(), "w+");
+	FILE * fd_s = fopen((db + ".sz").c_str(), "w+");
+	if (fd_l == NULL || fd_k == NULL || fd_s == NULL)
+	{
+		cerr << "Failed to create the database " << db << endl;
+		exit(1);
+	}
+	vector<HKMERr> blockKeys(1), keys;
+	vector<ILBL> blockLabels(1), lbls;
+	vector<uint32_t> bucketSizes(IXBLOCK);
+	vector<uint8_t> newSizes(IXBLOCK);
+	loadIndex newIndex;
+	uint64_t nbElement = 0;
+	for(size_t b = 0; b < index.getNbBlocks(); b++)
+	{
+		const size_t len = b + 1 < index.getNbBlocks() ? IXBLOCK: HTSIZE - b * IXBLOCK;
+		const size_t n = index.getElements(b + 1) - index.getElements(b);
+		const uint8_t* bytes = legacy ? &sizes.front() + b * IXBLOCK: container.getSection(CDB_SIZES) + b * IXBLOCK;
+		const HKMERr* k = NULL;
+		const ILBL* l = NULL;
+		if (blockKeys.size() < n)
+		{
+			blockKeys.resize(n);
+			blockLabels.resize(n);
+		}
+		if (legacy)
+		{
+			if (n > 0 && (fread(&blockKeys.front(), sizeof(HKMERr), n, fd_sk) != n || fread(&blockLabels.front(), sizeof(ILBL), n, fd_sl) != n))
+			{
+				cerr << "Failed to read the database " << source << endl;
+				exit(1);
+			}
+		}
+		else if (container.getHeader().format == CDB_PACKED)
+		{	container.unpackBlock(b, bytes, len, index, &blockKeys.front(), &blockLabels.front());	}
+		k = legacy || container.getHeader().format == CDB_PACKED ? &blockKeys.front(): (const HKMERr*) container.getSection(CDB_KEYS) + index.getElements(b);
+		l = legacy || container.getHeader().format == CDB_PACKED ? &blockLabels.front(): (const ILBL*) container.getSection(CDB_LABELS) + index.getElements(b);
+		index.getSizes(b, bytes, len, &bucketSizes.front());
+		keys.clear();
+		lbls.clear();
+		for(size_t t = 0, v = 0; t < len; t++)
+		{
+			const size_t before = keys.size();
+			for(size_t u = 0; u < bucketSizes[t]; u++, v++)
+			{
+				if (l[v] < labels.size() && labels[l[v]] != NOLABEL)
+				{
+					keys.push_back(k[v]);
+					lbls.push_back(labels[l[v]]);
+				}
+			}
+			newSizes[t] = newIndex.push(keys.size() - before);
+		}
+		fwrite(&newSizes.front(), 1, len, fd_s);
+		if (!keys.empty())
+		{
+			fwrite(&keys.front(), sizeof(HKMERr), keys.size(), fd_k);
+			fwrite(&lbls.front(), sizeof(ILBL), lbls.size(), fd_l);
+		}
+		nbElement += keys.size();
+	}
+	if (fd_ss != NULL)
+	{	fclose(fd_ss);	}
+	if (fd_sk != NULL)
+	{	fclose(fd_sk);	}
+	if (fd_sl != NULL)
+	{	fclose(fd_sl);	}
+	fclose(fd_l);
+	fclose(fd_k);
+	fclose(fd_s);
+	newIndex.write(db);
+	newIndex.writeLong(db + ".sx");
+	cerr << nbElement << " " << m_kmerSize << "-mers successfully stored in database (" << index.getElements() << " in the source)." << endl;
+}
+
+	template <typename HKMERr>
+bool CLARK<HKMERr>::updateSpecificTargetSets(const bool& _dbPresent) const
+{
+	// Mother table of the previous build (motherIndex) updated with the targets removed (their k-mers taken
+	// out) and added, then saved and reduced as in makeSpecificTargetSets. False when a full build is needed.
+	char * cfname = (char*) calloc(MXNMLEN, sizeof(char));
+	getIndexName(cfname);
+	const string file(cfname);
+	motherIndex index;
+	if (!index.open(file, m_kmerSize, m_syncmer.getS(), sizeof(HKMERr), sizeof(htCell<HKMERr, lElement>)))
+	{
+		cerr << "No index of a previous build [" << file << "]: the next build will save it." << endl;
+		free(cfname);
+		return _dbPresent;
+	}
+	// Targets compared by file, position and label
+	std::map<string, string> previous, current;
+	char position[64];
+	for(size_t t = 0; t < index.getTargets().size(); t++)
+	{	previous[index.getTargets()[t]] = index.getIds()[t];	}
+	vector<size_t> added;
+	vector<Target> removed;
+	for(size_t t = 0; t < m_targetsID.size(); t++)
+	{
+		sprintf(position, "\t%lu\t%lu", m_targetsID[t].offset, m_targetsID[t].length);
+		const string key = m_targetsID[t].filePath + position;
+		current[key] = m_targetsID[t].id;
+		std::map<string, string>::const_iterator it = previous.find(key);
+		if (it == previous.end() || it->second != m_targetsID[t].id)
+		{	added.push_back(t);	}
+	}
+	for(std::map<string, string>::const_iterator it = previous.begin(); it != previous.end(); it++)
+	{
+		std::map<string, string>::const_iterator jt = current.find(it->first);
+		if (jt == current.end() || jt->second != it->second)
+		{
+			Target target;
+			const size_t p = it->first.find('\t');
+			target.filePath = it->first.substr(0, p);
+			sscanf(it->first.c_str() + p, "\t%lu\t%lu", &target.offset, &target.length);
+			target.id = it->second;
+			removed.push_back(target);
+		}
+	}
+	if (added.empty() && removed.empty() && _dbPresent)
+	{
+		free(cfname);
+		return true;
+	}
+	cerr << "Updating the database from the index of the previous build: " << added.size() << " target(s) added, " << removed.size() << " removed..." << endl;
+	EHashtable<HKMERr, lElement> commonKmersHT(m_kmerSize, m_labels, m_labels_c);
+	commonKmersHT.SetLineage(m_parents);
+	// Labels of the previous build renamed. The labels no longer used (all their targets removed or relabelled)
+	// are marked gone: their k-mers are dropped in place, or stay common when shared with other labels.
+	vector<ILBL> labels(index.getLabels().size());
+	const ILBL gone = m_labels.size();
+	size_t nbGone = 0;
+	for(size_t l = 0; l < labels.size(); l++)
+	{
+		if (!commonKmersHT.getTargetID(index.getLabels()[l], labels[l]))
+		{
+			labels[l] = gone;
+			nbGone++;
+		}
+	}
+	if (!index.readTable(commonKmersHT, labels))
+	{
+		cerr << "Failed to read the index " << file << ": the database will be rebuilt." << endl;
+		free(cfname);
+		return false;
+	}
+	size_t nt = 0, kept = 0;
+	if (nbGone > 0)
+	{
+		const size_t dropped = commonKmersHT.RemoveLabel(gone, 0, kept);
+		cerr << nbGone << " label(s) no longer used: " << dropped << " of their " << m_kmerSize << "-mers removed." << endl;
+	}
+	ILBL tgt_id;
+	for(size_t t = 0; t < removed.size(); t++)
+	{
+		if (!commonKmersHT.getTargetID(removed[t].id, tgt_id))
+		{	continue;	}
+		TargetReader targetReader(removed[t]);
+		if (!targetReader.open() || !addTargetKmers(targetReader, commonKmersHT, removed[t].id, tgt_id, 0, nt, &kept))
+		{
+			// Without its sequences, the k-mers of the target are unknown
+			cerr << "Failed to read the sequences of the removed target " << removed[t].filePath << ": the database will be rebuilt." << endl;
+			free(cfname);
+			return false;
+		}
+		targetReader.close();
+		cerr << "\r Progress report: (" <<t+1<< "/"<<removed.size()<<" removed)              ";
+	}
+	if (kept > 0)
+	{
+		// Labels of the other occurrences unknown: these k-mers stay common (a full build may find them specific)
+		cerr << endl << kept << " occurrences of k-mers of the removed targets are shared with other labels and stay common (run without --incremental for an exact database)." << endl;
+	}
+	for(size_t t = 0; t < added.size(); t++)
+	{
+		const Target& target = m_targetsID[added[t]];
+		TargetReader targetReader(target);
+		if (!targetReader.open())
+		{
+			cerr << "Failed to open " << target.filePath << endl;
+			continue;
+		}
+		commonKmersHT.getTargetID(target.id, tgt_id);
+		if (!addTargetKmers(targetReader, commonKmersHT, target.id, tgt_id, 0, nt))
+		{
+			targetReader.reset();
+			string s_kmer = "";
+			ITYPE val = 0;
+			while (targetReader.getFirstAndSecondElementInLine(s_kmer, val))
+			{	if (s_kmer.size() >= m_kmerSize && val > m_minCountTarget)
+				{	commonKmersHT.addElement(s_kmer, target.id, (size_t) val);}
+			}
+		}
+		targetReader.close();
+		cerr << "\r Progress report: (" <<t+1<< "/"<<added.size()<<" added)              ";
+	}
+	cerr << nt << " nt read in total." << endl;
+	cerr << "Mother Hashtable successfully updated. " << commonKmersHT.Size() << " " << m_kmerSize << "-mers stored." <<  endl;
+
+	commonKmersHT.SortAllHashTable(2);
+	writeIndex(commonKmersHT);
+	commonKmersHT.RemoveCommon(m_labels_c, m_minCountTarget);
+	getdbName(cfname);
+	cerr << "Creating database in disk..." << endl;
+	uint64_t nbElement = commonKmersHT.Write(cfname,2);
+	cerr << nbElement << " " << m_kmerSize << "-mers successfully stored in database." << endl;
+	free(cfname);
+	cfname = NULL;
+	char note[256];
+	sprintf(note, "%lu target(s) added, %lu removed, %lu occurrence(s) of k-mers kept common", added.size(), removed.size(), kept);
+	noteUpdate(note);
+	return true;
+}
+
+	template <typename HKMERr>
+void CLARK<HKMERr>::noteUpdate(const std::string& _note) const
+{
+	// Updates of the database since its last full build (<db>.upd, one line each), printed as a warning when
+	// it is loaded: an updated database can differ from a full build. A full build (empty _note) removes it.
+	char * cfname = (char*) calloc(MXNMLEN, sizeof(char));
+	getdbName(cfname);
+	const string file = string(cfname) + ".upd";
+	free(cfname);
+	if (_note.empty())
+	{
+		std::remove(file.c_str());
+		return;
+	}
+	FILE * fd = fopen(file.c_str(), "a");
+	if (fd == NULL || fprintf(fd, "%s\n", _note.c_str()) < 0 || fclose(fd) != 0)
+	{	cerr << "Failed to write " << file << ": the database will be loaded without the warning of its update." << endl;	}
+}
+
+	template <typename HKMERr>
+void CLARK<HKMERr>::makeSpacedTargetSets()
+{
+	// One table for all the seeds, written once then loaded as any database: merged from the databases of
+	// the seeds when present (converter), computed from the database of contiguous k-mers otherwise.
+	char * cfname = (char*) calloc(MXNMLEN, sizeof(char));
+	char * cfname_c = (char*) calloc(MXNMLEN, sizeof(char));
+	const size_t sizeHTS = m_labels.size() + m_labels_c.size();
+	vector<string> names;
+	bool seedsPresent = true;
+	for(size_t u = 0; u < m_DSS.size(); u++)
+	{
+		getdbName(cfname_c, u+1);
+		names.push_back(string(cfname_c));
+		seedsPresent = seedsPresent && access((names.back() + ".sz").c_str(), R_OK) == 0;
+	}
+	sprintf(cfname_c,"%sdb_central_k%lu_t%lu_s%lu_m%lu.tsk",m_folder,(size_t)m_kmerSize,sizeHTS,(size_t) HTSIZE,(size_t)m_minCountTarget);
+	getdbName(cfname);
+	hTable<HKMERr, bigElement> merged;
+	if (seedsPresent && m_DSS.size() == NBSEEDS)
+	{
+		size_t fileSize = 0;
+		cerr << "Merging the databases of spaced k-mers... " << endl;
+		merged.addDB(names, fileSize, 1);
+	}
+	else if (access((string(cfname_c) + ".sz").c_str(), R_OK) == 0)
+	{
+		cerr << "Creating the database of discriminative spaced k-mers from [" << cfname_c << ".*] ..." << endl;
+		// Key of the contiguous k-mers: k-mer / HTSIZE
+		const size_t t_b = log(HTSIZE)/log(4.0);
+		const bool done = m_kmerSize <= t_b + 16 ? contiguousTospaced<T32, HKMERr>::populate(cfname_c, m_DSS, merged, m_nbCPU):
+					contiguousTospaced<T64, HKMERr>::populate(cfname_c, m_DSS, merged, m_nbCPU);
+		if (!done)
+		{
+			cerr << "Failed to read the database of discriminative " << m_kmerSize << "-mers [" << cfname_c << ".*]" << endl;
+			exit(1);
+		}
+	}
+	else
+	{
+		cerr << "The program cannot find databases of discriminative spaced k-mers, nor the database of discriminative " << m_kmerSize << "-mers to compute them." << endl;
+		cerr << "Please run CLARK (-k " << m_kmerSize << ") with the same targets and directory first."<< endl;
+		exit(1);
+	}
+	const uint64_t nbElement = merged.write(cfname, 0, true);
+	cerr << "Database of spaced k-mers [" << cfname << ".*] written (" << nbElement << " spaced k-mers stored)" << endl;
+#ifdef _OPENMP
+	omp_set_num_threads(m_nbCPU);
+#endif
+	free(cfname);
+	free(cfname_c);
+	cfname = NULL;
+	cfname_c = NULL;
+}
+
+template <typename HKMERr>
+void CLARK<HKMERr>::getdbSettings(dbContainer::Header& _settings) const
+{
+	memset(&_settings, 0, sizeof(dbContainer::Header));
+	_settings.nbBuckets 	= HTSIZE;
+	_settings.k 		= m_kmerSize;
+	_settings.keyBytes 	= sizeof(HKMERr);
+	_settings.labelBytes 	= sizeof(ILBL);
+	_settings.minCount 	= m_minCountTarget;
+	_settings.iterKmers 	= m_isLightLoading ? m_iterKmers: 0;
+	_settings.format 	= m_dbFormat;
+	snprintf(_settings.program, sizeof(_settings.program), "CLARK %s", VERSION);
+}
+
+template <typename HKMERr>
+bool CLARK<HKMERr>::checkContainer(const bool& _legacyPresent)
+{
+	// The container must match the settings and the targets; legacy files are converted into one
+	char * cfname = (char*) calloc(MXNMLEN, sizeof(char));
+	getdbName(cfname);
+	const std::string file = std::string(cfname) + CDBEXT;
+	free(cfname);
+	dbContainer::Header settings;
+	getdbSettings(settings);
+	dbContainer container;
+	std::string reason;
+	if (container.readHeader(file))
+	{
+		if (container.isCompatible(settings, m_targetsName, reason))
+		{	return true;	}
+		cerr << "The database container " << file << " is obsolete (different " << reason << "). The program will rebuild it." << endl;
+		return false;
+	}
+	if (_legacyPresent)
+	{
+		cerr << "Converting the database files into the container " << file << "..." << endl;
+		packContainer(false);
+	}
+	return _legacyPresent;
+}
+
+template <typename HKMERr>
+void CLARK<HKMERr>::packContainer(const bool& _removeLegacy)
+{
+	char * cfname = (char*) calloc(MXNMLEN, sizeof(char));
+	getdbName(cfname);
+	const std::string db(cfname);
+	free(cfname);
+	dbContainer::Header settings;
+	getdbSettings(settings);
+	if (!dbContainer::convert(db, settings, m_targetsName, m_nbCPU))
+	{
+		cerr << "Failed to write the database container " << db << CDBEXT << endl;
+		exit(-1);
+	}
+	if (_removeLegacy)
+	{
+		const char* ext[4] = {".sz", ".ky", ".lb", ".ix"};
+		for(size_t e = 0; e < 4; e++)
+		{	remove((db + ext[e]).c_str());	}
+	}
+}
+
+	template <typename HKMERr>
+void CLARK<HKMERr>::loadSpecificTargetSets(const vector<string>& _filesHT, 
+		const vector<string>& 	_filesHTC, 
+		const size_t& 		_sizeMotherHT,
+		const ITYPE& 		_samplingFactor,	
+		const bool&  		_mmapLoading
+		)
+{
+	size_t kmersLoaded = 0;
+	ITYPE minCount = m_minCountTarget;
+	m_centralHt = new EHashtable<HKMERr, bigElement>(m_weight, m_labels, m_labels_c, m_DSS);
+	m_centralHt->SetPlacement(m_numaPolicy);
+	m_centralHt->SetPages(m_pages);
+	m_centralHt->SetShared(m_sharedMemory);
+	m_centralHt->SetContainer(m_container);
+	char * cfname = (char*) calloc(MXNMLEN, sizeof(char));
+	size_t fileSize = 0;
+
+	getdbName(cfname);
+	cerr << "Loading database [" << cfname << ".*] ..." << endl;
+	FILE * fd = fopen((string(cfname) + ".upd").c_str(), "r");
+	if (fd != NULL)
+	{
+		// Updated with --incremental (see noteUpdate)
+		string line;
+		cerr << "Warning: the database was updated since its last full build, and can differ from it:" << endl;
+		while (getLineFromFile(fd, line))
+		{	cerr << " - " << line << endl;	}
+		fclose(fd);
+		cerr << "K-mers shared with removed targets can stay common, and the ones kept can be in another orientation (sampling factor)." << endl;
+		cerr << "Build the database without '--incremental' for an exact one." << endl;
+	}
+	if (m_centralHt->Read(cfname, fileSize, m_nbCPU, _samplingFactor, _mmapLoading))
+	{
+		cerr << "Loading done (database size: " << fileSize / 1000000<<" MB read, with sampling factor " << _samplingFactor << ")" << endl;
+		free(cfname);
+		cfname = NULL;
+		return;
+	}
+	if ( _filesHT.size() + _filesHTC.size() == 0)
+	{
+		cerr << "Failed to find the database." << endl;
+		exit(-1);	
+	}
+}
+
+	template <typename HKMERr>
+	template <typename ELMTr>
+bool CLARK<HKMERr>::addTargetKmers(TargetReader& _reader, EHashtable<HKMERr, ELMTr>& _ht, const std::string& _id, const ILBL& _tgt_id, const size_t& _gap, size_t& _nt, size_t* _kept) const
+{
+	switch (m_kmerSize)
+	{
+		case 20: return addTargetKmers<20, ELMTr>(_reader, _ht, _id, _tgt_id, _gap, _nt, _kept);
+		case 27: return addTargetKmers<27, ELMTr>(_reader, _ht, _id, _tgt_id, _gap, _nt, _kept);
+		case 31: return addTargetKmers<31, ELMTr>(_reader, _ht, _id, _tgt_id, _gap, _nt, _kept);
+		case 32: return addTargetKmers<32, ELMTr>(_reader, _ht, _id, _tgt_id, _gap, _nt, _kept);
+		default: return addTargetKmers<0, ELMTr>(_reader, _ht, _id, _tgt_id, _gap, _nt, _kept);
+	}
+}
+
+	template <typename HKMERr>
+	template <size_t K, typename ELMTr>
+bool CLARK<HKMERr>::addTargetKmers(TargetReader& _reader, EHashtable<HKMERr, ELMTr>& _ht, const std::string& _id, const ILBL& _tgt_id, const size_t& _gap, size_t& _nt, size_t* _kept) const
+{
+	// Adds the k-mers of a fasta/fastq target. With a gap (light database), only one non-overlapping
+	// k-mer out of _gap is added. With _kept, their occurrences are taken out instead (EHashtable::removeElement)
+	// and _kept counts the k-mers left as they are.
+	// Returns false if the file is neither a fasta nor a fastq file.
+	char c[MAXRSIZE];
+	size_t len = _reader.readChunk(c), i = 0, s = 0, j = 0;
+	if (len == 0 || (c[0] != '>' && c[0] != '@'))
+	{	return false;	}
+	const bool	fastq 	= c[0] == '@';
+	readEncoder	encoder;
+	kmerRoller<K>	roller(m_kmerSize);
+	uint64_t 	iter 	= 0;
+	// Line being read: 0 for a header, 1 for a sequence, 2 and 3 for the fastq separator and qualities
+	uint8_t 	line 	= 0;
+	while (len != 0)
+	{
+		i = 0;
+		while (i < len)
+		{
+			if (line != 1)
+			{
+				while (i < len && c[i] != '\n')
+				{	i++;	}
+				if (i == len)
+				{	break;	}
+				i++;
+				line = line == 0 ? 1 : (line + 1) % 4;
+				continue;
+			}
+			s = i;
+			while (i < len && c[i] != '\n' && (fastq || c[i] != '>'))
+			{	i++;	}
+			encoder.encode((const uint8_t*) c + s, i - s);
+			const uint8_t* codes = encoder.getCodes();
+			for(j = 0; j < encoder.size(); j++)
+			{
+				_nt++;
+				if (encoder.isAmbiguous(j))
+				{	roller.reset();
+					continue;	}
+				if (!roller.push(codes[j]))
+				{	continue;	}
+				if (m_syncmer.isEnabled() && !m_syncmer.isSelected(roller.getFwd(), roller.getRvs()))
+				{	continue;	}
+				if (_gap > 0)
+				{
+					if (iter++ % _gap == 0)
+					{	_ht.addElement(roller.getRvs(), _id, _tgt_id, 1);	}
+					roller.reset();
+					continue;
+				}
+				if (_kept != NULL)
+				{	*_kept += _ht.removeElement(roller.isFirst() ? roller.getRvs() : roller.getFwd(), _tgt_id, 1) ? 0: 1;
+					continue;	}
+				if (m_partial)
+				{	// Canonical orientation: a k-mer is in the same bucket of the tables of all partial builds.
+					// The orientation of a single build (first occurrence) is kept for the merge.
+					const uint64_t& key = roller.isFirst() ? roller.getRvs() : roller.getFwd();
+					const uint64_t& canonical = roller.getFwd() < roller.getRvs() ? roller.getFwd(): roller.getRvs();
+					_ht.addElement(canonical, _id, _tgt_id, 1, key != canonical);
+					continue;	}
+				_ht.addElement(roller.isFirst() ? roller.getRvs() : roller.getFwd(), _id, _tgt_id, 1);
+			}
+			if (i == len)
+			{	break;	}
+			if (fastq)
+			{	// End of the read
+				roller.reset();
+				line = 2;
+				i++;
+				continue;
+			}
+			if (c[i] == '>')
+			{	roller.reset();
+				line = 0;
+				continue;
+			}
+			i++;
+		}
+		len = _reader.readChunk(c);
+	}
+	return true;
+}
+
+	template <typename HKMERr>
+std::string CLARK<HKMERr>::getCheckpointName() const
+{
+	// Partial builds of other shares in the directory have other journals (see getIndexName)
+	char * cfname = (char*) calloc(MXNMLEN, sizeof(char));
+	if (m_partial)
+	{	getIndexName(cfname);	}
+	else
+	{	getdbName(cfname);	}
+	const string file = string(cfname) + ".ckp";
+	free(cfname);
+	return file;
+}
+
+	template <typename HKMERr>
+void CLARK<HKMERr>::checkpointBuild(EHashtable<HKMERr, lElement>& _ht, const size_t& _cursor, const size_t& _nt, buildCheckpoint& _journal) const
+{
+	// State of the build after the first _cursor targets appended to the journal (see buildCheckpoint) by
+	// the building thread: only the buckets changed since the previous checkpoint are written.
+	vector<string> targets, ids;
+	char position[64];
+	for(size_t t = 0; t < _cursor; t++)
+	{
+		sprintf(position, "\t%lu\t%lu", m_targetsID[t].offset, m_targetsID[t].length);
+		targets.push_back(m_targetsID[t].filePath + position);
+		ids.push_back(m_targetsID[t].id);
+	}
+	if (!_journal.write(_ht, targets, ids, _nt))
+	{	cerr << "Failed to write the checkpoint of the build (the build goes on)." << endl;	}
+}
+
+	template <typename HKMERr>
+size_t CLARK<HKMERr>::resumeBuild(EHashtable<HKMERr, lElement>& _ht, size_t& _nt, buildCheckpoint& _journal) const
+{
+	// Table and bases read of the last checkpoint restored when its targets are the first ones of the
+	// targets file (same files, positions and labels). Returns the number of targets already processed.
+	vector<string> targets, ids;
+	char position[64];
+	for(size_t t = 0; t < m_targetsID.size(); t++)
+	{
+		sprintf(position, "\t%lu\t%lu", m_targetsID[t].offset, m_targetsID[t].length);
+		targets.push_back(m_targetsID[t].filePath + position);
+		ids.push_back(m_targetsID[t].id);
+	}
+	size_t cursor = 0;
+	uint64_t nt = 0;
+	if (!_journal.restore(_ht, targets, ids, cursor, nt))
+	{	exit(1);	}
+	if (cursor > 0)
+	{
+		_nt = nt;
+		cerr << "Resuming the build from its checkpoint: " << cursor << " target(s) already processed (" << nt << " nt)." << endl;
+	}
+	return cursor;
+}
+
+	template <typename HKMERr>
+bool CLARK<HKMERr>::fingerprintTarget(TargetReader& _reader, sequenceFingerprint& _fingerprint) const
+{
+	// Fingerprint of the sequences of a fasta/fastq target, read as in addTargetKmers.
+	// Returns false if the file is neither a fasta nor a fastq file.
+	char c[MAXRSIZE];
+	size_t len = _reader.readChunk(c), i = 0, s = 0;
+	if (len == 0 || (c[0] != '>' && c[0] != '@'))
+	{	return false;	}
+	const bool	fastq 	= c[0] == '@';
+	readEncoder	encoder;
+	uint8_t 	line 	= 0;
+	while (len != 0)
+	{
+		i = 0;
+		while (i < len)
+		{
+			if (line != 1)
+			{
+				while (i < len && c[i] != '\n')
+				{	i++;	}
+				if (i == len)
+				{	break;	}
+				i++;
+				line = line == 0 ? 1 : (line + 1) % 4;
+				continue;
+			}
+			s = i;
+			while (i < len && c[i] != '\n' && (fastq || c[i] != '>'))
+			{	i++;	}
+			encoder.encode((const uint8_t*) c + s, i - s);
+			_fingerprint.append(encoder);
+			if (i == len)
+			{	break;	}
+			if (fastq)
+			{
+				_fingerprint.endRecord();
+				line = 2;
+				i++;
+				continue;
+			}
+			if (c[i] == '>')
+			{
+				_fingerprint.endRecord();
+				line = 0;
+				continue;
+			}
+			i++;
+		}
+		len = _reader.readChunk(c);
+	}
+	_fingerprint.endRecord();
+	return true;
+}
+
+	template <typename HKMERr>
+bool CLARK<HKMERr>::sameTargets(const size_t& _kept, const size_t& _target, std::vector<uint8_t>& _sequence, size_t& _tracked) const
+{
+	// Sequences of the target _target compared with those of _kept, kept in _sequence (_tracked is the
+	// target they are of, so a target kept with several duplicates is read once)
+	sequenceFingerprint fingerprint;
+	if (_tracked != _kept)
+	{
+		_sequence.clear();
+		_tracked = m_targetsID.size();
+		TargetReader targetReader(m_targetsID[_kept]);
+		if (!targetReader.open())
+		{	return false;	}
+		fingerprint.track(&_sequence);
+		const bool read = fingerprintTarget(targetReader, fingerprint);
+		targetReader.close();
+		if (!read)
+		{	return false;	}
+		_tracked = _kept;
+	}
+	TargetReader targetReader(m_targetsID[_target]);
+	if (!targetReader.open())
+	{	return false;	}
+	sequenceFingerprint other;
+	other.track(&_sequence, true);
+	const bool read = fingerprintTarget(targetReader, other);
+	targetReader.close();
+	return read && other.same();
+}
+
+	template <typename HKMERr>
+void CLARK<HKMERr>::findDuplicateTargets(std::vector<bool>& _duplicate) const
+{
+	// Pre-pass over the targets (in parallel): a target with the same label, length and fingerprint as
+	// a previous one of the targets file, and the same sequences, gives no new k-mer, so it is marked in
+	// _duplicate to be skipped. The pairs are reported in <db>.dup (duplicate, target kept, label).
+	cerr << "Fingerprinting the targets to skip the exact duplicates..." << endl;
+	vector< std::pair<uint64_t, uint64_t> > prints(m_targetsID.size(), std::make_pair(0, 0));
+	vector<bool> valid(m_targetsID.size(), false);
+#pragma omp parallel for schedule(dynamic)
+	for(size_t t = 0; t < m_targetsID.size(); t++)
+	{
+		TargetReader targetReader(m_targetsID[t]);
+		if (!targetReader.open())
+		{	continue;	}
+		sequenceFingerprint fingerprint;
+		if (fingerprintTarget(targetReader, fingerprint))
+		{
+			prints[t] = std::make_pair(fingerprint.getHash(), fingerprint.size());
+#pragma omp critical
+			valid[t] = true;
+		}
+		targetReader.close();
+	}
+	char * cfname = (char*) calloc(MXNMLEN, sizeof(char));
+	getdbName(cfname);
+	const string report = string(cfname) + ".dup";
+	free(cfname);
+	cfname = NULL;
+	FILE * fd = fopen(report.c_str(), "w");
+	if (fd == NULL)
+	{
+		cerr << "Failed to create " << report << endl;
+		exit(1);
+	}
+	std::map< std::pair<string, std::pair<uint64_t, uint64_t> >, size_t > first;
+	size_t nbDuplicates = 0, nbCollisions = 0, tracked = m_targetsID.size();
+	uint64_t nt = 0;
+	vector<uint8_t> sequence;
+	for(size_t t = 0; t < m_targetsID.size(); t++)
+	{
+		if (!valid[t])
+		{	continue;	}
+		const std::pair<string, std::pair<uint64_t, uint64_t> > key(m_targetsID[t].id, prints[t]);
+		std::map< std::pair<string, std::pair<uint64_t, uint64_t> >, size_t >::const_iterator it = first.find(key);
+		if (it == first.end())
+		{
+			first[key] = t;
+			continue;
+		}
+		if (!sameTargets(it->second, t, sequence, tracked))
+		{
+			// Same fingerprint, other sequences: the target is kept
+			nbCollisions++;
+			continue;
+		}
+		_duplicate[t] = true;
+		nbDuplicates++;
+		nt += prints[t].second;
+		fprintf(fd, "%s\t%s\t%s\n", m_targetsID[t].filePath.c_str(), m_targetsID[it->second].filePath.c_str(), m_targetsID[t].id.c_str());
+	}
+	fclose(fd);
+	cerr << nbDuplicates << " target(s) skipped as exact duplicates of a target of the same label (" << nt << " nt), listed in " << report << endl;
+	if (nbCollisions > 0)
+	{	cerr << nbCollisions << " target(s) of the same fingerprint as a previous one, but other sequences, kept." << endl;	}
+}
+
+	template <typename HKMERr>
+size_t CLARK<HKMERr>::makeSpecificTargetSets(const vector<string>& _filesHT, const vector<string>& _filesHTC) const
+{
+	size_t 	nt = 0;
+	vector<bool> duplicate(m_targetsID.size(), false);
+	if (m_dedup && m_minCountTarget == 0)
+	{	findDuplicateTargets(duplicate);	}
+	if (m_isLightLoading)
+	{
+		EHashtable<HKMERr, lElement> commonKmersHT(m_kmerSize, m_labels, m_labels_c);
+		buildCheckpoint journal(getCheckpointName(), m_kmerSize, m_syncmer.getS(), m_partial, sizeof(HKMERr), sizeof(htCell<HKMERr, lElement>));
+		time_t last = time(NULL);
+		const size_t first = m_resume ? resumeBuild(commonKmersHT, nt, journal): 0;
+		if (m_checkpoint > 0)
+		{	commonKmersHT.TrackChanges();	}
+		for(size_t t = first; t < m_targetsID.size(); t++)
+		{
+			if (m_checkpoint > 0 && t > first && difftime(time(NULL), last) >= 60.0 * m_checkpoint)
+			{
+				checkpointBuild(commonKmersHT, t, nt, journal);
+				last = time(NULL);
+			}
+			if (duplicate[t])
+			{	continue;	}
+			TargetReader targetReader(m_targetsID[t]);
+			if (!targetReader.open())
+			{	cerr << "Failed to open " << m_targetsID[t].filePath << endl;
+				continue;
+			}
+			ILBL tgt_id;
+			commonKmersHT.getTargetID(m_targetsID[t].id, tgt_id);
+			if (addTargetKmers(targetReader, commonKmersHT, m_targetsID[t].id, tgt_id, m_iterKmers, nt))
+			{
+				targetReader.close();
+				cerr << "\r Progress report: (" <<t+1<< "/"<<m_targetsID.size()<<")              ";
+				continue;
+			}
+			targetReader.reset();
+			string s_kmer = "";
+			ITYPE val = 0;
+			uint8_t counter = 0;
+			while (targetReader.getFirstAndSecondElementInLine(s_kmer, val))
+			{
+				if (s_kmer.size() >= m_kmerSize && counter % m_iterKmers == 0 && val > m_minCountTarget)
+				{
+					commonKmersHT.addElement(s_kmer, m_targetsID[t].id, (size_t) val);
+					counter = 0;
+				}
+				counter++;
+				continue;
 			}
 			targetReader.close();
 			cerr << "\r Progress report: (" <<t+1<< "/"<<m_targetsID.size()<<")              ";
@@ -1096,14 +2418,28 @@ size_t CLARK<HKMERr>::makeSpecificTargetSets(const vector<string>& _filesHT, con
 		free(cfname);
 		cfname = NULL;
 		cerr << nbElement << " " << m_kmerSize << "-mers successfully stored in database." << endl;
+		journal.remove();
 
 		return sizeMotherTable;
 	}
 	if (_filesHTC.size() + _filesHT.size() == 0)
 	{
 		EHashtable<HKMERr, lElement> commonKmersHT(m_kmerSize, m_labels, m_labels_c);
-		for(size_t t = 0 ; t < m_targetsID.size(); t++)
+		commonKmersHT.SetLineage(m_parents);
+		buildCheckpoint journal(getCheckpointName(), m_kmerSize, m_syncmer.getS(), m_partial, sizeof(HKMERr), sizeof(htCell<HKMERr, lElement>));
+		time_t last = time(NULL);
+		const size_t first = m_resume ? resumeBuild(commonKmersHT, nt, journal): 0;
+		if (m_checkpoint > 0)
+		{	commonKmersHT.TrackChanges();	}
+		for(size_t t = first; t < m_targetsID.size(); t++)
 		{
+			if (m_checkpoint > 0 && t > first && difftime(time(NULL), last) >= 60.0 * m_checkpoint)
+			{
+				checkpointBuild(commonKmersHT, t, nt, journal);
+				last = time(NULL);
+			}
+			if (duplicate[t])
+			{	continue;	}
 			TargetReader targetReader(m_targetsID[t]);
 			if (!targetReader.open())
 			{
@@ -1113,181 +2449,17 @@ size_t CLARK<HKMERr>::makeSpecificTargetSets(const vector<string>& _filesHT, con
 			{
 				ILBL tgt_id;
 				commonKmersHT.getTargetID(m_targetsID[t].id, tgt_id);
-				char c[MAXRSIZE];
-				size_t len = targetReader.readChunk(c), i = 0;
-				uint64_t _km_f = 0, _km_r = 0;
-				bool _isfull = false;
-				uint8_t cpt = 0;		
-				if (len > 0 && c[0] == '>')
-				{
-					while (len != 0)
-					{
-						while( i < len)
-						{
-							if (m_table[c[i]] >= 0)
-							{
-								nt++;
-								if (_isfull)
-								{
-									_km_f >>= 2;
-									_km_f += m_powerTable[cpt][m_table[c[i]]];
-
-									/////////////////////////////////////////////////////////////////////
-									commonKmersHT.addElement(_km_f, m_targetsID[t].id, tgt_id, 1);
-									///////////////////////////////////////////////////////////////////////
-									i++;
-									continue;
-								}
-								_km_r <<= 2;    
-								_km_r += 3 - m_table[c[i]];
-								if (cpt  == m_kmerSize -1)
-								{       
-									_isfull = true;
-									//[/////////////////////////////////////////////////////////////////////
-									commonKmersHT.addElement(_km_r, m_targetsID[t].id, tgt_id, 1);
-									//]//////////////////////////////////////////////////////////////////////
-									_km_f = _km_r;
-									// The following 6 lines come from Jellyfish source code
-									_km_f = ((_km_f >> 2)  & 0x3333333333333333UL) | ((_km_f & 0x3333333333333333UL) << 2);
-									_km_f = ((_km_f >> 4)  & 0x0F0F0F0F0F0F0F0FUL) | ((_km_f & 0x0F0F0F0F0F0F0F0FUL) << 4);
-									_km_f = ((_km_f >> 8)  & 0x00FF00FF00FF00FFUL) | ((_km_f & 0x00FF00FF00FF00FFUL) << 8);
-									_km_f = ((_km_f >> 16) & 0x0000FFFF0000FFFFUL) | ((_km_f & 0x0000FFFF0000FFFFUL) << 16);
-									_km_f = ( _km_f >> 32                        ) | ( _km_f                        << 32);
-									_km_f = (((uint64_t)-1) - _km_f) >> (64 - (m_k << 1));
-									i++;
-									continue;
-								}
-								cpt++;  i++;    
-								continue;
-							}
-							if (m_table[c[i]] == -10)
-							{	i++;
-								continue;   }
-							if (m_table[c[i]] == -1)
-							{	nt++; _km_r = 0; cpt = 0; _isfull = false; i++; 
-								continue;  }
-							if (m_table[c[i]] == -2)
-							{
-								_km_r = 0; cpt = 0; _isfull = false; 
-								while (len != 0)
-								{
-									while(i < len && c[i] != '\n')  {	i++;}
-									if (i < len)		{   break;}
-									len = targetReader.readChunk(c);
-									i = 0;
-								}
-								i++;   
-								continue;
-							}
-							cerr << m_targetsID[t].filePath << ": " ;
-							cerr << "Failed to process sequence -- wrong character found [ASCII]: " << (size_t) c << endl;
-						}
-						len = targetReader.readChunk(c);
-						i = 0;
-					}
-					targetReader.close();
-					cerr << "\r Progress report: (" <<t+1<< "/"<<m_targetsID.size()<<")    ";
-					continue;	
-				}
-				if (len > 0 && c[0] == '@')
+				if (addTargetKmers(targetReader, commonKmersHT, m_targetsID[t].id, tgt_id, 0, nt))
 				{
-					i = 0;
-					while (len != 0)
-					{
-						while(i < len && c[i] != '\n')            {	i++;}
-						if (i < len)      {   break;}
-						len = targetReader.readChunk(c);
-						i = 0;
-					}
-					i++;
-					while (len != 0)
-					{
-						while( i < len)
-						{
-							if (m_table[c[i]] >= 0)
-							{
-								nt++;
-								if (_isfull)
-								{
-									_km_f >>= 2; 
-									_km_f += m_powerTable[cpt][m_table[c[i]]];
-									/////////////////////////////////////////////////////////////////////
-									commonKmersHT.addElement(_km_f, m_targetsID[t].id,  tgt_id, 1);
-									///////////////////////////////////////////////////////////////////////
-									i++;    
-									continue;
-								}
-								_km_r <<= 2;    
-								_km_r += 3 - m_table[c[i]];
-								if ( cpt  == m_kmerSize - 1)
-								{       _isfull = true;
-									//[/////////////////////////////////////////////////////////////////////
-									commonKmersHT.addElement(_km_r, m_targetsID[t].id, tgt_id, 1);
-									//]//////////////////////////////////////////////////////////////////////
-									_km_f = _km_r;
-									// The following 6 lines come from Jellyfish source code
-									_km_f = ((_km_f >> 2)  & 0x3333333333333333UL) | ((_km_f & 0x3333333333333333UL) << 2);
-									_km_f = ((_km_f >> 4)  & 0x0F0F0F0F0F0F0F0FUL) | ((_km_f & 0x0F0F0F0F0F0F0F0FUL) << 4);
-									_km_f = ((_km_f >> 8)  & 0x00FF00FF00FF00FFUL) | ((_km_f & 0x00FF00FF00FF00FFUL) << 8);
-									_km_f = ((_km_f >> 16) & 0x0000FFFF0000FFFFUL) | ((_km_f & 0x0000FFFF0000FFFFUL) << 16);
-									_km_f = ( _km_f >> 32                        ) | ( _km_f                        << 32);
-									_km_f = (((uint64_t)-1) - _km_f) >> (64 - (m_k << 1));
-									i++;
-									continue;
-								}
-								cpt++;  
-								i++;    
-								continue;
-							}
-							if (m_table[c[i]] == -10)
-							{
-								_km_r = 0; cpt = 0; _isfull = false; 
-								// Pass third line
-								i++;
-								while (len != 0)
-								{
-									while(i < len && c[i] != '\n')		{	i++;}
-									if (i < len)   		{   break;}
-									len = targetReader.readChunk(c);
-									i = 0;
-								}
-								i++;
-								// Pass fouth line
-								while (len != 0)
-								{
-									while(i < len && c[i] != '\n')         {	i++;}
-									if (i < len)         {   break;}
-									len = targetReader.readChunk(c);
-									i = 0;
-								}
-								i++;
-								// Pass first line
-								while (len != 0)
-								{
-									while(i < len && c[i] != '\n')        {		i++;}
-									if (i < len){   break;}
-									len = targetReader.readChunk(c);
-									i = 0;
-								}
-								i++;    
-								continue;
-							}
-							if (m_table[c[i]] == -1)
-							{ 	nt++;   
-								_km_r = 0; cpt = 0; _isfull = false;
-								i++;    
-								continue;
-							}
-							cerr << m_targetsID[t].filePath << ": " ;
-							cerr << "Failed to process sequence -- wrong character found [ASCII]: " << (size_t) c << endl;
-						}
-						len = targetReader.readChunk(c);
-						i = 0;  
-					}
 					targetReader.close();
 					cerr << "\r Progress report: (" <<t+1<< "/"<<m_targetsID.size()<<")              ";
 					continue;
 				}
+				if (m_partial)
+				{
+					cerr << "The targets of a partial build should be fasta/fastq files: " << m_targetsID[t].filePath << endl;
+					exit(1);
+				}
 				targetReader.reset();
 				string s_kmer = "";
 				ITYPE val;
@@ -1304,6 +2476,13 @@ size_t CLARK<HKMERr>::makeSpecificTargetSets(const vector<string>& _filesHT, con
 		size_t sizeMotherTable = commonKmersHT.Size();
 
 		commonKmersHT.SortAllHashTable(2);
+		if (m_partial || (m_incremental && m_labels_c.empty()))
+		{	writeIndex(commonKmersHT);	}
+		if (m_partial)
+		{
+			journal.remove();
+			return sizeMotherTable;
+		}
 		commonKmersHT.RemoveCommon(m_labels_c, m_minCountTarget);
 		char * cfname = (char*) calloc(MXNMLEN, sizeof(char)); //130
 		getdbName(cfname);
@@ -1312,6 +2491,7 @@ size_t CLARK<HKMERr>::makeSpecificTargetSets(const vector<string>& _filesHT, con
 		free(cfname);
 		cfname = NULL;
 		cerr << nbElement << " " << m_kmerSize << "-mers successfully stored in database." << endl;
+		journal.remove();
 
 		return sizeMotherTable;
 	}
@@ -1319,6 +2499,8 @@ size_t CLARK<HKMERr>::makeSpecificTargetSets(const vector<string>& _filesHT, con
 	EHashtable<HKMERr, Element> commonKmersHT(m_kmerSize, m_labels, m_labels_c);
 	for(size_t t = 0 ; t < m_targetsID.size(); t++)
 	{
+		if (duplicate[t])
+		{	continue;	}
 		TargetReader targetReader(m_targetsID[t]);
 		if (!targetReader.open())
 		{
@@ -1328,176 +2510,8 @@ size_t CLARK<HKMERr>::makeSpecificTargetSets(const vector<string>& _filesHT, con
 		{
 			ILBL tgt_id;
 			commonKmersHT.getTargetID(m_targetsID[t].id, tgt_id);
-			char c[MAXRSIZE];
-			size_t len = targetReader.readChunk(c), i = 0;
-			uint64_t _km_f = 0, _km_r = 0;
-			bool _isfull = false;
-			uint8_t cpt = 0;
-			if (len > 0 && c[0] == '>')
-			{
-				while (len != 0)
-				{
-					while( i < len)
-					{
-						if (m_table[c[i]] >= 0)
-						{
-							nt++;
-							if (_isfull)
-							{
-								_km_f >>= 2;
-								_km_f += m_powerTable[cpt][m_table[c[i]]];
-
-								/////////////////////////////////////////////////////////////////////
-								commonKmersHT.addElement(_km_f, m_targetsID[t].id, tgt_id, 1);
-								///////////////////////////////////////////////////////////////////////
-								i++;
-								continue;
-							}
-							_km_r <<= 2;    
-							_km_r += 3 - m_table[c[i]];
-							if (cpt == m_kmerSize - 1)
-							{       _isfull = true;
-								//[/////////////////////////////////////////////////////////////////////
-								commonKmersHT.addElement(_km_r, m_targetsID[t].id, tgt_id, 1);
-								//]//////////////////////////////////////////////////////////////////////
-								_km_f = _km_r;
-								// The following 6 lines come from Jellyfish source code
-								_km_f = ((_km_f >> 2)  & 0x3333333333333333UL) | ((_km_f & 0x3333333333333333UL) << 2);
-								_km_f = ((_km_f >> 4)  & 0x0F0F0F0F0F0F0F0FUL) | ((_km_f & 0x0F0F0F0F0F0F0F0FUL) << 4);
-								_km_f = ((_km_f >> 8)  & 0x00FF00FF00FF00FFUL) | ((_km_f & 0x00FF00FF00FF00FFUL) << 8);
-								_km_f = ((_km_f >> 16) & 0x0000FFFF0000FFFFUL) | ((_km_f & 0x0000FFFF0000FFFFUL) << 16);
-								_km_f = ( _km_f >> 32                        ) | ( _km_f                        << 32);
-								_km_f = (((uint64_t)-1) - _km_f) >> (64 - (m_k << 1));
-								i++;
-								continue;
-							}
-							cpt++;  i++;
-							continue;
-						}
-						if (m_table[c[i]] == -10)
-						{       i++;
-							continue;   }
-						if (m_table[c[i]] == -1)
-						{        nt++; _km_r = 0; cpt = 0; _isfull = false; i++;
-							continue;  }
-						if (m_table[c[i]] == -2)
-						{
-							_km_r = 0; cpt = 0; _isfull = false;
-							while (len != 0)
-							{
-								while(i < len && c[i] != '\n')  {       i++;}
-								if (i < len)            {   break;}
-								len = targetReader.readChunk(c);
-								i = 0;
-							}
-							i++;
-							continue;
-						}
-						cerr << m_targetsID[t].filePath << ": " ;
-						cerr << "Failed to process sequence -- wrong character found [ASCII]: " << (size_t) c << endl;
-					}
-					len = targetReader.readChunk(c);
-					i = 0;
-				}
-				targetReader.close();
-				cerr << "\r Progress report: (" <<t+1<< "/"<<m_targetsID.size()<<")    ";
-				continue;
-			}
-			if (len > 0 && c[0] == '@')
+			if (addTargetKmers(targetReader, commonKmersHT, m_targetsID[t].id, tgt_id, 0, nt))
 			{
-				while (len != 0)
-				{
-					while(i < len && c[i] != '\n')            {       i++;}
-					if (i < len)      {   break;}
-					len = targetReader.readChunk(c);
-					i = 0;
-				}
-				i++;
-				while (len != 0)
-				{
-					while( i < len)
-					{
-						if (m_table[c[i]] >= 0)
-						{
-							nt++;
-							if (_isfull)
-							{
-								_km_f >>= 2; 
-								_km_f += m_powerTable[cpt][m_table[c[i]]];
-
-								/////////////////////////////////////////////////////////////////////
-								commonKmersHT.addElement(_km_f, m_targetsID[t].id, tgt_id, 1);
-								///////////////////////////////////////////////////////////////////////
-								i++;
-								continue;
-							}
-							_km_r <<= 2;    
-							_km_r += 3 - m_table[c[i]];
-							if (cpt  == m_kmerSize - 1)
-							{       _isfull = true;
-								//[/////////////////////////////////////////////////////////////////////
-								commonKmersHT.addElement(_km_r, m_targetsID[t].id, tgt_id, 1);
-								//]//////////////////////////////////////////////////////////////////////
-								_km_f = _km_r;
-								// The following 6 lines come from Jellyfish source code
-								_km_f = ((_km_f >> 2)  & 0x3333333333333333UL) | ((_km_f & 0x3333333333333333UL) << 2);
-								_km_f = ((_km_f >> 4)  & 0x0F0F0F0F0F0F0F0FUL) | ((_km_f & 0x0F0F0F0F0F0F0F0FUL) << 4);
-								_km_f = ((_km_f >> 8)  & 0x00FF00FF00FF00FFUL) | ((_km_f & 0x00FF00FF00FF00FFUL) << 8);
-								_km_f = ((_km_f >> 16) & 0x0000FFFF0000FFFFUL) | ((_km_f & 0x0000FFFF0000FFFFUL) << 16);
-								_km_f = ( _km_f >> 32                        ) | ( _km_f                        << 32);
-								_km_f = (((uint64_t)-1) - _km_f) >> (64 - (m_k << 1));
-
-								i++;
-								continue;
-							}
-							cpt++;
-							i++;
-							continue;
-						}
-						if (m_table[c[i]] == -10)
-						{
-							_km_r = 0; cpt = 0; _isfull = false;
-							// Pass third line
-							i++;
-							while (len != 0)
-							{
-								while(i < len && c[i] != '\n')          {       i++;}
-								if (i < len)            {   break;}
-								len = targetReader.readChunk(c);
-								i = 0;
-							}
-							i++;
-							// Pass fouth line
-							while (len != 0)
-							{
-								while(i < len && c[i] != '\n')         {       i++;}
-								if (i < len)         {   break;}
-								len = targetReader.readChunk(c);
-								i = 0;
-							}
-							i++;
-							// Pass first line
-							while (len != 0)
-							{
-								while(i < len && c[i] != '\n')        {       i++;}
-								if (i < len){   break;}
-								len = targetReader.readChunk(c);
-								i = 0;
-							}
-							i++;
-							continue;
-						}
-						if (m_table[c[i]] == -1)
-						{       nt++;  _km_r = 0; cpt = 0; _isfull = false;
-							i++;
-							continue;
-						}
-						cerr << m_targetsID[t].filePath << ": " ;
-						cerr << "Failed to process sequence -- wrong character found [ASCII]: " << (size_t) c << endl;
-					}
-					len = targetReader.readChunk(c);
-					i = 0;
-				}
 				targetReader.close();
 				cerr << "\r Progress report: (" <<t+1<< "/"<<m_targetsID.size()<<")              ";
 				continue;
@@ -1529,653 +2543,39 @@ size_t CLARK<HKMERr>::makeSpecificTargetSets(const vector<string>& _filesHT, con
 	cfname = NULL;
 	cerr << nbElement << " " << m_kmerSize << "-mers successfully stored in database." << endl;
 
-	return sizeMotherTable;
-	///////////////////////////////////////////////////////////////////////////////
-}
-
-	template <typename HKMERr>
-void CLARK<HKMERr>::getObjectsDataCompute(const uint8_t * _map, const size_t&  nb, FILE * _fout)
-{
-	size_t i_r = 0, bigSteps = 1 + nb/m_nbCPU;
-	if (_map[0] == '>')
-	{
-#ifdef _OPENMP
-#pragma omp parallel for private(i_r)
-#endif
-		for (i_r = 0; i_r < m_nbCPU ; i_r++)
-		{
-			// Variables
-			uint64_t _km_f =0, _km_r = 0;
-			bool _isfull = false;
-			ILBL h, opt_h = 0, p = 0;
-			ITYPE s_best = 0, token = 1;
-			ITYPE* resultTargets = &m_resultTargets[i_r].front();
-			ITYPE* iTable = &m_ITables[i_r].front();
-			size_t iSize = 0, i_c = 0;
-			ILBL* idx = &m_Indexes[i_r].front();
-			uint16_t capacity;
-			size_t readsSPos, readsEPos, readLength, i = bigSteps * i_r, bigMax = bigSteps*(i_r+1);	
-
-			while (_map[i++] != '>')
-			{}
-			while (true)
-			{
-				readLength = 1; 
-				m_seqSNames[i_r].push_back(i);
-				while (i < nb && m_separators[_map[++i]] == 0)
-				{}
-				m_seqENames[i_r].push_back(i);
-				while (i < nb && _map[i++] != '\n')
-				{}
-				readsSPos = i;
-				//readsEPos = i;
-				while (i < nb && _map[i]!= '>')
-				{
-					while (i < nb && _map[i]!= '\n')
-					{	i++;	}
-					readLength--;
-					readsEPos = i++;
-				}
-				readLength += readsEPos - readsSPos;
-				readLength -= m_isPaired ? NBN : 0;
-				i_c = readLength < m_kmerSize? readsEPos : readsSPos;
-				// Upper-bound for the number of queries to db
-				capacity = readLength - m_kmerSize + 1;
-				opt_h = 0;
-				m_readsLength[i_r].push_back(readLength);
-				// Scores the read
-				while (i_c < readsEPos)
-				{
-					if (m_table[_map[i_c]] >= 0)
-					{
-						if (_isfull)
-						{
-							_km_f >>= 2;
-							_km_f ^= m_pTable[m_table[_map[i_c]]];
-
-							// Query to HashTable (Thread-safe)
-							if (m_centralHt->queryElement(_km_f, h))
-							{
-								if (iTable[h] != token)
-								{
-									iTable[h] = token;
-									resultTargets[h] = 0;
-									idx[iSize++] = h;
-								}
-								resultTargets[h] += 2;
-								if (resultTargets[h] >= s_best)
-								{       opt_h = h+1; s_best = resultTargets[h];  }
-								if (resultTargets[h] > capacity)
-								{       break;  }
-								i_c++;
-								continue;
-							}
-							capacity--;
-							i_c++;
-							continue;
-						}
-						_km_r <<= 2;
-						_km_r ^= m_rTable[_map[i_c]];
-						if ( p  == m_kmerSize - 1 )
-						{
-							_isfull = true;
-							// Query to HashTable (Thread-safe)
-							if (m_centralHt->queryElement(_km_r, h))
-							{
-								if (iTable[h] != token)
-								{
-									iTable[h] = token;
-									resultTargets[h] = 0;
-									idx[iSize++] = h;
-								}
-								resultTargets[h] +=  2;
-								if (resultTargets[h] >= s_best)
-								{       opt_h = h+1; s_best = resultTargets[h];  }
-								if (resultTargets[h] > capacity)
-								{       break;  }
-								i_c++;
-								_km_f = _km_r;
-								// The following 6 lines come from Jellyfish source code
-								_km_f = ((_km_f >> 2)  & 0x3333333333333333UL) | ((_km_f & 0x3333333333333333UL) << 2);
-								_km_f = ((_km_f >> 4)  & 0x0F0F0F0F0F0F0F0FUL) | ((_km_f & 0x0F0F0F0F0F0F0F0FUL) << 4);
-								_km_f = ((_km_f >> 8)  & 0x00FF00FF00FF00FFUL) | ((_km_f & 0x00FF00FF00FF00FFUL) << 8);
-								_km_f = ((_km_f >> 16) & 0x0000FFFF0000FFFFUL) | ((_km_f & 0x0000FFFF0000FFFFUL) << 16);
-								_km_f = ( _km_f >> 32                        ) | ( _km_f                        << 32);
-								_km_f = (((uint64_t)-1) - _km_f) >> (64 - (m_k << 1));
-
-								continue;
-							}
-							capacity--;
-							i_c++;
-							_km_f = _km_r;
-							// The following 6 lines come from Jellyfish source code
-							_km_f = ((_km_f >> 2)  & 0x3333333333333333UL) | ((_km_f & 0x3333333333333333UL) << 2);
-							_km_f = ((_km_f >> 4)  & 0x0F0F0F0F0F0F0F0FUL) | ((_km_f & 0x0F0F0F0F0F0F0F0FUL) << 4);
-							_km_f = ((_km_f >> 8)  & 0x00FF00FF00FF00FFUL) | ((_km_f & 0x00FF00FF00FF00FFUL) << 8);
-							_km_f = ((_km_f >> 16) & 0x0000FFFF0000FFFFUL) | ((_km_f & 0x0000FFFF0000FFFFUL) << 16);
-							_km_f = ( _km_f >> 32                        ) | ( _km_f                        << 32);
-							_km_f = (((uint64_t)-1) - _km_f) >> (64 - (m_k << 1));
-							continue;
-						}
-						p++;
-						i_c++;
-						continue;
-					}
-					if (_map[i_c] == '\n')
-					{       
-						i_c++;  
-						continue;
-					}
-					_km_r = 0; p = 0; _isfull = false; 
-					i_c++; 
-					capacity--;
-				}
-				m_targetsBest[i_r].push_back(opt_h);
-				iSize = 0;
-				token++;	
-				s_best = 0;_km_r = 0;  p = 0; _isfull = false;
-
-				if ( (i >= bigMax && _map[i] == '>') || i >= nb)
-				{       
-					break;
-				}
-				i++;
-			}
-		}
-	}
-	else  if (_map[0] == '@')
-	{
-		m_posReads[0] = 1;
-		size_t pos1, pos2, pos3, pos4, pos5, pos6;
-		for(i_r = 1; i_r < m_nbCPU ; i_r++)
-		{
-			size_t i = bigSteps * i_r;
-			while (i < nb && _map[i++] != '\n')
-			{	}
-			pos1 = i;
-			while (i < nb && _map[i++] != '\n')
-			{       }
-			pos2 = i;
-			while (i < nb && _map[i++] != '\n')
-			{       }
-			pos3 = i;
-			while (i < nb && _map[i++] != '\n')
-			{       }
-			pos4 = i;
-			while (i < nb && _map[i++] != '\n')
-			{       }
-			pos5 = i;
-			while (i < nb && _map[i++] != '\n')
-			{       }
-			pos6 = i;
-			if (_map[pos1] == '@')
-			{
-				i = pos2;
-				while (m_Letter[_map[i++]] >= 0)
-				{}
-				if (i == pos3 && _map[i] == '+')
-				{	
-					m_posReads[i_r] = pos1+1; 	
-					continue;
-				}	
-			}
-			if (_map[pos2] == '@')
-			{       
-				i = pos3;
-				while (m_Letter[_map[i++]] >= 0)
-				{}
-				if (i == pos4 && _map[i] == '+')
-				{       m_posReads[i_r] = pos2+1; 
-					continue;
-				}
-			}
-			if (_map[pos3] == '@')
-			{
-				i = pos4;
-				while (m_Letter[_map[i++]] >= 0)
-				{}
-				if (i == pos5 && _map[i] == '+')
-				{       m_posReads[i_r] = pos3+1; 
-					continue;
-				}
-			}
-			if (_map[pos4] == '@')
-			{
-				i = pos5;
-				while (m_Letter[_map[i++]] >= 0)
-				{}
-				if (i == pos6 && _map[i] == '+')
-				{       m_posReads[i_r] = pos4+1;
-					continue;
-				}
-			}
-		}
-
-#ifdef _OPENMP
-#pragma omp parallel for private(i_r)
-#endif
-		for (i_r = 0; i_r < m_nbCPU ; i_r++)
-		{
-			// Variables
-			uint64_t _km_f =0, _km_r = 0;
-			bool _isfull = false;
-			ILBL h, opt_h = 0, p = 0;
-			ITYPE s_best = 0, token = 1;
-			ITYPE* resultTargets = &m_resultTargets[i_r].front();
-			ITYPE* iTable = &m_ITables[i_r].front();
-			size_t iSize = 0,  i_c = 0;
-			ILBL* idx = &m_Indexes[i_r].front();
-			uint16_t capacity;
-			size_t readsSPos, readsEPos, readLength, iNext = i_r+1 < m_nbCPU ? m_posReads[i_r+1]: nb;
-			size_t i = m_posReads[i_r];
-
-			while (true)
-			{
-				m_seqSNames[i_r].push_back(i);
-				while (i < nb && m_separators[_map[++i]] == 0)
-				{}
-				m_seqENames[i_r].push_back(i);
-				while (i < nb && _map[i++] != '\n')
-				{}
-				readsSPos = i;
-				//readsEPos = i;
-				while (i < nb && _map[i]!= '\n')
-				{       i++;    }
-				readsEPos = i++;
-				readLength = readsEPos -  readsSPos;
-				readLength -= m_isPaired ? NBN : 0;
-				// Pass third line
-				while (i < nb && _map[i++] != '\n')
-				{}
-				// Pass fourth line
-				while (i < nb && _map[i++] != '\n')
-				{}
-				//////////////
-				i_c = readLength < m_kmerSize? readsEPos : readsSPos;
-				// Upper-bound for the number of queries to db
-				capacity = readLength - m_kmerSize + 1;
-				opt_h = 0;
-				m_readsLength[i_r].push_back(readLength);
-				// Scores the read
-				while (i_c < readsEPos)
-				{
-					if (m_table[_map[i_c]] >= 0)
-					{
-						if (_isfull)
-						{
-							_km_f >>= 2;
-							_km_f ^= m_pTable[m_table[_map[i_c]]];
-							// Query to HashTable (Thread-safe)
-							if (m_centralHt->queryElement(_km_f, h))
-							{
-								if (iTable[h] != token)
-								{
-									iTable[h] = token;
-									resultTargets[h] = 0;
-									idx[iSize++] = h;
-								}
-								resultTargets[h] +=  2;
-								if (resultTargets[h] >= s_best)
-								{       opt_h = h+1; s_best = resultTargets[h];  }
-								if (resultTargets[h] > capacity)
-								{       break;  }
-								i_c++;
-								continue;
-							}
-							capacity--;
-							i_c++;
-							continue;
-						}
-						_km_r <<= 2;
-						_km_r ^= m_rTable[_map[i_c]];
-						if ( p  == m_kmerSize - 1 )
-						{
-							_isfull = true;
-							// Query to HashTable (Thread-safe)
-							if (m_centralHt->queryElement(_km_r, h))
-							{
-								if (iTable[h] != token)
-								{
-									iTable[h] = token;
-									resultTargets[h] = 0;
-									idx[iSize++] = h;
-								}
-								resultTargets[h] +=  2;
-								if (resultTargets[h] >= s_best)
-								{       opt_h = h+1; s_best = resultTargets[h];  }
-								if (resultTargets[h] > capacity)
-								{       break;  }
-								i_c++;
-								_km_f = _km_r;// The following 6 lines come from Jellyfish source code
-								_km_f = ((_km_f >> 2)  & 0x3333333333333333UL) | ((_km_f & 0x3333333333333333UL) << 2);
-								_km_f = ((_km_f >> 4)  & 0x0F0F0F0F0F0F0F0FUL) | ((_km_f & 0x0F0F0F0F0F0F0F0FUL) << 4);
-								_km_f = ((_km_f >> 8)  & 0x00FF00FF00FF00FFUL) | ((_km_f & 0x00FF00FF00FF00FFUL) << 8);
-								_km_f = ((_km_f >> 16) & 0x0000FFFF0000FFFFUL) | ((_km_f & 0x0000FFFF0000FFFFUL) << 16);
-								_km_f = ( _km_f >> 32                        ) | ( _km_f                        << 32);
-								_km_f = (((uint64_t)-1) - _km_f) >> (64 - (m_k << 1));
-								continue;
-							}
-							capacity--;
-							i_c++;
-							_km_f = _km_r;
-							// The following 6 lines come from Jellyfish source code
-							_km_f = ((_km_f >> 2)  & 0x3333333333333333UL) | ((_km_f & 0x3333333333333333UL) << 2);
-							_km_f = ((_km_f >> 4)  & 0x0F0F0F0F0F0F0F0FUL) | ((_km_f & 0x0F0F0F0F0F0F0F0FUL) << 4);
-							_km_f = ((_km_f >> 8)  & 0x00FF00FF00FF00FFUL) | ((_km_f & 0x00FF00FF00FF00FFUL) << 8);
-							_km_f = ((_km_f >> 16) & 0x0000FFFF0000FFFFUL) | ((_km_f & 0x0000FFFF0000FFFFUL) << 16);
-							_km_f = ( _km_f >> 32                        ) | ( _km_f                        << 32);
-							_km_f = (((uint64_t)-1) - _km_f) >> (64 - (m_k << 1));
-							continue;
-						}
-						p++;
-						i_c++;
-						continue;
-					}
-					_km_r = 0; p = 0; _isfull = false;
-					i_c++;
-					capacity--;
-				}
-				m_targetsBest[i_r].push_back(opt_h);
-				iSize = 0;
-				token++;	
-				s_best = 0;_km_r = 0;  p = 0; _isfull = false;
-
-				// Moving on to next read
-				if ((++i) >= iNext)
-				{       break;}
-			}
-		}		
-	}
-	else
-	{
-		cerr << "Failed to recognize the format of the file." << endl; exit(-1) ;
-	}
-	fprintf(_fout, "Object_ID, Length, Assignment\n");	
-	size_t i = 0, c = 0;
-	for(i_r = 0; i_r < m_nbCPU; i_r++)
-	{
-		for(i = 0; i < m_seqSNames[i_r].size(); i++)
-		{
-			for(c = m_seqSNames[i_r][i]; c <  m_seqENames[i_r][i]; c++)
-			{	fprintf(_fout, "%c", _map[c]) ;			}
-			fprintf(_fout, ",%lu,%s\n", m_readsLength[i_r][i], m_targetsName[m_targetsBest[i_r][i]].c_str() );
-		}
-		m_nbObjects += m_seqSNames[i_r].size();
-	}
-	return;
-
-}
-
-	template <typename HKMERr>
-void CLARK<HKMERr>::getObjectsDataComputeFastLight(const uint8_t * _map, const size_t&  nb,  FILE * _fout)
-{
-	size_t i_r = 0, bigSteps = nb/m_nbCPU;
-	if (_map[0] == '>')
-	{
-#ifdef _OPENMP
-#pragma omp parallel for private(i_r)
-#endif
-		for (i_r = 0; i_r < m_nbCPU ; i_r++)
-		{
-			// Variables
-			uint64_t _km_f =0, _km_r = 0;
-			bool _isfull = false;
-			ILBL h, opt_h = 0, p = 0;
-			size_t i_c = 0, readsSPos, readsEPos, readLength;
-			size_t i = bigSteps * i_r, bigMax = bigSteps*(i_r+1);
-
-			while (_map[i++] != '>')
-			{}
-			while (true)
-			{
-				readLength = 1;
-				m_seqSNames[i_r].push_back(i);
-				while (i < nb && m_separators[_map[++i]] == 0)
-				{}
-				m_seqENames[i_r].push_back(i);
-				while (i < nb && _map[i++] != '\n')
-				{}
-				readsSPos = i;
-				while (i < nb && _map[i]!= '>')
-				{
-					while (i < nb && _map[i]!= '\n')
-					{       i++;    }
-					readLength--;
-					readsEPos = i++;
-				}
-				readLength += readsEPos -  readsSPos;
-				readLength -= m_isPaired ? NBN : 0;
-				i_c = readLength < m_kmerSize? readsEPos : readsSPos;
-				opt_h = 0;
-				m_readsLength[i_r].push_back(readLength);
-				// Scores the read
-				while (i_c < readsEPos)
-				{
-					if (m_table[_map[i_c]] >= 0)
-					{
-						if (_isfull)
-						{
-							_km_f >>= 2;
-							_km_f += m_pTable[m_table[_map[i_c]]];
-							// Query to HashTable (Thread-safe)
-							if (m_centralHt->queryElement(_km_f, h))
-							{
-								opt_h = h+1; break;
-							}
-							i_c++;
-							continue;
-						}
-						_km_r <<= 2;
-						_km_r ^= m_rTable[_map[i_c]];
-						if ( p  == m_kmerSize - 1 )
-						{
-							_isfull = true;
-							// Query to HashTable (Thread-safe)
-							if (m_centralHt->queryElement(_km_r, h))
-							{
-								opt_h = h+1; break;
-							}
-							i_c++;
-							_km_f = _km_r;
-							// The following 6 lines come from Jellyfish source code
-							_km_f = ((_km_f >> 2)  & 0x3333333333333333UL) | ((_km_f & 0x3333333333333333UL) << 2);
-							_km_f = ((_km_f >> 4)  & 0x0F0F0F0F0F0F0F0FUL) | ((_km_f & 0x0F0F0F0F0F0F0F0FUL) << 4);
-							_km_f = ((_km_f >> 8)  & 0x00FF00FF00FF00FFUL) | ((_km_f & 0x00FF00FF00FF00FFUL) << 8);
-							_km_f = ((_km_f >> 16) & 0x0000FFFF0000FFFFUL) | ((_km_f & 0x0000FFFF0000FFFFUL) << 16);
-							_km_f = ( _km_f >> 32                        ) | ( _km_f                        << 32);
-							_km_f = (((uint64_t)-1) - _km_f) >> (64 - (m_k << 1));
-
-							continue;
-						}
-						p++;
-						i_c++;
-						continue;
-					}
-					if (_map[i_c] == '\n')
-					{
-						i_c++;
-						continue;
-					}
-					_km_r = 0; p = 0; _isfull = false;
-					i_c++;
-				}
-				m_targetsBest[i_r].push_back(opt_h);
-				_km_r = 0;  p = 0; _isfull = false;
-
-				if ( (i >= bigMax && _map[i] == '>') || i >= nb)
-				{       break;}
-				i++;
-			}
-		}
-	}
-	else  if (_map[0] == '@')
-	{
-		m_posReads[0] = 1;
-		size_t pos1, pos2, pos3, pos4, pos5, pos6;
-		for(i_r = 1; i_r < m_nbCPU ; i_r++)
-		{
-			size_t i = bigSteps * i_r;
-			while (i < nb && _map[i++] != '\n')
-			{       }
-			pos1 = i;
-			while (i < nb && _map[i++] != '\n')
-			{       }
-			pos2 = i;
-			while (i < nb && _map[i++] != '\n')
-			{       }
-			pos3 = i;
-			while (i < nb && _map[i++] != '\n')
-			{       }
-			pos4 = i;
-			while (i < nb && _map[i++] != '\n')
-			{       }
-			pos5 = i;
-			while (i < nb && _map[i++] != '\n')
-			{       }
-			pos6 = i;
-			if (_map[pos1] == '@')
-			{
-				i = pos2;
-				while (m_Letter[_map[i++]] >= 0)
-				{}
-				if (i == pos3 && _map[i] == '+')
-				{
-					m_posReads[i_r] = pos1+1;
-					continue;
-				}
-			}
-			if (_map[pos2] == '@')
-			{
-				i = pos3;
-				while (m_Letter[_map[i++]] >= 0)
-				{}
-				if (i == pos4 && _map[i] == '+')
-				{       m_posReads[i_r] = pos2+1;
-					continue;
-				}
-			}
-			if (_map[pos3] == '@')
-			{
-				i = pos4;
-				while (m_Letter[_map[i++]] >= 0)
-				{}
-				if (i == pos5 && _map[i] == '+')
-				{       m_posReads[i_r] = pos3+1;
-					continue;
-				}
-			}
-			if (_map[pos4] == '@')
-			{
-				i = pos5;
-				while (m_Letter[_map[i++]] >= 0)
-				{}
-				if (i == pos6 && _map[i] == '+')
-				{       m_posReads[i_r] = pos4+1;
-					continue;
-				}
-			}
-		}
-#ifdef _OPENMP
-#pragma omp parallel for private(i_r)
-#endif
-		for (i_r = 0; i_r < m_nbCPU ; i_r++)
-		{
-			// Variables
-			uint64_t _km_f =0, _km_r = 0;
-			bool _isfull = false;
-			ILBL h, opt_h = 0, p = 0;
-			size_t i_c = 0, readsSPos, readsEPos, readLength, iNext = i_r+1 < m_nbCPU ? m_posReads[i_r+1]: nb;
-			size_t i = m_posReads[i_r];
-
-			while (true)
-			{
-				m_seqSNames[i_r].push_back(i);
-				while (i < nb && m_separators[_map[++i]] == 0)
-				{}
-				m_seqENames[i_r].push_back(i);
-				while (i < nb && _map[i++] != '\n')
-				{}
-				readsSPos = i;
-				while (i < nb && _map[i]!= '\n')
-				{       i++;    }
-				readsEPos = i++;
-				readLength = readsEPos -  readsSPos;
-				readLength -= m_isPaired ? NBN : 0;
-				// Pass third line
-				while (i < nb && _map[i++] != '\n')
-				{}
-				// Pass fourth line
-				while (i < nb && _map[i++] != '\n')
-				{}
-				//////////////
-				i_c = readLength < m_kmerSize? readsEPos : readsSPos;
-				opt_h = 0;
-				m_readsLength[i_r].push_back(readLength);
-				// Scores the read
-				while (i_c < readsEPos)
-				{
-					if (m_table[_map[i_c]] >= 0)
-					{
-						if (_isfull)
-						{
-							_km_f >>= 2;
-							_km_f += m_pTable[m_table[_map[i_c]]];
-							// Query to HashTable (Thread-safe)
-							if (m_centralHt->queryElement(_km_f, h))
-							{
-								opt_h = h+1; break;
-							}
-							i_c++;
-							continue;
-						}
-						_km_r <<= 2;
-						_km_r ^= m_rTable[_map[i_c]];
-						if ( p  == m_kmerSize - 1 )
-						{
-							_isfull = true;
-							// Query to HashTable (Thread-safe)
-							if (m_centralHt->queryElement(_km_r, h))
-							{
-								opt_h = h+1; break;
-							}
-							i_c++;
-							_km_f = _km_r;// The following 6 lines come from Jellyfish source code
-							_km_f = ((_km_f >> 2)  & 0x3333333333333333UL) | ((_km_f & 0x3333333333333333UL) << 2);
-							_km_f = ((_km_f >> 4)  & 0x0F0F0F0F0F0F0F0FUL) | ((_km_f & 0x0F0F0F0F0F0F0F0FUL) << 4);
-							_km_f = ((_km_f >> 8)  & 0x00FF00FF00FF00FFUL) | ((_km_f & 0x00FF00FF00FF00FFUL) << 8);
-							_km_f = ((_km_f >> 16) & 0x0000FFFF0000FFFFUL) | ((_km_f & 0x0000FFFF0000FFFFUL) << 16);
-							_km_f = ( _km_f >> 32                        ) | ( _km_f                        << 32);
-							_km_f = (((uint64_t)-1) - _km_f) >> (64 - (m_k << 1));
-							continue;
-						}
-						p++;
-						i_c++;
-						continue;
-					}
-					_km_r = 0; p = 0; _isfull = false;
-					i_c++;
-				}
-				m_targetsBest[i_r].push_back(opt_h);
-				_km_r = 0;  p = 0; _isfull = false;
+	return sizeMotherTable;
+	///////////////////////////////////////////////////////////////////////////////
+}
 
-				// Moving on to next read
-				if (++i >= iNext)
-				{       break;}
-			}
-		}
-	}
-	else
+	template <typename HKMERr>
+void CLARK<HKMERr>::getObjectsDataCompute(const uint8_t * _map, const size_t&  nb, FILE * _fout, const size_t& _score)
+{
+	if (_map[0] != '>' && _map[0] != '@')
 	{
 		cerr << "Failed to recognize the format of the file." << endl; exit(-1) ;
 	}
-	fprintf(_fout, "Object_ID, Length, Assignment\n");
+	const bool fastq = _map[0] == '@';
+	if (fastq)
+	{	getFastqStarts(_map, nb);	}
+	switch (_score)
+	{
+		case SCORE_DEFAULT:
+			dispatchObjects<SCORE_DEFAULT>(_map, nb, fastq);
+			break;
+		case SCORE_EXPRESS:
+			dispatchObjects<SCORE_EXPRESS>(_map, nb, fastq);
+			break;
+		default:
+			dispatchObjects<SCORE_EXPRESSLIGHT>(_map, nb, fastq);
+	}
+	fprintf(_fout, "Object_ID, Length, Assignment\n");	
 	size_t i = 0, c = 0;
-	for(i_r = 0; i_r < m_nbCPU; i_r++)
+	for(size_t i_r = 0; i_r < m_nbCPU; i_r++)
 	{
 		for(i = 0; i < m_seqSNames[i_r].size(); i++)
 		{
 			for(c = m_seqSNames[i_r][i]; c <  m_seqENames[i_r][i]; c++)
-			{       fprintf(_fout, "%c", _map[c]) ;                 }
+			{	fprintf(_fout, "%c", _map[c]) ;			}
 			fprintf(_fout, ",%lu,%s\n", m_readsLength[i_r][i], m_targetsName[m_targetsBest[i_r][i]].c_str() );
 		}
 		m_nbObjects += m_seqSNames[i_r].size();
@@ -2184,244 +2584,271 @@ void CLARK<HKMERr>::getObjectsDataComputeFastLight(const uint8_t * _map, const s
 }
 
 	template <typename HKMERr>
-void CLARK<HKMERr>::getObjectsDataComputeFast(const uint8_t *      _map,  const size_t&   nb, FILE * _fout)
+void CLARK<HKMERr>::getFastqStarts(const uint8_t * _map, const size_t&  nb)
 {
+	// First read of each thread: the first of the next four lines starting with '@' and followed by
+	// a sequence line and a '+' line.
 	size_t i_r = 0, bigSteps = 1 + nb/m_nbCPU;
-	if (_map[0] == '>')
+	m_posReads[0] = 1;
+	size_t pos[6];
+	for(i_r = 1; i_r < m_nbCPU ; i_r++)
 	{
+		size_t i = bigSteps * i_r;
+		for(size_t t = 0; t < 6; t++)
+		{
+			while (i < nb && _map[i++] != '\n')
+			{	}
+			pos[t] = i;
+		}
+		for(size_t t = 0; t < 4; t++)
+		{
+			if (_map[pos[t]] == '@')
+			{
+				i = pos[t+1];
+				while (m_Letter[_map[i++]] >= 0)
+				{}
+				if (i == pos[t+2] && _map[i] == '+')
+				{
+					m_posReads[i_r] = pos[t]+1;
+					break;
+				}
+			}
+		}
+	}
+}
+
+	template <typename HKMERr>
+	template <size_t SCORE>
+void CLARK<HKMERr>::dispatchObjects(const uint8_t * _map, const size_t&  nb, const bool& _fastq)
+{
+	switch (m_kmerSize)
+	{
+		case 20:
+			_fastq ? scanObjects<20, true, SCORE>(_map, nb) : scanObjects<20, false, SCORE>(_map, nb);
+			break;
+		case 27:
+			_fastq ? scanObjects<27, true, SCORE>(_map, nb) : scanObjects<27, false, SCORE>(_map, nb);
+			break;
+		case 31:
+			_fastq ? scanObjects<31, true, SCORE>(_map, nb) : scanObjects<31, false, SCORE>(_map, nb);
+			break;
+		case 32:
+			_fastq ? scanObjects<32, true, SCORE>(_map, nb) : scanObjects<32, false, SCORE>(_map, nb);
+			break;
+		default:
+			_fastq ? scanObjects<0, true, SCORE>(_map, nb) : scanObjects<0, false, SCORE>(_map, nb);
+	}
+}
+
+	template <typename HKMERr>
+	template <size_t K, bool FASTQ, size_t SCORE>
+void CLARK<HKMERr>::scanObjects(const uint8_t * _map, const size_t&  nb)
+{
+	size_t i_r = 0, bigSteps = 1 + nb/m_nbCPU;
 #ifdef _OPENMP
 #pragma omp parallel for private(i_r)
 #endif
-		for (i_r = 0; i_r < m_nbCPU ; i_r++)
+	for (i_r = 0; i_r < m_nbCPU ; i_r++)
+	{
+		if (m_pinThreads || m_numaPolicy == NUMA_REPLICATE)
+		{	numaPolicy::enterThread(i_r, m_pinThreads);	}
+		// Variables
+		readEncoder encoder;
+		kmerRoller<K> roller(m_kmerSize);
+		const size_t k = K > 0 ? K : m_kmerSize;
+		const uint8_t* codes;
+		ILBL h, opt_h = 0;
+		ITYPE s_best = 0, token = 1;
+		ITYPE* resultTargets = &m_resultTargets[i_r].front();
+		ITYPE* iTable = &m_ITables[i_r].front();
+		size_t iSize = 0, i_c = 0;
+		ILBL* idx = &m_Indexes[i_r].front();
+		resultCache& cache = m_cache;
+		ITYPE values[NBCACHED];
+		uint64_t key = 0;
+		bool cached = false;
+		uint16_t capacity;
+		size_t readsSPos, readsEPos, readLength, i = bigSteps * i_r, bigMax = bigSteps*(i_r+1);
+		size_t iNext = i_r+1 < m_nbCPU ? m_posReads[i_r+1]: nb;
+		const bool caching = cache.isEnabled();
+		// Express mode without filter nor cache: reads not encoded, bases streamed to the roller
+		const bool stream = SCORE == SCORE_EXPRESS && m_dustThreshold == 0 && m_minQuality == 0 && !caching;
+
+		if (FASTQ)
+		{	i = m_posReads[i_r];	}
+		else
 		{
-			// Variables
-			uint64_t _km_r = 0;
-			ILBL h, opt_h = 0, p = 0;
-			size_t i_c = 0, readsSPos, readsEPos, readLength;
-			size_t i = bigSteps * i_r, bigMax = bigSteps*(i_r+1);
-
 			while (_map[i++] != '>')
 			{}
-			while (true)
+		}
+		while (true)
+		{
+			m_seqSNames[i_r].push_back(i);
+			while (i < nb && m_separators[_map[++i]] == 0)
+			{}
+			m_seqENames[i_r].push_back(i);
+			while (i < nb && _map[i++] != '\n')
+			{}
+			readsSPos = i;
+			if (FASTQ)
 			{
-				readLength = 1;
-				m_seqSNames[i_r].push_back(i);
-				while (i < nb && m_separators[_map[++i]] == 0)
-				{}
-				m_seqENames[i_r].push_back(i);
+				while (i < nb && _map[i]!= '\n')
+				{       i++;    }
+				readsEPos = i++;
+				readLength = readsEPos -  readsSPos;
+				// Pass third line
 				while (i < nb && _map[i++] != '\n')
 				{}
-				readsSPos = i;
+				// Pass fourth line (quality)
+				const size_t qualSPos = i;
+				while (i < nb && _map[i] != '\n')
+				{       i++;    }
+				if (!stream)
+				{
+					encoder.encode(_map + readsSPos, readLength);
+					m_skippedKmers[i_r] += filterObject(encoder, _map + qualSPos, i - qualSPos);
+				}
+				i += i < nb ? 1: 0;
+			}
+			else
+			{
+				readLength = 1;
+				encoder.clear();
 				while (i < nb && _map[i]!= '>')
 				{
+					readsEPos = i;
 					while (i < nb && _map[i]!= '\n')
-					{       i++;    }
+					{	i++;	}
+					if (!stream)
+					{	encoder.append(_map + readsEPos, i - readsEPos);	}
 					readLength--;
 					readsEPos = i++;
 				}
-				readLength += readsEPos -  readsSPos;
-				readLength -= m_isPaired ? NBN: 0;
-				i_c = readLength < m_kmerSize? readsEPos : readsSPos;
-				opt_h = 0;
-				m_readsLength[i_r].push_back(readLength);
-				// Scores the read
-				while (i_c < readsEPos)
-				{
-					if (m_table[_map[i_c]] >= 0)
-					{
-						_km_r <<= 2;
-						_km_r ^= m_rTable[_map[i_c]];
-						if ( p  == m_kmerSize - 1 )
-						{
-							// Query to HashTable (Thread-safe)
-							if (m_centralHt->queryElement(_km_r, h))
-							{
-								opt_h = h+1;
-								break;
-							}
-							i_c++;
-							_km_r = 0; p = 0;
-							continue;
-						}
-						p++;
-						i_c++;
-						continue;
-					}
-					if (_map[i_c] == '\n')
-					{
-						i_c++;
-						continue;
-					}
-					_km_r = 0; p = 0;
-					i_c++;
-				}
-				m_targetsBest[i_r].push_back(opt_h);
-				_km_r = 0;  p = 0;
-
-				if ((i >= bigMax && _map[i] == '>' )|| i >= nb)
-				{       break;}
-				i++; 
+				readLength += readsEPos - readsSPos;
+				if (!stream)
+				{	m_skippedKmers[i_r] += filterObject(encoder, NULL, 0);	}
 			}
-		}
-	}
-	else  if (_map[0] == '@')
-	{
-		m_posReads[0] = 1;
-		size_t pos1, pos2, pos3, pos4, pos5, pos6;
-		for(i_r = 1; i_r < m_nbCPU ; i_r++)
-		{
-			size_t i = bigSteps * i_r;
-			while (i < nb && _map[i++] != '\n')
-			{       }
-			pos1 = i;
-			while (i < nb && _map[i++] != '\n')
-			{       }
-			pos2 = i;
-			while (i < nb && _map[i++] != '\n')
-			{       }
-			pos3 = i;
-			while (i < nb && _map[i++] != '\n')
-			{       }
-			pos4 = i;
-			while (i < nb && _map[i++] != '\n')
-			{       }
-			pos5 = i;
-			while (i < nb && _map[i++] != '\n')
-			{       }
-			pos6 = i;
-			if (_map[pos1] == '@')
+			readLength -= m_isPaired ? NBN : 0;
+			// Upper-bound for the number of queries to db
+			capacity = readLength - k + 1;
+			opt_h = 0;
+			m_readsLength[i_r].push_back(readLength);
+			key = caching && readLength >= k ? encoder.getHash(): 0;
+			cached = key != 0 && cache.find(key, readLength, values);
+			// Scores the read
+			if (stream && readLength >= k)
+			{	opt_h = getExpressHit<K>(encoder, _map + readsSPos, readsEPos - readsSPos, i_r);	}
+			codes = stream ? NULL: encoder.getCodes();
+			for(i_c = readLength < k || cached || stream ? encoder.size(): 0; i_c < encoder.size(); i_c++)
 			{
-				i = pos2;
-				while (m_Letter[_map[i++]] >= 0)
-				{}
-				if (i == pos3 && _map[i] == '+')
+				if (encoder.isAmbiguous(i_c))
 				{
-					m_posReads[i_r] = pos1+1;
+					roller.reset();
+					capacity--;
 					continue;
 				}
-			}
-			if (_map[pos2] == '@')
-			{
-				i = pos3;
-				while (m_Letter[_map[i++]] >= 0)
-				{}
-				if (i == pos4 && _map[i] == '+')
-				{       m_posReads[i_r] = pos2+1;
+				if (!roller.push(codes[i_c]))
+				{	continue;	}
+				if (m_syncmer.isEnabled() && !m_syncmer.isSelected(roller.getFwd(), roller.getRvs()))
+				{
+					// Not sampled in the database either
+					capacity--;
 					continue;
 				}
-			}
-			if (_map[pos3] == '@')
-			{
-				i = pos4;
-				while (m_Letter[_map[i++]] >= 0)
-				{}
-				if (i == pos5 && _map[i] == '+')
-				{       m_posReads[i_r] = pos3+1;
+				if (SCORE == SCORE_EXPRESS)
+				{
+					// Non-overlapping k-mers
+					if (m_centralHt->queryElement(roller.getRvs(), roller.getFwd(), h, i_r) && atRank(h))
+					{	opt_h = h+1; break;	}
+					roller.reset();
 					continue;
 				}
-			}
-			if (_map[pos4] == '@')
-			{
-				i = pos5;
-				while (m_Letter[_map[i++]] >= 0)
-				{}
-				if (i == pos6 && _map[i] == '+')
-				{       m_posReads[i_r] = pos4+1;
+				// Query to HashTable (Thread-safe)
+				if (!(roller.isFirst() ? m_centralHt->queryElement(roller.getRvs(), roller.getFwd(), h, i_r): m_centralHt->queryElement(roller.getFwd(), roller.getRvs(), h, i_r)) || !atRank(h))
+				{
+					capacity--;
 					continue;
 				}
-			}
-		}
-
-#ifdef _OPENMP
-#pragma omp parallel for private(i_r)
-#endif
-		for (i_r = 0; i_r < m_nbCPU ; i_r++)
-		{
-			// Variables
-			uint64_t _km_r = 0;
-			ILBL h, opt_h = 0, p = 0;
-			size_t i_c = 0, readsSPos, readsEPos, readLength, iNext = i_r+1 < m_nbCPU ? m_posReads[i_r+1]: nb;
-			size_t i = m_posReads[i_r];
-
-			while (true)
-			{
-				m_seqSNames[i_r].push_back(i);
-				while (i < nb && m_separators[_map[++i]] == 0)
-				{}
-				m_seqENames[i_r].push_back(i);
-				while (i < nb && _map[i++] != '\n')
-				{}
-				readsSPos = i;
-				while (i < nb && _map[i]!= '\n')
-				{       i++;    }
-				readsEPos = i++;
-				readLength = readsEPos -  readsSPos;
-				readLength -= m_isPaired ? NBN: 0;
-				// Pass third line
-				while (i < nb && _map[i++] != '\n')
-				{}
-				// Pass fourth line
-				while (i < nb && _map[i++] != '\n')
-				{}
-				//////////////
-				i_c = readLength < m_kmerSize? readsEPos : readsSPos;
-				opt_h = 0;
-				m_readsLength[i_r].push_back(readLength);
-				// Scores the read
-				while (i_c < readsEPos)
+				if (SCORE == SCORE_EXPRESSLIGHT)
+				{	opt_h = h+1; break;	}
+				if (iTable[h] != token)
 				{
-					if (m_table[_map[i_c]] >= 0)
-					{
-						_km_r <<= 2;
-						_km_r ^= m_rTable[_map[i_c]];
-						if ( p  == m_kmerSize - 1 )
-						{
-							// Query to HashTable (Thread-safe)
-							if (m_centralHt->queryElement(_km_r, h))
-							{
-								opt_h = h+1;   
-								break;  
-							}
-							_km_r = 0; p = 0;
-							i_c++;
-							continue;
-						}
-						p++;
-						i_c++;
-						continue;
-					}
-					_km_r = 0; p = 0;
-					i_c++;
+					iTable[h] = token;
+					resultTargets[h] = 0;
+					idx[iSize++] = h;
 				}
-				m_targetsBest[i_r].push_back(opt_h);
-				_km_r = 0;  p = 0;
+				resultTargets[h] += 2;
+				if (resultTargets[h] >= s_best)
+				{       opt_h = h+1; s_best = resultTargets[h];  }
+				if (resultTargets[h] > capacity)
+				{       break;  }
+			}
+			roller.reset();
+			if (cached)
+			{	opt_h = values[0];	}
+			else if (key != 0)
+			{
+				values[0] = opt_h;
+				cache.insert(key, readLength, values);
+			}
+			m_targetsBest[i_r].push_back(opt_h);
+			iSize = 0;
+			token++;	
+			s_best = 0;
 
-				// Moving on to next read
-				if ((++i) >= iNext)
+			// Moving on to next read
+			if (FASTQ)
+			{
+				if (++i >= iNext)
 				{       break;}
+				continue;
 			}
+			if ( (i >= bigMax && _map[i] == '>') || i >= nb)
+			{       break;	}
+			i++;
 		}
 	}
-	else
-	{
-		cerr << "Failed to recognize the format of the file." << endl; exit(-1) ;
-	}
-	fprintf(_fout, "Object_ID, Length, Assignment\n");
-	size_t i = 0, c = 0;
-	for(i_r = 0; i_r < m_nbCPU; i_r++)
-	{
-		for(i = 0; i < m_seqSNames[i_r].size(); i++)
+}
+
+
+	template <typename HKMERr>
+	template <size_t K>
+ILBL CLARK<HKMERr>::getExpressHit(const readEncoder& _encoder, const uint8_t* _seq, const size_t& _len, const size_t& _thread) const
+{
+	// Express mode over the bases of a read as in the file (line breaks skipped): first hit of
+	// non-overlapping k-mers, 0 if none. Without syncmers, only the reverse k-mer is rolled (the
+	// forward one is derived by the table on a miss).
+	kmerRoller<K> roller(m_kmerSize);
+	ILBL h = 0;
+	uint8_t code = 0;
+	const bool syncmers = m_syncmer.isEnabled();
+	for(size_t i_c = 0; i_c < _len; i_c++)
+	{
+		code = _encoder.getCode(_seq[i_c]);
+		if (code > 3)
 		{
-			for(c = m_seqSNames[i_r][i]; c <  m_seqENames[i_r][i]; c++)
-			{       fprintf(_fout, "%c", _map[c]) ;                 }
-			fprintf(_fout, ",%lu,%s\n", m_readsLength[i_r][i], m_targetsName[m_targetsBest[i_r][i]].c_str() );
+			if (_seq[i_c] != '\n')
+			{	roller.reset();	}
+			continue;
 		}
-		m_nbObjects += m_seqSNames[i_r].size();
+		if (!syncmers)
+		{
+			if (!roller.pushRvs(code))
+			{	continue;	}
+			if (m_centralHt->queryElement(roller.getRvs(), h, _thread) && atRank(h))
+			{	return h+1;	}
+			roller.reset();
+			continue;
+		}
+		if (!roller.push(code) || !m_syncmer.isSelected(roller.getFwd(), roller.getRvs()))
+		{	continue;	}
+		if (m_centralHt->queryElement(roller.getRvs(), roller.getFwd(), h, _thread) && atRank(h))
+		{	return h+1;	}
+		roller.reset();
 	}
-	return;
+	return 0;
 }
 
-
 	template <typename HKMERr>
 void CLARK<HKMERr>::getObjectsDataComputeFastSpaced(const bool& isfasta, const char* filename, const char* _fileResult)
 {
@@ -2482,12 +2909,18 @@ void CLARK<HKMERr>::getObjectsDataComputeFastSpaced(const bool& isfasta, const c
 #endif
 		for(i_r = 0; i_r < eff_nbCPU; i_r++)
 		{
+			if (m_pinThreads || m_numaPolicy == NUMA_REPLICATE)
+			{	numaPolicy::enterThread(i_r, m_pinThreads);	}
 			// Variables
-			ILBL 		h 	= 0, h1 = 0;
-			uint64_t 	i_c 	= 0, rid = 0;
+			readEncoder	encoder;
+			uint64_t 	rid 	= 0, key = 0;
 			uint8_t* 	read 	= &tReads[i_r].front();
 			uint32_t 	size 	= 0;
 			bool 		stat 	= true;
+			ITYPE		values[NBCACHED];
+			const uint8_t*	qual 	= NULL;
+			size_t		qualLength = 0;
+			resultCache&	cache 	= m_cache;
 
 			while (!fdmanager->isOver(i_r))
 			{
@@ -2498,23 +2931,28 @@ void CLARK<HKMERr>::getObjectsDataComputeFastSpaced(const bool& isfasta, const c
 				size 	= size > 2*m_kmerSize? 2*m_kmerSize: size;
 				if ( stat && size >= m_kmerSize)
 				{
-					i_c = 0;
-					// Scores the read
-					while (i_c < size - m_kmerSize + 1)
+					encoder.encode(read, size);
+					qual 	= fdmanager->GetQuality(i_r, qualLength);
+					m_skippedKmers[i_r] += filterObject(encoder, qual, qualLength);
+					key 	= cache.isEnabled() ? encoder.getHash(): 0;
+					if (cache.isEnabled() && cache.find(key, size, values))
 					{
-						for(size_t ht = 0; ht < m_DSS.size(); ht++)
-						{
-							if (m_centralHt->querySpacedElement(read, i_c, size, h, ht))
-							{	
-								hStore[i_r].insert(h);
-							}
-						}
-						i_c += 2;
+						for(size_t t = 0; t < NBCACHED; t++)
+						{	m_ResultsCentral[t][rid] = values[t];	}
+						continue;
 					}
+					// Scores the read
+					getSpacedHits(encoder, m_stride > 0 ? m_stride: 2, hStore[i_r], i_r);
 				}
 				hStore[i_r].getBest(m_ResultsCentral[0][rid], m_ResultsCentral[1][rid]);
 				hStore[i_r].getSecondBest(m_ResultsCentral[2][rid], m_ResultsCentral[3][rid]);
 				m_ResultsCentral[1][rid] = (m_ResultsCentral[1][rid]>4 && 2*m_ResultsCentral[3][rid]<m_ResultsCentral[1][rid])?m_ResultsCentral[1][rid]:0;
+				if (cache.isEnabled() && stat && size >= m_kmerSize)
+				{
+					for(size_t t = 0; t < NBCACHED; t++)
+					{	values[t] = m_ResultsCentral[t][rid];	}
+					cache.insert(key, size, values);
+				}
 				hStore[i_r].next();
 			}
 		}
@@ -2530,6 +2968,155 @@ void CLARK<HKMERr>::getObjectsDataComputeFastSpaced(const bool& isfasta, const c
 	return;
 }
 
+	template <typename HKMERr>
+size_t CLARK<HKMERr>::getKmerHits(const readEncoder& _encoder, const size_t& _step, HashTop& _hStore, const size_t& _thread) const
+{
+	switch (m_kmerSize)
+	{
+		case 20: return getKmerHits<20>(_encoder, _step, _hStore, _thread);
+		case 27: return getKmerHits<27>(_encoder, _step, _hStore, _thread);
+		case 31: return getKmerHits<31>(_encoder, _step, _hStore, _thread);
+		case 32: return getKmerHits<32>(_encoder, _step, _hStore, _thread);
+		default: return getKmerHits<0>(_encoder, _step, _hStore, _thread);
+	}
+}
+
+	template <typename HKMERr>
+	template <size_t K>
+size_t CLARK<HKMERr>::getKmerHits(const readEncoder& _encoder, const size_t& _step, HashTop& _hStore, const size_t& _thread) const
+{
+	// Queries the k-mers starting at a multiple of _step. Returns the number of lookups saved by
+	// early termination (m_confidenceBins > 0)
+	kmerRoller<K>	roller(m_kmerSize);
+	const size_t	k 	= K > 0 ? K : m_kmerSize;
+	const size_t	size 	= _encoder.size();
+	ILBL 		h;
+
+	const uint8_t*	codes 	= _encoder.getCodes();
+	for(size_t i_c = 0; i_c < size; i_c++)
+	{
+		if (m_confidenceBins > 0 && i_c >= k && i_c % EARLYSTEP == 0 && _hStore.isSettled((size - i_c + _step - 1) / _step, m_confidenceBins))
+		{	return (size - i_c + _step - 1) / _step;	}
+		if (_encoder.isAmbiguous(i_c))
+		{
+			roller.reset();
+			continue;
+		}
+		if (!roller.push(codes[i_c]) || (i_c + 1 - k) % _step != 0 || (m_syncmer.isEnabled() && !m_syncmer.isSelected(roller.getFwd(), roller.getRvs())))
+		{	continue;	}
+		// Query to HashTable (Thread-safe)
+		if ((roller.isFirst() ? m_centralHt->queryElement(roller.getRvs(), roller.getFwd(), h, _thread): m_centralHt->queryElement(roller.getFwd(), roller.getRvs(), h, _thread)) && atRank(h))
+		{
+			_hStore.insert(h);
+		}
+	}
+	return 0;
+}
+
+	template <typename HKMERr>
+size_t CLARK<HKMERr>::getSpacedHits(const readEncoder& _encoder, const size_t& _step, HashTop& _hStore, const size_t& _thread) const
+{
+	switch (m_kmerSize)
+	{
+		case 20: return getSpacedHits<20>(_encoder, _step, _hStore, _thread);
+		case 27: return getSpacedHits<27>(_encoder, _step, _hStore, _thread);
+		case 31: return getSpacedHits<31>(_encoder, _step, _hStore, _thread);
+		case 32: return getSpacedHits<32>(_encoder, _step, _hStore, _thread);
+		default: return getSpacedHits<0>(_encoder, _step, _hStore, _thread);
+	}
+}
+
+	template <typename HKMERr>
+	template <size_t K>
+size_t CLARK<HKMERr>::getSpacedHits(const readEncoder& _encoder, const size_t& _step, HashTop& _hStore, const size_t& _thread) const
+{
+	// Rolling window of the read: every seed (forward and reverse) is projected from it,
+	// and probed in a single batch for each window starting at a multiple of _step.
+	// Ambiguous bases stay in the window (nMap), a seed is valid if they all fall on don't-care positions;
+	// a symbol that is not an IUPAC code ('.', '-'...) invalidates the window (iMap), as in spacedKmer.
+	// Returns the number of windows not probed because of early termination (m_confidenceBins > 0)
+	const size_t		k 	= K > 0 ? K : m_kmerSize;
+	const uint32_t		maskN 	= ((uint32_t) -1) >> (32 - k);
+	kmerRoller<K>		roller(m_kmerSize);
+	uint32_t 		nMap 	= 0, iMap = 0;
+	size_t 			i_c 	= 0, nbHits = 0, t = 0;
+	ILBL 			labels[NBSEEDS];
+	const size_t		size 	= _encoder.size();
+
+	const uint8_t*		codes 	= _encoder.getCodes();
+	for(i_c = 0; i_c < size; i_c++)
+	{
+		// Each remaining window gives at most NBSEEDS hits
+		if (m_confidenceBins > 0 && i_c >= k && i_c % EARLYSTEP == 0 && _hStore.isSettled(NBSEEDS * ((size - i_c + _step - 1) / _step), m_confidenceBins))
+		{	return (size - i_c + _step - 1) / _step;	}
+		nMap = ((nMap << 1) | (_encoder.isAmbiguous(i_c) ? 1: 0)) & maskN;
+		iMap = ((iMap << 1) | (_encoder.isInvalid(i_c) ? 1: 0)) & maskN;
+		if (!roller.push(codes[i_c]) || iMap != 0 || (i_c + 1 - k) % _step != 0 || (m_syncmer.isEnabled() && !m_syncmer.isSelected(roller.getFwd(), roller.getRvs())))
+		{	continue;	}
+		nbHits = m_centralHt->querySpacedElements(roller.getRvs(), roller.getFwd(), nMap, labels, _thread);
+		for(t = 0; t < nbHits; t++)
+		{	_hStore.insert(labels[t]);	}
+	}
+	return 0;
+}
+
+	template <typename HKMERr>
+ITYPE CLARK<HKMERr>::scoreObject(const readEncoder& _encoder, HashTop& _hStore, double& _density, uint64_t& _saved, uint64_t& _rescored, const size_t& _thread) const
+{
+	// Full mode: all k-mers (or windows of spaced seeds) of the encoded read are queried.
+	// Cascade mode: one k-mer out of getStride() is queried first, and the read is scored again with all k-mers
+	// (counted in _rescored) if this vote has no hit or a low confidence; a stride of 1 already queries them all.
+	// _density is the running mean of hits per sampled k-mer (per thread).
+	// Returns the scale of the counts (1 for a scoring with all k-mers).
+	if (m_mode == 4)
+	{
+		const size_t stride = getStride(_encoder.size(), _density);
+		const size_t saved = m_isSpacedLoading ? getSpacedHits(_encoder, stride, _hStore, _thread): getKmerHits(_encoder, stride, _hStore, _thread);
+		ITYPE hits = 0;
+		_hStore.getTotal(hits);
+		_density = 0.875 * _density + 0.125 * ((double) hits) / ((_encoder.size() - m_kmerSize) / stride + 1);
+		if (stride == 1)
+		{
+			_saved += saved;
+			return 1;
+		}
+		if (_hStore.isConfident(CASCADE_MINHITS, CASCADE_MINCONF))
+		{	return stride;	}
+		_hStore.next();
+		_rescored++;
+	}
+	_saved += m_isSpacedLoading ? getSpacedHits(_encoder, 1, _hStore, _thread): getKmerHits(_encoder, 1, _hStore, _thread);
+	return 1;
+}
+
+	template <typename HKMERr>
+size_t CLARK<HKMERr>::filterObject(readEncoder& _encoder, const uint8_t* _qual, const size_t& _qualLength) const
+{
+	// Masks the low-complexity windows (m_dustThreshold > 0) and the bases of quality lower than m_minQuality
+	// (fastq, _qual != NULL, _qualLength symbols) as ambiguous bases. Returns the number of k-mers no more queried.
+	if (m_dustThreshold == 0 && (m_minQuality == 0 || _qual == NULL))
+	{	return 0;	}
+	const size_t nbKmers = _encoder.countKmers(m_kmerSize);
+	if (m_minQuality > 0 && _qual != NULL)
+	{	_encoder.maskQuality(_qual, _qualLength, (uint8_t) (m_minQuality + 33));	}
+	if (m_dustThreshold > 0)
+	{	_encoder.maskLowComplexity(DUSTWINDOW, m_dustThreshold);	}
+	return nbKmers - _encoder.countKmers(m_kmerSize);
+}
+
+	template <typename HKMERr>
+size_t CLARK<HKMERr>::getStride(const size_t& _size, const double& _density) const
+{
+	// Fixed stride if requested. Otherwise, the largest stride expected to give STRIDE_MINVOTES hits
+	// at the current hit density, with STRIDE_MINSAMPLES k-mers at least.
+	const size_t nbKmers = _size - m_kmerSize + 1;
+	if (m_stride > 0)
+	{	return m_stride;	}
+	size_t samples = (size_t) (STRIDE_MINVOTES / (_density > STRIDE_MINDENSITY ? _density: STRIDE_MINDENSITY)) + 1;
+	samples = samples < STRIDE_MINSAMPLES ? STRIDE_MINSAMPLES: samples;
+	return samples >= nbKmers ? 1: nbKmers / samples;
+}
+
 	template <typename HKMERr>
 void CLARK<HKMERr>::getObjectsDataComputeFull(const bool& isfasta, const char* filename, const char* _fileResult)
 {
@@ -2570,6 +3157,8 @@ void CLARK<HKMERr>::getObjectsDataComputeFull(const bool& isfasta, const char* f
 		tReads[i].resize(length,0);
 	}	
 	std::vector<HashTop> hStore(eff_nbCPU);
+	// Lookups to do and lookups saved by early termination, objects scored with all k-mers in cascade mode, per thread
+	std::vector<uint64_t> lookups(eff_nbCPU, 0), saved(eff_nbCPU, 0), rescored(eff_nbCPU, 0);
 
 	while (fdmanager->Next())
 	{
@@ -2588,144 +3177,105 @@ void CLARK<HKMERr>::getObjectsDataComputeFull(const bool& isfasta, const char* f
 				m_ResultsCentral[i].resize(m_nbObjects,0);
 			}
 		}
-		if (m_isSpacedLoading)
-		{
 #ifdef _OPENMP
 #pragma omp parallel for private(i_r)
 #endif
-			for(i_r = 0; i_r < eff_nbCPU; i_r++)
+		for(i_r = 0; i_r < eff_nbCPU; i_r++)
+		{
+			if (m_pinThreads || m_numaPolicy == NUMA_REPLICATE)
+			{	numaPolicy::enterThread(i_r, m_pinThreads);	}
+			// Variables
+			readEncoder	encoder;
+			uint64_t 	rid 	= 0, key = 0;
+			uint8_t* 	read 	= &tReads[i_r].front();
+			uint32_t 	size 	= 0;
+			bool 		stat 	= true, cached = false;
+			ITYPE		scale 	= 1;
+			ITYPE		values[NBCACHED];
+			const uint8_t*	qual 	= NULL;
+			size_t		qualLength = 0;
+			double		density	= 1.0;
+			resultCache&	cache 	= m_cache;
+
+			while (!fdmanager->isOver(i_r))
 			{
-				// Variables
-				ILBL 		h 	= 0;
-				uint64_t 	i_c 	= 0, rid = 0;
-				uint8_t* 	read 	= &tReads[i_r].front();
-				uint32_t 	size 	= 0;
-				bool 		stat 	= true, qu = false;
-
-				while (!fdmanager->isOver(i_r))
+				rid 	= fdmanager->GetReadID(i_r);
+				size 	= 0;
+				stat 	= fdmanager->GetRead(i_r, read, size, m_objectsName[rid]);
+				m_objectsNorm[rid] = m_isPaired?size-NBN:size;
+				scale 	= 1;
+				cached 	= false;
+				if ( stat && size >= m_kmerSize)
 				{
-					rid 	= fdmanager->GetReadID(i_r);
-					size 	= 0;
-					stat 	= fdmanager->GetRead(i_r, read, size, m_objectsName[rid]);
-					m_objectsNorm[rid] = m_isPaired?size-NBN:size;
-					if ( stat && size >= m_kmerSize)
+					encoder.encode(read, size);
+					qual 	= fdmanager->GetQuality(i_r, qualLength);
+					m_skippedKmers[i_r] += filterObject(encoder, qual, qualLength);
+					key 	= cache.isEnabled() ? encoder.getHash(): 0;
+					cached 	= cache.isEnabled() && cache.find(key, size, values);
+					if (!cached)
 					{
-						i_c = 0;
 						// Scores the read
-						while (i_c < size - m_kmerSize + 1)
-						{
-							for(size_t ht = 0; ht < m_DSS.size(); ht++)
-							{
-								if (m_centralHt->querySpacedElement(read, i_c, size, h, ht))
-								{
-									hStore[i_r].insert(h);
-								}
-							}
-							i_c++;
-						}
+						lookups[i_r] += size - m_kmerSize + 1;
+						scale = scoreObject(encoder, hStore[i_r], density, saved[i_r], rescored[i_r], i_r);
 					}
-					hStore[i_r].getBest(m_ResultsCentral[0][rid], m_ResultsCentral[1][rid]);
-					hStore[i_r].getSecondBest(m_ResultsCentral[2][rid], m_ResultsCentral[3][rid]);
-					hStore[i_r].getTotal(m_ResultsCentral[4][rid]);
-					if (m_isExtended)
-					{	hStore[i_r].getScoresLine(m_targetsName.size()-1,m_scoresLines[rid]);	}
-					hStore[i_r].next();
 				}
-			}
-			printExtendedSResults(_fileResult);
-		}
-		else
-		{
-#ifdef _OPENMP
-#pragma omp parallel for private(i_r)
-#endif
-			for(i_r = 0; i_r < eff_nbCPU; i_r++)
-			{
-				// Variables
-				uint64_t 	_km_f 	= 0, _km_r = 0, i_c = 0;
-				ILBL 		h, p 	= 0;
-				bool 		isfull 	= false, stat = true;
-				uint32_t 	size 	= 0;
-				uint64_t 	rid 	= 0;
-				uint8_t*	read	= &tReads[i_r].front();
-
-				while (!fdmanager->isOver(i_r))
+				if (cached)
 				{
-					rid = fdmanager->GetReadID(i_r);
-					size = 0;
-					stat = fdmanager->GetRead(i_r, read, size, m_objectsName[rid]);
-					m_objectsNorm[rid] = m_isPaired?size-NBN:size;
-
-					if ( stat && size >= m_kmerSize)
-					{
-						i_c = 0;
-						// Scores the read
-						while (i_c < size)
-						{
-							//////////////////////////////////////////////////////////////////////////////
-							if (m_table[read[i_c]] >= 0)
-							{
-								if (isfull)
-								{
-									_km_f >>= 2;
-									_km_f += m_pTable[m_table[read[i_c]]];
-									// Query to HashTable (Thread-safe)
-									if (m_centralHt->queryElement(_km_f, h))
-									{
-										hStore[i_r].insert(h);
-									}
-									i_c++;
-									continue;
-								}
-								_km_r <<= 2;
-								_km_r ^= m_rTable[read[i_c]];
-								if ( p  == m_kmerSize - 1 )
-								{
-									isfull = true;
-									// Query to HashTable (Thread-safe)
-									if (m_centralHt->queryElement(_km_r, h))
-									{
-										hStore[i_r].insert(h);
-									}
-									i_c++;
-									_km_f = _km_r;
-									// The following 6 lines come from Jellyfish source code
-									_km_f = ((_km_f >> 2)  & 0x3333333333333333UL) | ((_km_f & 0x3333333333333333UL) << 2);
-									_km_f = ((_km_f >> 4)  & 0x0F0F0F0F0F0F0F0FUL) | ((_km_f & 0x0F0F0F0F0F0F0F0FUL) << 4);
-									_km_f = ((_km_f >> 8)  & 0x00FF00FF00FF00FFUL) | ((_km_f & 0x00FF00FF00FF00FFUL) << 8);
-									_km_f = ((_km_f >> 16) & 0x0000FFFF0000FFFFUL) | ((_km_f & 0x0000FFFF0000FFFFUL) << 16);
-									_km_f = ( _km_f >> 32                        ) | ( _km_f                        << 32);
-									_km_f = (((uint64_t)-1) - _km_f) >> (64 - (m_k << 1));
-
-									continue;
-								}
-								p++;
-								i_c++;
-								continue;
-							}
-							_km_r = 0; p = 0; isfull = false;
-							i_c++;
-							///////////////////////////////////////////////////////////////////////////////
-						}
-						_km_r = 0; p = 0; isfull = false;
-					}
-					hStore[i_r].getBest(m_ResultsCentral[0][rid], m_ResultsCentral[1][rid]);
-					hStore[i_r].getSecondBest(m_ResultsCentral[2][rid], m_ResultsCentral[3][rid]);
-					hStore[i_r].getTotal(m_ResultsCentral[4][rid]);
-					if (m_isExtended)
-					{       hStore[i_r].getScoresLine(m_targetsName.size()-1,m_scoresLines[rid]);  }
-					hStore[i_r].next();
+					for(size_t t = 0; t < NBCACHED; t++)
+					{	m_ResultsCentral[t][rid] = values[t];	}
+					continue;
+				}
+				hStore[i_r].getBest(m_ResultsCentral[0][rid], m_ResultsCentral[1][rid]);
+				hStore[i_r].getSecondBest(m_ResultsCentral[2][rid], m_ResultsCentral[3][rid]);
+				hStore[i_r].getTotal(m_ResultsCentral[4][rid]);
+				if (scale > 1)
+				{
+					// Counts of the sampled vote, scaled to all k-mers of the read
+					const ITYPE nbKmers = size - m_kmerSize + 1;
+					m_ResultsCentral[1][rid] = std::min(m_ResultsCentral[1][rid] * scale, nbKmers);
+					m_ResultsCentral[3][rid] = std::min(m_ResultsCentral[3][rid] * scale, nbKmers);
+					m_ResultsCentral[4][rid] = std::min(m_ResultsCentral[4][rid] * scale, nbKmers);
+				}
+				if (cache.isEnabled() && stat && size >= m_kmerSize)
+				{
+					for(size_t t = 0; t < NBCACHED; t++)
+					{	values[t] = m_ResultsCentral[t][rid];	}
+					cache.insert(key, size, values);
 				}
+				if (m_isExtended)
+				{	hStore[i_r].getScoresLine(m_targetsName.size()-1,m_scoresLines[rid]);	}
+				hStore[i_r].next();
 			}
-			printExtendedResults(_fileResult);
 		}
-		//printExtendedResults(_fileResult);
+		if (m_isSpacedLoading)
+		{	printExtendedSResults(_fileResult);	}
+		else
+		{	printExtendedResults(_fileResult);	}
 	}
 	m_nbObjects = fdmanager->GetReadsCount();
 	delete fdmanager;
 
 	gettimeofday(&requestEnd, NULL);
 	printSpeedStats(requestEnd,requestStart, _fileResult);
+	if (m_mode == 4)
+	{
+		uint64_t nbRescored = 0;
+		for(size_t t = 0; t < rescored.size(); t++)
+		{	nbRescored += rescored[t];	}
+		cout <<" - Cascade: " << nbRescored << " objects scored with all k-mers out of " << m_nbObjects;
+		cout << " (" << (m_nbObjects == 0 ? 0.: 100.0*nbRescored/m_nbObjects) << "%)." << endl;
+	}
+	if (m_confidenceBins > 0)
+	{
+		uint64_t nbLookups = 0, nbSaved = 0;
+		for(size_t t = 0; t < lookups.size(); t++)
+		{
+			nbLookups += lookups[t];
+			nbSaved += saved[t];
+		}
+		cout <<" - Early termination: " << nbSaved << " k-mer lookups saved out of " << nbLookups;
+		cout << " (" << (nbLookups == 0 ? 0.: 100.0*nbSaved/nbLookups) << "%)." << endl;
+	}
 
 	return;
 }
@@ -2799,6 +3349,8 @@ bool CLARK<HKMERr>::getTargetsData(const char* _filesName, vector<string>& _file
 		m_targetsID.push_back(target);
 	}
 	fclose(meta_f);
+	if (!m_lineageFile.empty())
+	{	loadLineage();	}
 	print(_creatingkmfiles, _samplingfactor);
 
 	if (_creatingkmfiles)
@@ -2835,10 +3387,7 @@ bool CLARK<HKMERr>::getTargetsData(const char* _filesName, vector<string>& _file
 
 	char * cfname = (char*) calloc(MXNMLEN, sizeof(char)); //130
 	char * cfname_s = (char*) calloc(MXNMLEN+4, sizeof(char));
-	if (!m_isSpacedLoading)
-	{	getdbName(cfname);	}
-	else
-	{	getdbName(cfname,1);	}
+	getdbName(cfname);
 	
 	sprintf(cfname_s, "%s.ky", cfname);
 	FILE * dbfd_ky = fopen(cfname_s, "r");
@@ -2874,13 +3423,8 @@ bool CLARK<HKMERr>::getTargetsData(const char* _filesName, vector<string>& _file
 	free(cfname_s);
 	cfname = NULL;
 	cfname_s = NULL;
-	if (!areHTfilespresent && m_isSpacedLoading)
-	{
-		cerr << "The program cannot find databases of discriminative spaced k-mers." << endl;
-		cerr << "Please run the script ``buildSpacedDB.sh'' before running CLARK to compute these databases."<< endl;	
-		cerr << "See instructions in http://clark.cs.ucr.edu/Spaced/"<< endl;
-		exit(1);
-	}
+	if (m_container)
+	{	areHTfilespresent = checkContainer(areHTfilespresent);	}
 	return areHTfilespresent;
 }
 
@@ -2900,6 +3444,14 @@ void CLARK<HKMERr>::print(const bool& _creatingkmfiles, const ITYPE& _samplingfa
 	{
 		cerr << "Using light database in RAM (" << m_iterKmers << ")" << endl;
 	}
+	if (m_syncmer.isEnabled())
+	{
+		cerr << "Using open syncmers (s = " << m_syncmer.getS() << ")" << endl;
+	}
+	if (!m_lineageFile.empty())
+	{
+		cerr << "Multi-rank database (lineage in " << m_lineageFile << ")" << endl;
+	}
 }
 
 template <typename HKMERr>
@@ -2909,6 +3461,25 @@ void CLARK<HKMERr>::printSpeedStats(const struct timeval& _requestEnd, const str
 	cout <<" - Assignment time: "<<diff<<" s. Speed: ";
 	cout << (size_t) (((double) m_nbObjects)/(diff)*60.0)<<" objects/min. ("<< m_nbObjects<<" objects)."<<endl;
 	cout <<" - Results stored in " << _fileResult << endl;
+	if (m_dustThreshold > 0 || m_minQuality > 0)
+	{
+		uint64_t nbSkipped = 0;
+		for(size_t t = 0; t < m_skippedKmers.size(); t++)
+		{	nbSkipped += m_skippedKmers[t];	}
+		cout <<" - Pre-filter: " << nbSkipped << " k-mer lookups skipped (low complexity or low quality)." << endl;
+	}
+	if (m_cache.isEnabled())
+	{
+		const uint64_t nbHits = m_cache.getHits(), nbLookups = m_cache.getLookups();
+		cout <<" - Cache: " << nbHits << " objects found out of " << nbLookups;
+		cout << " (hit ratio: " << (nbLookups == 0 ? 0.: 100.0*nbHits/nbLookups) << "%)." << endl;
+	}
+	if (m_centralHt->GetFilter().isEnabled())
+	{
+		const uint64_t nbTests = m_centralHt->GetFilter().getTests(), nbPasses = m_centralHt->GetFilter().getPasses();
+		cout <<" - Bloom filter: " << nbTests - nbPasses << " k-mers rejected out of " << nbTests;
+		cout << " (reject ratio: " << (nbTests == 0 ? 0.: 100.0*(nbTests - nbPasses)/nbTests) << "%)." << endl;
+	}
 }
 
 template <typename HKMERr>
@@ -147,6 +147,13 @@ bool FileHandler::GetRead(const int& i_cpu, uint8_t* out, uint32_t& size, std::s
 	return false;
 }
 
+// Quality line of the last read returned by GetRead and its length, NULL if the format has none
+const uint8_t* FileHandler::GetQuality(const int&, size_t& length) const
+{
+	length = 0;
+	return NULL;
+}
+
 bool 	FileHandler::SetPositions()
 {
 	return false;
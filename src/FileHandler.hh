@@ -56,6 +56,7 @@ class FileHandler
 	virtual bool     Open();
 	virtual bool 	 GetRead(const int& i_cpu, std::string& out, std::string& id);
 	virtual bool 	 GetRead(const int& i_cpu, uint8_t* out, uint32_t& size, std::string& id);
+	virtual const uint8_t* GetQuality(const int& i_cpu, size_t& length) const;
 
 	protected:
 	virtual bool    SetPositions();
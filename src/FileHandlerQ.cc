@@ -105,8 +105,13 @@ bool FileHandlerQ::GetRead(const int& i_cpu, uint8_t* out, uint32_t& size, std::
         i++;
         while (i < max[i_cpu] && _map[i++] != 10)
         {}
-        while (i < max[i_cpu] && _map[i++] != 10)
-        {}
+        qPos[i_cpu] = i;
+        while (i < max[i_cpu] && _map[i] != 10)
+        {
+                i++;
+        }
+        qLen[i_cpu] = i - qPos[i_cpu];
+        i++;
         i_Pos[i_cpu] = i;
 
         if (i_Pos[i_cpu] >= max[i_cpu])
@@ -117,6 +122,11 @@ bool FileHandlerQ::GetRead(const int& i_cpu, uint8_t* out, uint32_t& size, std::
 	return true;
 }
 
+const uint8_t* FileHandlerQ::GetQuality(const int& i_cpu, size_t& length) const
+{
+	length = qLen[i_cpu];
+	return _map + qPos[i_cpu];
+}
 
 bool 	FileHandlerQ::Open()
 {
@@ -193,6 +203,8 @@ bool 	FileHandlerQ::SetPositions()
         uint64_t _Size = fragmentSize;
 
         posReads.resize(nbCPU, fragmentSize);
+        qPos.resize(nbCPU, 0);
+        qLen.resize(nbCPU, 0);
         posReads[0] = 1;
 	i_Pos[0] = 0;
         if (fragmentSize < 100*nbCPU)
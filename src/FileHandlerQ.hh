@@ -44,9 +44,13 @@ class FileHandlerQ: public FileHandler
 	bool 	Open();
 	bool	GetRead(const int& i_cpu, std::string& out, std::string& id);
 	bool    GetRead(const int& i_cpu, uint8_t* out, uint32_t& size, std::string& id);
+	const uint8_t* GetQuality(const int& i_cpu, size_t& length) const;
 
 	private:
 	bool    SetPositions();
+
+	std::vector<uint64_t>	qPos;
+	std::vector<uint64_t>	qLen;
 };
 
 #endif
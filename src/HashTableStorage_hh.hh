@@ -76,6 +76,7 @@ class EHashtable: public Hashtable
 		std::map< std::string, ILBL > 		m_mapLbls;
 		std::map< std::string, ILBL >::iterator m_it;
 		bool					m_checkCentromere;
+		std::vector< ILBL >			m_parents;	// Parent of each label (multi-rank database)
 	
 	public:
 		EHashtable();	
@@ -96,7 +97,8 @@ class EHashtable: public Hashtable
 		bool addElement(const uint64_t& 		_kmerF, 
 			const std::string&			_label,
 			const ILBL& 				_rlabel, 
-			const size_t& 				_count 
+			const size_t& 				_count,
+			const bool&				_reversed = false
 			);
 
 		bool addElement(const uint64_t& 		_kmerF, 
@@ -117,6 +119,11 @@ class EHashtable: public Hashtable
 			);
 		bool addElement(const std::string& 		_kmer);
 
+		bool removeElement(const uint64_t& 		_kmerF, 
+			const ILBL& 				_rlabel, 
+			const size_t& 				_count 
+			);
+
 		bool clear();
 
 		bool getTargetID(const std::string&		_label,
@@ -149,46 +156,161 @@ class EHashtable: public Hashtable
 			const size_t& 				_minCount = 0
 			);
 
+		// Queries of the thread _thread (index of the counters of the filter, below the threads of BuildFilter)
 		bool queryElement(const IKMER& 			_ikmer, 
-			ILBL& 					_iLabel
+			ILBL& 					_iLabel,
+			const size_t& 				_thread
 			) const;
 
 		bool queryElement(const uint64_t& 		_kmerI, 
-			ILBL& 					_iLabel
+			ILBL& 					_iLabel,
+			const size_t& 				_thread
 			)
-		{	return m_hTable.find(_kmerI, _iLabel);	}		
+		{	return m_hTable.find(_kmerI, _iLabel, _thread);	}		
 
-		bool querySpacedElement(const uint8_t* 		_map, 
-			const size_t& 				_i, 
-			const size_t& 				_iMax, 
-			ILBL& 					_iLabel, 
-			const size_t& 				_idHt = 0
+		// Blocked Bloom filter of the k-mers loaded, checked before the buckets (see bloomFilter)
+		void BuildFilter(const size_t& 			_bitsPerKey,
+			const size_t& 				_maxBytes,
+			const size_t& 				_nbCPU
+			)
+		{	m_hTable.buildFilter(_bitsPerKey, _maxBytes, _nbCPU);	}
+
+		const bloomFilter& GetFilter() const
+		{	return m_hTable.getFilter();	}
+
+		// NUMA placement of the table loaded next (see numaPolicy)
+		void SetPlacement(const size_t& 		_policy
+			)
+		{	m_hTable.setPlacement(_policy);	}
+
+		// Pages of the table loaded next (PAGES_*, see memoryArena)
+		void SetPages(const size_t& 			_pages
+			)
+		{	m_hTable.setPages(_pages);	}
+
+		// Table loaded next attached from, or published in, shared memory (see sharedSegment)
+		void SetShared(const bool& 			_shared
+			)
+		{	m_hTable.setShared(_shared);	}
+
+		// Table loaded next from the database container <db>.cdb (see dbContainer)
+		void SetContainer(const bool& 			_container
+			)
+		{	m_hTable.setContainer(_container);	}
+
+		// Fused query of all seeds from the rolling window of the read (forward and reverse complement)
+		// _nMap flags the ambiguous bases of the window. Returns the number of labels stored in _iLabels.
+		size_t querySpacedElements(const uint64_t& 	_kmF,
+			const uint64_t& 			_kmR,
+			const uint32_t& 			_nMap,
+			ILBL* 					_iLabels,
+			const size_t& 				_thread
 			) const
 		{
-			uint64_t km = 0, kmr = 0, skm = 0;
-			if (m_seeds[_idHt].isFwdValid(_map, _i, _iMax, km))
+			uint64_t skm[2*NBSEEDS];
+			bool valid[2*NBSEEDS];
+			const size_t nbSeeds = m_seeds.size();
+			size_t t = 0, nbHits = 0;
+			for(t = 0; t < nbSeeds; t++)
 			{
-				getSpacedSeed(m_seeds[_idHt].getName(), km, skm);
-				if (m_hTable.findFwd(skm, _iLabel, _idHt))
-                                {	return true;	}
+				valid[2*t] = (_nMap & m_seeds[t].getCareFwd()) == 0;
+				if (valid[2*t])
+				{
+					m_seeds[t].getSpaced(_kmF, skm[2*t]);
+					valid[2*t] = m_hTable.mayContain(skm[2*t], _thread);
+				}
+				if (valid[2*t])
+				{	m_hTable.prefetch(skm[2*t]);	}
+				valid[2*t+1] = (_nMap & m_seeds[t].getCareRvs()) == 0;
+				if (valid[2*t+1])
+				{
+					m_seeds[t].getSpaced(_kmR, skm[2*t+1]);
+					valid[2*t+1] = m_hTable.mayContain(skm[2*t+1], _thread);
+				}
+				if (valid[2*t+1])
+				{	m_hTable.prefetch(skm[2*t+1]);	}
 			}
-			km = 0;
-			kmr = 0;
-			skm = 0;
-			if (m_seeds[_idHt].isRvsValid(_map, _i, _iMax, km))
-                        {
-				getReverseComplement(km, m_seeds[_idHt].getLength(), kmr);
-				getSpacedSeed(m_seeds[_idHt].getName(), kmr, skm);
-				return (m_hTable.findFwd(skm, _iLabel, _idHt));
+			for(t = 0; t < 2*nbSeeds; t++)
+			{
+				if (valid[t])
+				{	m_hTable.prefetchBucket(skm[t]);	}
+			}
+			for(t = 0; t < nbSeeds; t++)
+			{
+				if ((valid[2*t] && m_hTable.findFwd(skm[2*t], _iLabels[nbHits], t)) ||
+					(valid[2*t+1] && m_hTable.findFwd(skm[2*t+1], _iLabels[nbHits], t)))
+				{	nbHits++;	}
 			}
-			return false; 
+			return nbHits;
 		}
 
 		bool queryElement(const uint64_t& 		_kmerIF, 
 			const uint64_t& 			_kmerIR, 
-			ILBL& 					_iLabel
+			ILBL& 					_iLabel,
+			const size_t& 				_thread
 			) const	
-		{	return m_hTable.find(_kmerIF, _kmerIR, _iLabel);	}	
+		{	return m_hTable.find(_kmerIF, _kmerIR, _iLabel, _thread);	}	
+
+		// Parent of each label (NOLABEL for a root): a k-mer found in two labels gets their lowest common ancestor
+		// (multi-rank database), and it is common only if they have none
+		void SetLineage(const std::vector<ILBL>& 	_parents
+			)
+		{	m_parents = _parents;	}
+
+		ILBL getCommonAncestor(const ILBL& 		_labelA, 
+			const ILBL& 				_labelB
+			) const;
+
+		// Label of each label ID (see motherIndex)
+		const std::vector< std::string >& GetLabels() const
+		{	return m_Labels;	}
+
+		bool Dump(FILE* 				_fd, 
+			const size_t& 				_iteratorPos
+			) const
+		{	return m_hTable.dump(_fd, _iteratorPos);	}
+
+		bool Restore(FILE* 				_fd, 
+			const std::vector<ILBL>& 		_labels
+			)
+		{
+			const size_t load = m_hTable.Load();
+			if (!m_hTable.restore(_fd, _labels))
+			{	return false;	}
+			m_localIndex += m_hTable.Load() - load;
+			return true;
+		}
+
+		// Buckets changed since the last checkpoint (see buildCheckpoint and hTable::dumpChanged)
+		void TrackChanges()
+		{	m_hTable.trackChanges();	}
+
+		bool DumpChanged(FILE* 				_fd,
+			const bool& 				_all
+			)
+		{	return m_hTable.dumpChanged(_fd, _all);	}
+
+		bool RestoreBuckets(FILE* 			_fd,
+			const std::vector<ILBL>& 		_labels
+			)
+		{
+			const size_t load = m_hTable.Load();
+			if (!m_hTable.restoreBuckets(_fd, _labels))
+			{	return false;	}
+			m_localIndex += m_hTable.Load() - load;
+			return true;
+		}
+
+		// K-mers of a label no longer used removed, or relabelled _common when shared (see hTable::removeLabel)
+		size_t RemoveLabel(const ILBL& 			_label,
+			const ILBL& 				_common,
+			size_t& 				_kept
+			)
+		{
+			const size_t removed = m_hTable.removeLabel(_label, _common, _kept);
+			m_localIndex -= removed;
+			return removed;
+		}
 
 		uint64_t Write(const char * 			_filename, 
 			const size_t& 				_iteratorPos, 
@@ -519,8 +641,9 @@ bool EHashtable<HKMERr, ELMTr>::addElement(const std::string& _kmer, const strin
 }
 
         template <typename HKMERr, typename ELMTr>
-bool EHashtable<HKMERr, ELMTr>::addElement(const uint64_t& _kmerF, const std::string& _label, const ILBL& _rlabel, const size_t& _count)
+bool EHashtable<HKMERr, ELMTr>::addElement(const uint64_t& _kmerF, const std::string& _label, const ILBL& _rlabel, const size_t& _count, const bool& _reversed)
 {
+	// _reversed: the occurrence is in the other orientation than _kmerF (canonical key of a partial build)
 	if (m_checkCentromere)
 	{	return addElement(_kmerF, _label, _count);	}
 
@@ -531,6 +654,9 @@ bool EHashtable<HKMERr, ELMTr>::addElement(const uint64_t& _kmerF, const std::st
         ICount count;
         if (m_hTable.find(_kmerF, e_x, e_y, e_l, mult, count))
         {
+		if (!m_parents.empty() && _rlabel != e_l && mult == 1 && getCommonAncestor(e_l, _rlabel) != NOLABEL)
+		{	m_hTable.relabelElement(e_x, e_y, _count, getCommonAncestor(e_l, _rlabel));
+			return true;	}
                 m_hTable.updateElement(e_x, e_y, _count, _rlabel == e_l);
                 return true;
         }
@@ -545,17 +671,59 @@ bool EHashtable<HKMERr, ELMTr>::addElement(const uint64_t& _kmerF, const std::st
 
         if (m_hTable.find(_kmerR, e_x, e_y, e_l, mult, count))
         {
+		if (!m_parents.empty() && _rlabel != e_l && mult == 1 && getCommonAncestor(e_l, _rlabel) != NOLABEL)
+		{	m_hTable.relabelElement(e_x, e_y, _count, getCommonAncestor(e_l, _rlabel));
+			return true;	}
 		m_hTable.updateElement(e_x, e_y, _count, _rlabel == e_l);
                 return true;
         }
 
         // Element is not in the table already. Then adding now.
         std::map<string,ILBL>::iterator it_Lbl = m_mapLbls.find(_label);
-        m_hTable.insert(_kmerF, it_Lbl->second, _count);
+	htCell<HKMERr, ELMTr> e(_kmerF / HTSIZE, it_Lbl->second, _count);
+	if (_reversed)
+	{	e.CElement.SetReversed();	}
+        m_hTable.insert(_kmerF, e);
         m_localIndex++;
         return true;
 }
 
+        template <typename HKMERr, typename ELMTr>
+ILBL EHashtable<HKMERr, ELMTr>::getCommonAncestor(const ILBL& _labelA, const ILBL& _labelB) const
+{
+	for(ILBL a = _labelA; a < m_parents.size(); a = m_parents[a])
+	{
+		for(ILBL b = _labelB; b < m_parents.size(); b = m_parents[b])
+		{
+			if (a == b)
+			{	return a;	}
+		}
+	}
+	return NOLABEL;
+}
+
+        template <typename HKMERr, typename ELMTr>
+bool EHashtable<HKMERr, ELMTr>::removeElement(const uint64_t& _kmerF, const ILBL& _rlabel, const size_t& _count)
+{
+	// Occurrences of a target removed (see addElement above): the k-mer is removed when it has no occurrence
+	// left. An occurrence of another label than the one of the k-mer takes back its multiplicity, so the k-mer
+	// is specific again once only its label is left. K-mers of the label _rlabel found in other labels (their
+	// labels are unknown), or whose multiplicity or count is saturated, stay as they are.
+        size_t e_x = 0, e_y = 0;
+        ILBL e_l = 0;
+        IOCCR mult;
+        ICount count;
+	uint64_t _kmerR = 0;
+	getReverseComplement(_kmerF, m_kmerSize, _kmerR);
+        if (!m_hTable.find(_kmerF, e_x, e_y, e_l, mult, count) && !m_hTable.find(_kmerR, e_x, e_y, e_l, mult, count))
+	{	return false;	}
+	if (count.getCount() >= 254 || mult >= 254 || (e_l == _rlabel) != (mult == 1))
+	{	return false;	}
+	if (m_hTable.removeCount(e_x, e_y, _count, e_l == _rlabel))
+	{	m_localIndex--;	}
+	return true;
+}
+
 	template <typename HKMERr, typename ELMTr>
 bool EHashtable<HKMERr, ELMTr>::addElement(const uint64_t& _kmerF, const std::string& _label, const size_t& _count)
 {
@@ -691,13 +859,13 @@ bool EHashtable<HKMERr, ELMTr>::addElement(const std::string& _kmerI, const std:
 }
 
 template <typename HKMERr, typename ELMTr>
-bool EHashtable<HKMERr, ELMTr>::queryElement(const IKMER& _ikmer, ILBL& _iLabel) const
+bool EHashtable<HKMERr, ELMTr>::queryElement(const IKMER& _ikmer, ILBL& _iLabel, const size_t& _thread) const
 {
-	if (m_hTable.find(_ikmer, 0, 1, _iLabel))
+	if (m_hTable.find(_ikmer, 0, 1, _iLabel, _thread))
 	{
 		return true;
 	}
-	return m_hTable.find(_ikmer, 2, 3, _iLabel);
+	return m_hTable.find(_ikmer, 2, 3, _iLabel, _thread);
 }
 
 	template <typename HKMERr, typename ELMTr>
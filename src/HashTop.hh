@@ -57,6 +57,7 @@ class HashTop
 		m_ISize = 0;
                 m_IBest = 0;
 		m_CBest = 0;
+		m_CSecond = 0;
 		m_Total = 0;
 	}
 	void next()
@@ -65,6 +66,7 @@ class HashTop
 		m_ISize = 0;
 		m_IBest = 0;
 		m_CBest = 0;
+		m_CSecond = 0;
 		m_Total = 0;
 	}
 	void insert(const ILBL& _e)
@@ -79,11 +81,7 @@ class HashTop
 			m_CTable[_e] = 1;
 			m_Indexes[m_ISize++] = _e;
 		}
-		if (m_CTable[_e] > m_CBest)
-                {
-                	m_IBest = _e;
-			m_CBest = m_CTable[_e];
-                }
+		update(_e);
 		m_Total++;
 	}
 	void insert(const ILBL& _e, const size_t& _m)
@@ -98,11 +96,7 @@ class HashTop
                         m_CTable[_e] = _m;
                         m_Indexes[m_ISize++] = _e;
                 }
-                if (m_CTable[_e] > m_CBest)
-                {
-			m_CBest = m_CTable[_e];
-                        m_IBest = _e;
-                }
+		update(_e);
 		m_Total += (ITYPE) _m;
         }
 	void getBest(ITYPE& _h, ITYPE& _c)
@@ -141,6 +135,20 @@ class HashTop
 		}
 		_c = sbest;
 	}
+	// True if _remaining more hits can change neither the best target nor the interval (out of _bins
+	// in [0,1]) of the confidence score best/(best + second best)
+	bool isSettled(const size_t& _remaining, const size_t& _bins) const
+	{
+		if (m_CBest == 0 || m_CSecond + _remaining > m_CBest)
+		{	return false;	}
+		const double b = m_CBest, s = m_CSecond, r = _remaining;
+		return getBin(b/(b + s + r), _bins) == getBin((b + r)/(b + r + s), _bins);
+	}
+	// True if the best target has at least _minHits hits and a confidence score of at least _minConf
+	bool isConfident(const size_t& _minHits, const double& _minConf) const
+	{
+		return m_CBest >= _minHits && m_CBest >= _minConf * ((double) m_CBest + (double) m_CSecond);
+	}
 	void getTotal(ITYPE& _v)
 	{
 		_v = m_Total;
@@ -159,6 +167,30 @@ class HashTop
 	}
 
 	private:
+	// Keeps the best and the count of the second best (the highest count among the other targets)
+	void update(const ILBL& _e)
+	{
+		if (_e == m_IBest)
+		{
+			if (m_CTable[_e] > m_CBest)
+			{	m_CBest = m_CTable[_e];	}
+			return;
+		}
+		if (m_CTable[_e] > m_CBest)
+		{
+			m_CSecond = m_CBest;
+			m_IBest = _e;
+			m_CBest = m_CTable[_e];
+			return;
+		}
+		if (m_CTable[_e] > m_CSecond)
+		{	m_CSecond = m_CTable[_e];	}
+	}
+	static size_t getBin(const double& _v, const size_t& _bins)
+	{
+		const size_t b = (size_t) (_v * _bins);
+		return b < _bins ? b: _bins - 1;
+	}
 
 	ITYPE 	m_ITable[MAXLEN];
 	ITYPE	m_CTable[MAXLEN];
@@ -166,6 +198,7 @@ class HashTop
 	ITYPE   m_Token;
         ITYPE   m_IBest;
 	ITYPE 	m_CBest;
+	ITYPE	m_CSecond;
 	ITYPE	m_Total;
 	ILBL	m_ISize;
 };
@@ -0,0 +1,164 @@
+/*
+ * CLARK, CLAssifier based on Reduced K-mers.
+ */
+
+/*
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+   Copyright 2013-2017, Rachid Ounit <clark.ucr.help at gmail.com>
+*/
+
+/*
+ * @author: Rachid Ounit, Ph.D Candidate.
+ * @project: CLARK, Metagenomic and Genomic Sequences Classification project.
+ * @note: C++ IMPLEMENTATION supported on latest Linux and Mac OS.
+ *
+ */
+
+#ifndef BLOOMFILTER_HH
+#define BLOOMFILTER_HH
+
+#include <vector>
+#include <cmath>
+#include <stdint.h>
+
+#define BLOOMBLOCK	8	// Words of 64 bits per block (one cache line)
+#define BLOOMMAXHASH	8	// Maximum number of bits set per key
+#define BLOOMPAD	8	// Counters per thread (one cache line, no false sharing)
+
+//	CLASS
+//	Name: bloomFilter
+//	Implementation notes: Blocked Bloom filter of the k-mers of the database, checked before the buckets of
+//	the hash table so that most k-mers absent from the database are rejected without touching the table.
+//	A key selects one block of 512 bits, then sets or checks the bits given by double hashing inside this
+//	block: a query costs a single cache miss. No false negative; the false positive rate depends on the
+//	number of bits per key. Tests and passes are counted per thread, by the index of the querying thread
+//	given by the caller (below the number of threads given to init).
+//
+class bloomFilter
+{
+	public:
+	bloomFilter(): m_offset(0), m_nbBlocks(0), m_nbHash(0), m_nbKeys(0)
+	{}
+	~bloomFilter(){}
+
+	// Allocates _bitsPerKey bits per key, within _maxBytes bytes if _maxBytes > 0, counters for _nbThreads
+	void init(const size_t& _nbKeys, const size_t& _bitsPerKey, const size_t& _maxBytes = 0, const size_t& _nbThreads = 1)
+	{
+		size_t bits = (_nbKeys > 0 ? _nbKeys : 1) * _bitsPerKey;
+		if (_maxBytes > 0 && bits > _maxBytes * 8)
+		{	bits = _maxBytes * 8;	}
+		m_nbBlocks = (bits + 511) / 512;
+		m_nbBlocks = m_nbBlocks < 1 ? 1 : m_nbBlocks;
+		// Optimal number of bits per key: ln(2) * m / n
+		const double bpk = (double) m_nbBlocks * 512 / (_nbKeys > 0 ? _nbKeys : 1);
+		m_nbHash = (size_t) (bpk * 0.6931 + 0.5);
+		m_nbHash = m_nbHash < 1 ? 1: (m_nbHash > BLOOMMAXHASH ? BLOOMMAXHASH: m_nbHash);
+		m_words.assign(m_nbBlocks * BLOOMBLOCK + BLOOMBLOCK, 0);
+		// Blocks aligned on a cache line
+		m_offset = (BLOOMBLOCK - ((((size_t) &m_words.front()) >> 3) & (BLOOMBLOCK - 1))) & (BLOOMBLOCK - 1);
+		m_counters.assign(2 * (_nbThreads > 0 ? _nbThreads: 1) * BLOOMPAD, 0);
+		m_nbKeys = _nbKeys;
+	}
+
+	bool isEnabled() const
+	{	return m_nbBlocks > 0;	}
+
+	// Thread-safe: bits are set atomically
+	void insert(const uint64_t& _key)
+	{
+		const uint64_t h = mix(_key);
+		uint64_t* block = &m_words[getBlock(h)];
+		for(size_t t = 0; t < m_nbHash; t++)
+		{
+			const size_t p = getPosition(h, t);
+			__sync_fetch_and_or(&block[p >> 6], (uint64_t) 1 << (p & 63));
+		}
+	}
+
+	// Query of the thread _thread
+	bool contains(const uint64_t& _key, const size_t& _thread) const
+	{
+		const uint64_t h = mix(_key);
+		const uint64_t* block = &m_words[getBlock(h)];
+		bool found = true;
+		for(size_t t = 0; t < m_nbHash && found; t++)
+		{
+			const size_t p = getPosition(h, t);
+			found = (block[p >> 6] >> (p & 63)) & 1;
+		}
+		uint64_t* c = &m_counters[_thread * 2 * BLOOMPAD];
+		c[0]++;
+		c[1] += found ? 1: 0;
+		return found;
+	}
+
+	void prefetch(const uint64_t& _key) const
+	{	__builtin_prefetch(&m_words[getBlock(mix(_key))]);	}
+
+	size_t getBytes() const
+	{	return m_nbBlocks * BLOOMBLOCK * sizeof(uint64_t);	}
+
+	// Expected false positive rate of the keys inserted
+	double getRate() const
+	{
+		const double fill = 1.0 - exp(- (double) m_nbHash * m_nbKeys / (m_nbBlocks * 512.0));
+		return pow(fill, (double) m_nbHash);
+	}
+
+	uint64_t getTests() const
+	{	return sumCounters(0);	}
+
+	uint64_t getPasses() const
+	{	return sumCounters(1);	}
+
+	void resetCounters()
+	{	m_counters.assign(m_counters.size(), 0);	}
+
+	private:
+	static uint64_t mix(uint64_t _h)
+	{
+		_h ^= _h >> 33;
+		_h *= 0xff51afd7ed558ccdULL;
+		_h ^= _h >> 33;
+		_h *= 0xc4ceb9fe1a85ec53ULL;
+		_h ^= _h >> 33;
+		return _h;
+	}
+
+	// First word of the block, from the highest bits of the hash
+	size_t getBlock(const uint64_t& _h) const
+	{	return m_offset + (((_h >> 32) * m_nbBlocks) >> 32) * BLOOMBLOCK;	}
+
+	// Bit of the block for the hash function _t, from the lowest bits of the hash
+	static size_t getPosition(const uint64_t& _h, const size_t& _t)
+	{	return (_h + _t * (((_h >> 9) & 511) | 1)) & 511;	}
+
+	uint64_t sumCounters(const size_t& _i) const
+	{
+		uint64_t nb = 0;
+		for(size_t t = _i; t < m_counters.size(); t += 2 * BLOOMPAD)
+		{	nb += m_counters[t];	}
+		return nb;
+	}
+
+	std::vector<uint64_t>		m_words;
+	size_t				m_offset;	// Words before the first aligned block
+	size_t				m_nbBlocks;
+	size_t				m_nbHash;
+	size_t				m_nbKeys;
+	mutable std::vector<uint64_t>	m_counters;	// Tests and passes, per thread
+};
+
+#endif
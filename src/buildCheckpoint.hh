@@ -0,0 +1,270 @@
+/*
+ * CLARK, CLAssifier based on Reduced K-mers.
+ */
+
+/*
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+   Copyright 2013-2017, Rachid Ounit <clark.ucr.help at gmail.com>
+*/
+
+/*
+ * @author: Rachid Ounit, Ph.D Candidate.
+ * @project: CLARK, Metagenomic and Genomic Sequences Classification project.
+ * @note: C++ IMPLEMENTATION supported on latest Linux and Mac OS.
+ *
+ */
+#ifndef BUILDCHECKPOINT_HH
+#define BUILDCHECKPOINT_HH
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cstdio>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "./dataType.hh"
+#include "./motherIndex.hh"
+
+#define CKMAGIC		0x314b434b52414c43ULL	// "CLARKCK1"
+#define CKVERSION	1
+#define CKSEGMENT	0x5447454d4753434bULL	// Start of a segment
+#define CKEND		0x444e45544753434bULL	// End of a segment
+
+//	CLASS
+//	Name: buildCheckpoint
+//	Implementation notes: Journal of the checkpoints of a build (<db>.ckp), written by the building thread.
+//	A header (settings and labels), then one segment per checkpoint: the targets processed since the previous
+//	one, the bases read so far and the buckets changed since (hTable::dumpChanged). A segment counts once its
+//	end mark is written, so a build stopped while writing one resumes from the previous one. The journal is
+//	rewritten with all the buckets (first segment) when the segments appended outgrow it.
+//
+class buildCheckpoint
+{
+	public:
+	buildCheckpoint(const std::string& _file, const size_t& _k, const size_t& _s, const bool& _canonical, const size_t& _keyBytes, const size_t& _cellBytes):
+		m_file(_file), m_cellBytes(_cellBytes), m_cursor(0), m_bytes(0), m_base(0)
+	{
+		m_header.magic 	   = CKMAGIC;
+		m_header.version   = CKVERSION;
+		m_header.k 	   = _k;
+		m_header.nbBuckets = HTSIZE;
+		m_header.keyBytes  = _keyBytes;
+		m_header.cellBytes = _cellBytes;
+		m_header.s 	   = _s;
+		m_header.canonical = _canonical ? 1: 0;
+		m_header.nbLabels  = 0;
+	}
+
+	// Checkpoint of the first targets of _targets/_ids (the ones processed), _nt bases read
+	template <typename TABLE>
+	bool write(TABLE& _table, const std::vector<std::string>& _targets, const std::vector<std::string>& _ids, const uint64_t& _nt)
+	{
+		if (m_bytes == 0 || m_bytes > 2 * m_base)
+		{	return rewrite(_table, _targets, _ids, _nt);	}
+		FILE* fd = fopen(m_file.c_str(), "a");
+		bool done = fd != NULL && writeSegment(fd, _table, false, _targets, _ids, _nt);
+		done = fd != NULL && fclose(fd) == 0 && done;
+		if (!done)
+		{
+			// Changes of the segment lost: the next checkpoint writes all the buckets
+			if (truncate(m_file.c_str(), m_bytes) != 0)
+			{	remove();	}
+			m_bytes = 0;
+			return false;
+		}
+		m_cursor = _targets.size();
+		m_bytes = fileSize();
+		return true;
+	}
+
+	// Table of the last checkpoint restored when its targets are the first ones of _targets/_ids (same
+	// files, positions and labels); _cursor is then the number of targets processed, 0 otherwise.
+	// False if the journal cannot be read once the table is changed.
+	template <typename TABLE>
+	bool restore(TABLE& _table, const std::vector<std::string>& _targets, const std::vector<std::string>& _ids, size_t& _cursor, uint64_t& _nt)
+	{
+		_cursor = 0;
+		_nt = 0;
+		FILE* fd = fopen(m_file.c_str(), "r");
+		if (fd == NULL)
+		{
+			std::cerr << "No checkpoint of the build [" << m_file << "]: starting from the first target." << std::endl;
+			return true;
+		}
+		Header header;
+		std::vector<std::string> labels;
+		if (fread(&header, sizeof(Header), 1, fd) != 1 || header.magic != CKMAGIC || header.version != CKVERSION || header.nbBuckets != HTSIZE ||
+			header.k != m_header.k || header.s != m_header.s || header.canonical != m_header.canonical || header.keyBytes != m_header.keyBytes ||
+			header.cellBytes != m_header.cellBytes || !motherIndex::readStrings(fd, labels, header.nbLabels))
+		{
+			std::cerr << "The checkpoint " << m_file << " was made with other settings: starting from the first target." << std::endl;
+			fclose(fd);
+			return true;
+		}
+		std::vector<ILBL> ids(labels.size());
+		bool same = true;
+		for(size_t l = 0; same && l < labels.size(); l++)
+		{	same = _table.getTargetID(labels[l], ids[l]);	}
+		// Segments complete and of the same targets, then applied in order
+		const long start = ftell(fd);
+		long end = start;
+		size_t cursor = 0, nbSegments = 0;
+		uint64_t nt = 0;
+		long base = 0;
+		while (same && readSegment(fd, _targets, _ids, cursor, nt, false))
+		{
+			end = ftell(fd);
+			base = nbSegments == 0 ? end: base;
+			nbSegments++;
+		}
+		if (nbSegments == 0)
+		{
+			std::cerr << "The checkpoint " << m_file << " was made with other targets, or is incomplete: starting from the first target." << std::endl;
+			fclose(fd);
+			return true;
+		}
+		fseek(fd, start, SEEK_SET);
+		cursor = 0;
+		for(size_t g = 0; g < nbSegments; g++)
+		{
+			if (!readSegment(fd, _targets, _ids, cursor, nt, true) || !_table.RestoreBuckets(fd, ids) || !readEnd(fd))
+			{
+				std::cerr << "Failed to read the checkpoint " << m_file << " (remove it to start from the first target)." << std::endl;
+				fclose(fd);
+				return false;
+			}
+		}
+		fclose(fd);
+		// Segment not ended (build stopped while writing it) dropped
+		if (fileSize() > (uint64_t) end && truncate(m_file.c_str(), end) != 0)
+		{	end = 0;	}
+		m_cursor = _cursor = cursor;
+		m_bytes = end;
+		m_base = base;
+		_nt = nt;
+		return true;
+	}
+
+	void remove()
+	{
+		std::remove(m_file.c_str());
+		m_cursor = 0;
+		m_bytes = 0;
+	}
+
+	private:
+	struct Header
+	{
+		uint64_t	magic;
+		uint32_t	version;
+		uint32_t	k;
+		uint64_t	nbBuckets;
+		uint32_t	keyBytes;
+		uint32_t	cellBytes;	// sizeof(htCell) of the table
+		uint32_t	s;		// Length of the s-mers of the syncmers (0 if none)
+		uint32_t	canonical;	// 1 if the keys are in canonical orientation
+		uint64_t	nbLabels;
+	};
+
+	buildCheckpoint(const buildCheckpoint&);
+	buildCheckpoint& operator=(const buildCheckpoint&);
+
+	uint64_t fileSize() const
+	{
+		struct stat st;
+		return stat(m_file.c_str(), &st) == 0 ? st.st_size: 0;
+	}
+
+	// Journal written again, with one segment of all the buckets (under a temporary name, then renamed)
+	template <typename TABLE>
+	bool rewrite(TABLE& _table, const std::vector<std::string>& _targets, const std::vector<std::string>& _ids, const uint64_t& _nt)
+	{
+		const std::string tmp = m_file + ".tmp";
+		FILE* fd = fopen(tmp.c_str(), "w");
+		if (fd == NULL)
+		{	return false;	}
+		Header header = m_header;
+		header.nbLabels = _table.GetLabels().size();
+		m_cursor = 0;
+		bool done = fwrite(&header, sizeof(Header), 1, fd) == 1 && motherIndex::writeStrings(fd, _table.GetLabels());
+		done = done && writeSegment(fd, _table, true, _targets, _ids, _nt);
+		done = fclose(fd) == 0 && done;
+		if (!done || rename(tmp.c_str(), m_file.c_str()) != 0)
+		{
+			std::remove(tmp.c_str());
+			m_bytes = 0;
+			return false;
+		}
+		m_cursor = _targets.size();
+		m_bytes = m_base = fileSize();
+		return true;
+	}
+
+	// Segment of the targets from m_cursor, the buckets changed (all with _all), then the end mark once
+	// the rest is on disk
+	template <typename TABLE>
+	bool writeSegment(FILE* _fd, TABLE& _table, const bool& _all, const std::vector<std::string>& _targets, const std::vector<std::string>& _ids, const uint64_t& _nt) const
+	{
+		const std::vector<std::string> targets(_targets.begin() + m_cursor, _targets.end()), ids(_ids.begin() + m_cursor, _ids.end());
+		const uint64_t head[4] = {CKSEGMENT, _targets.size(), _nt, targets.size()}, end = CKEND;
+		bool done = fwrite(head, sizeof(uint64_t), 4, _fd) == 4 && motherIndex::writeStrings(_fd, targets) && motherIndex::writeStrings(_fd, ids);
+		done = done && _table.DumpChanged(_fd, _all);
+		done = done && fflush(_fd) == 0 && fsync(fileno(_fd)) == 0;
+		return done && fwrite(&end, sizeof(uint64_t), 1, _fd) == 1;
+	}
+
+	// Head of a segment, its targets checked against _targets/_ids from _cursor (then moved to the end of
+	// the segment). Without _apply, the buckets and the end mark are read too (skipping the cells).
+	bool readSegment(FILE* _fd, const std::vector<std::string>& _targets, const std::vector<std::string>& _ids, size_t& _cursor, uint64_t& _nt, const bool& _apply) const
+	{
+		uint64_t head[4];
+		std::vector<std::string> targets, ids;
+		if (fread(head, sizeof(uint64_t), 4, _fd) != 4 || head[0] != CKSEGMENT || head[1] != _cursor + head[3] || head[1] > _targets.size() ||
+			!motherIndex::readStrings(_fd, targets, head[3]) || !motherIndex::readStrings(_fd, ids, head[3]))
+		{	return false;	}
+		for(size_t t = 0; t < targets.size(); t++)
+		{
+			if (targets[t] != _targets[_cursor + t] || ids[t] != _ids[_cursor + t])
+			{	return false;	}
+		}
+		_cursor = head[1];
+		_nt = head[2];
+		if (_apply)
+		{	return true;	}
+		uint64_t bucket[2];
+		while (fread(bucket, sizeof(uint64_t), 1, _fd) == 1 && bucket[0] < HTSIZE)
+		{
+			if (fread(bucket + 1, sizeof(uint64_t), 1, _fd) != 1 || fseek(_fd, bucket[1] * m_cellBytes, SEEK_CUR) != 0)
+			{	return false;	}
+		}
+		return bucket[0] == HTSIZE && readEnd(_fd);
+	}
+
+	static bool readEnd(FILE* _fd)
+	{
+		uint64_t end = 0;
+		return fread(&end, sizeof(uint64_t), 1, _fd) == 1 && end == CKEND;
+	}
+
+	const std::string	m_file;
+	const size_t		m_cellBytes;
+	Header			m_header;
+	size_t			m_cursor;	// Targets in the journal
+	uint64_t		m_bytes;	// Size of the journal (0: none yet)
+	uint64_t		m_base;		// Size of the journal when last rewritten
+};
+
+#endif
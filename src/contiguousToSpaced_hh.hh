@@ -38,8 +38,15 @@
 #include <cstring>
 
 #include <stdint.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
 #include "./hashTable_hh.hh"
 #include "./dataType.hh"
+#include "./spacedKmer.hh"
 
 template <typename HKMERr, typename HKMERrs>
 class contiguousTospaced
@@ -49,23 +56,40 @@ class contiguousTospaced
 		size_t				m_weight;
 		size_t				m_len;
 		string				m_setting;
+		spacedKmer			m_seed;
 	public:
-		contiguousTospaced():m_sTable(), m_weight(22), m_len(31), m_setting("T295"){}
+		contiguousTospaced():m_sTable(), m_weight(22), m_len(31), m_setting("T295"), m_seed("T295"){}
 
-		contiguousTospaced(const size_t& _weight, const std::string& _setting, const size_t& _len = 31):m_sTable(), m_weight(_weight), m_setting(_setting), m_len(_len)	
+		contiguousTospaced(const size_t& _weight, const std::string& _setting, const size_t& _len = 31):m_sTable(), m_weight(_weight), m_len(_len), m_setting(_setting), m_seed(_setting)
 	{
+		if (m_seed.getWeight() != m_weight || m_seed.getLength() != m_len)
+		{
+			cerr << "The spaced seed " << m_seed.getName() << " has weight " << m_seed.getWeight() << " and length " << m_seed.getLength();
+			cerr << ", but weight " << m_weight << " and length " << m_len << " were requested." << endl;
+			exit(1);
+		}
 	}
 
+		contiguousTospaced(const spacedKmer& _seed):m_sTable(), m_weight(_seed.getWeight()), m_len(_seed.getLength()), m_setting(_seed.getName()), m_seed(_seed)
+	{}
+
 		~contiguousTospaced(){}
 
 		void populate(const char* _filename);
+		void populate(const uint8_t* _sizes, const HKMERr* _keys, const ILBL* _labels, const loadIndex& _index);
 		void write(const char* _filename);
+
+		// Tables of all the seeds from the same contiguous database, merged in _merged
+		static bool populate(const char* 				_filename,
+				const std::vector<spacedKmer>& 			_seeds,
+				hTable<HKMERrs,bigElement>& 			_merged,
+				const size_t& 					_nbCPU
+				);
 	private:
 		bool update(const uint64_t& _km, const ILBL& _lbl);
 
 };
 
-#endif //  CONTIGUOUSTOSPACED_HH
 
 #include "./kmersConversion.hh"
 
@@ -91,6 +115,9 @@ void contiguousTospaced<HKMERr,HKMERrs>::populate(const char* _filename)
 	{       std::cerr << "Failed to open " << file_key << std::endl; return;   }
 	if (fd_s == NULL)
 	{       std::cerr << "Failed to open " << file_sze << std::endl; return;   }
+	loadIndex longs;
+	if (!longs.readLong(std::string(_filename) + ".sx"))
+	{       std::cerr << "Failed to read " << _filename << ".sx" << std::endl; return;   }
 
 
 	ITYPE t = 0, i  = 0;
@@ -112,10 +139,11 @@ void contiguousTospaced<HKMERr,HKMERrs>::populate(const char* _filename)
 		{
 			if (c[i] > 0)
 			{
-				nbElement += c[i];
+				const uint64_t size = longs.getSize(t, c[i]);
+				nbElement += size;
 				u = 0;
 				v_c = v;
-				while (u < c[i])
+				while (u < size)
 				{
 					if (v_c < len_l)
 					{
@@ -154,12 +182,80 @@ void contiguousTospaced<HKMERr,HKMERrs>::populate(const char* _filename)
 	std::cerr << nbElement << " contiguous k-mers were successfully processed. " << std::endl;
 }
 
+	template <typename HKMERr, typename HKMERrs>
+void contiguousTospaced<HKMERr,HKMERrs>::populate(const uint8_t* _sizes, const HKMERr* _keys, const ILBL* _labels, const loadIndex& _index)
+{
+	// Same order as populate(_filename): buckets, then cells of the files
+	uint64_t v = 0;
+	for(ITYPE t = 0; t < HTSIZE; t++)
+	{
+		const uint64_t c = _sizes[t] < LONGBUCKET ? _sizes[t]: _index.getSize(t, _sizes[t]);
+		for(uint64_t u = 0; u < c; u++, v++)
+		{	update((uint64_t) t + ((uint64_t) HTSIZE * ((uint64_t) _keys[v])), _labels[v]);	}
+	}
+	m_sTable.sortall(2);
+}
+
+	template <typename HKMERr, typename HKMERrs>
+bool contiguousTospaced<HKMERr,HKMERrs>::populate(const char* _filename, const std::vector<spacedKmer>& _seeds, hTable<HKMERrs,bigElement>& _merged, const size_t& _nbCPU)
+{
+	// Files of the contiguous database mapped once and read by one thread per seed,
+	// then the tables merged bucket by bucket (seed of index i tagged i, as hTable::addDB)
+	const std::string db(_filename), file_sze = db + ".sz", file_key = db + ".ky", file_lbl = db + ".lb";
+	loadIndex index;
+	if (!index.load(db, HTSIZE, _nbCPU))
+	{
+		std::cerr << "Failed to open " << file_sze << std::endl;
+		return false;
+	}
+	const size_t nbElement = index.getElements();
+	int fd_s = open(file_sze.c_str(), O_RDONLY);
+	int fd_k = open(file_key.c_str(), O_RDONLY);
+	int fd_l = open(file_lbl.c_str(), O_RDONLY);
+	if (fd_s == -1 || fd_k == -1 || fd_l == -1 || nbElement == 0)
+	{
+		std::cerr << "Failed to open " << (fd_s == -1 ? file_sze: (fd_k == -1 ? file_key: file_lbl)) << " (or no data)" << std::endl;
+		return false;
+	}
+	uint8_t* sizes = (uint8_t*) mmap(0, HTSIZE, PROT_READ, MAP_SHARED, fd_s, 0);
+	HKMERr* keys = (HKMERr*) mmap(0, nbElement * sizeof(HKMERr), PROT_READ, MAP_SHARED, fd_k, 0);
+	ILBL* labels = (ILBL*) mmap(0, nbElement * sizeof(ILBL), PROT_READ, MAP_SHARED, fd_l, 0);
+	close(fd_s);
+	close(fd_k);
+	close(fd_l);
+	if (sizes == MAP_FAILED || keys == MAP_FAILED || labels == MAP_FAILED)
+	{
+		std::cerr << "Failed to mmapping the file!" << std::endl;
+		return false;
+	}
+	std::vector< contiguousTospaced<HKMERr,HKMERrs>* > converters(_seeds.size());
+	std::vector< hTable<HKMERrs,lElement>* > tables(_seeds.size());
+#ifdef _OPENMP
+	omp_set_num_threads(_nbCPU < _seeds.size() ? _nbCPU: _seeds.size());
+#endif
+#pragma omp parallel for schedule(dynamic)
+	for(size_t s = 0; s < _seeds.size(); s++)
+	{
+		converters[s] = new contiguousTospaced<HKMERr,HKMERrs>(_seeds[s]);
+		converters[s]->populate(sizes, keys, labels, index);
+		tables[s] = &converters[s]->m_sTable;
+	}
+	munmap(sizes, HTSIZE);
+	munmap(keys, nbElement * sizeof(HKMERr));
+	munmap(labels, nbElement * sizeof(ILBL));
+	std::cerr << nbElement << " contiguous k-mers were successfully processed (" << _seeds.size() << " seeds). " << std::endl;
+	_merged.merge(tables, 2, _nbCPU);
+	for(size_t s = 0; s < _seeds.size(); s++)
+	{	delete converters[s];	}
+	return true;
+}
+
 	template <typename HKMERr, typename HKMERrs>
 bool contiguousTospaced<HKMERr,HKMERrs>::update(const uint64_t& _km, const ILBL& _lbl)
 {
 	uint64_t skm = 0;
 	// Try forward
-	getSpacedSeed(m_setting, _km, skm);
+	m_seed.getSpaced(_km, skm);
 	size_t xE, yE;
 	ILBL h;
 	IOCCR mult;
@@ -178,7 +274,7 @@ bool contiguousTospaced<HKMERr,HKMERrs>::update(const uint64_t& _km, const ILBL&
 	uint64_t _ikmerR = _km, skmr =0;
 	
 	getReverseComplement(_km, m_len, _ikmerR);
-	getSpacedSeed(m_setting, _ikmerR, skmr);
+	m_seed.getSpaced(_ikmerR, skmr);
 	if (m_sTable.find(skmr, xE, yE, h, mult, count))
 	{
 		if (_lbl != h)
@@ -204,3 +300,5 @@ void contiguousTospaced<HKMERr,HKMERrs>::write(const char* _filename)
 	m_sTable.sortall(2);
 	m_sTable.write(newfilename, 2, false);
 }
+
+#endif //  CONTIGUOUSTOSPACED_HH
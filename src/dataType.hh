@@ -38,6 +38,8 @@ typedef uint32_t        ITYPE;
 typedef uint8_t        	IOCCR;
 typedef uint16_t	ILBL;
 
+#define NOLABEL		((ILBL) -1)	// No label (parent of a root, multi-rank database)
+
 struct IKMER
 {
 	uint64_t         skmer[SB];
@@ -228,6 +230,13 @@ template <typename T> struct sVector
                 idx = _size;
                 cap = _size;
         }
+	// Points to _size elements owned by an arena (cap = 0: never freed nor grown)
+	void attach(T* _ptr, const size_t& _size)
+	{
+		ptr = _ptr;
+		idx = _size;
+		cap = 0;
+	}
         void reset(const size_t& _size)
 	{
 		memset(ptr,0,_size*sizeof(T));
@@ -253,6 +262,10 @@ template <typename T> struct sVector
                         ptr = ptr_n;
                 }
         }
+        void pop_back()
+        {
+                idx--;
+        }
         T& operator[](const size_t& _pos) const
         {
                 return ptr[_pos];
@@ -267,7 +280,8 @@ template <typename T> struct sVector
         }
         void clear()
         {
-                free(ptr);
+                if (cap > 0 || idx == 0)
+                {       free(ptr);      }
                 ptr = NULL;
                 idx = 0;
                 cap = 0;
@@ -296,6 +310,10 @@ struct Element
 	{	Count = Count.getCount() + _count; 	}
 	void IncreaseMultiplicity(const IOCCR& val = 1) 
 	{ 	Multiplicity += Multiplicity < 254?val:0;	}
+	void DecreaseMultiplicity(const IOCCR& val = 1)
+	{	Multiplicity -= val;	}
+	void SetReversed()
+	{	Multiplicity--;	}
 	void Mark()	
 	{	Count = 0;	}	
 	void Unmark()
@@ -327,6 +345,14 @@ struct lElement
         { 	Count += ((size_t) Count) + _count < 255 ? _count: 0;	}
         void IncreaseMultiplicity(const IOCCR& val = 1)
         {       Multiplicity += Multiplicity < 254? val: 0;       }
+	void DecreaseMultiplicity(const IOCCR& val = 1)
+	{	Multiplicity -= val;	}
+	// Table of a partial build (multiplicity odd, raised by 2): even when the first occurrence of the
+	// k-mer is in the other orientation than its key
+	void SetReversed()
+	{	Multiplicity--;	}
+	bool Reversed() const
+	{	return (Multiplicity & 1) == 0;	}
         void Unmark()
         {       Count = 1;      }
 	void Mark()
@@ -350,12 +376,15 @@ struct rElement
         size_t GetCount() const { return 1;}
         void AddToCount(const size_t& _count) {}
         void IncreaseMultiplicity(const IOCCR& val = 1) {}
+        void DecreaseMultiplicity(const IOCCR& val = 1) {}
+        void SetReversed() {}
 	void Unmark()	{;}
 	void Mark()	{;}
 	bool Marked() const {return true;}
 };
 
 #define NV 16383
+#define NBSEEDS 3	// The seed index is stored in the 2 upper bits of bigElement
 
 struct bigElement
 {
@@ -388,6 +417,8 @@ struct bigElement
 	size_t GetCount() const { return 1;	}
         void AddToCount(const size_t& _count) {}
         void IncreaseMultiplicity(const IOCCR& val = 1) {}
+        void DecreaseMultiplicity(const IOCCR& val = 1) {}
+        void SetReversed() {}
         void Unmark()   {;}
         void Mark()     {;}
         bool Marked() const {return true;	}
@@ -0,0 +1,537 @@
+/*
+ * CLARK, CLAssifier based on Reduced K-mers.
+ */
+
+/*
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+   Copyright 2013-2017, Rachid Ounit <clark.ucr.help at gmail.com>
+*/
+
+/*
+ * @author: Rachid Ounit, Ph.D Candidate.
+ * @project: CLARK, Metagenomic and Genomic Sequences Classification project.
+ * @note: C++ IMPLEMENTATION supported on latest Linux and Mac OS.
+ *
+ */
+
+#ifndef DBCONTAINER_HH
+#define DBCONTAINER_HH
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cstdio>
+#include <cstring>
+#include <cstddef>
+#include <ctime>
+#include <algorithm>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#include "./loadIndex.hh"
+
+#define CDBMAGIC	0x3142444b52414c43ULL	// "CLARKDB1"
+#define CDBVERSION	3
+#define CDBALIGN	4096			// Alignment of the header and of the sections
+#define CDBCHUNK	(1 << 22)		// Bytes per checksum chunk
+#define CDBEXT		".cdb"
+
+#define CDB_SIZES	0			// Sections: one byte per bucket (.sz)
+#define CDB_KEYS	1			// keys (.ky)
+#define CDB_LABELS	2			// labels (.lb)
+#define CDB_TARGETS	3			// target names, one per line (label 0 is "NA")
+#define CDB_BLOCKS	4			// offsets of the packed blocks (CDB_PACKED)
+#define CDB_LONG	5			// sizes of the long buckets (.sx, see loadIndex)
+#define CDBSECTIONS	6
+
+#define CDB_LEGACY	0			// Database formats: .sz, .ky and .lb files
+#define CDB_RAW		1			// container, keys and labels as in the legacy files
+#define CDB_PACKED	2			// container, keys and labels packed by blocks of IXBLOCK buckets
+
+//	CLASS
+//	Name: dbContainer
+//	Implementation notes: Database in one file (<db>.cdb): a header of CDBALIGN bytes describing the table
+//	(buckets, k, widths of keys and labels, build settings) and the sections, each one aligned on CDBALIGN
+//	bytes so that it can be mapped directly. A section checksum is the hash of the checksums of its chunks
+//	of CDBCHUNK bytes, so sections are verified (and computed) in parallel.
+//	With CDB_PACKED, each block of IXBLOCK buckets is packed independently (decoded in parallel): keys as
+//	differences with the previous key of their bucket (zigzag), labels as indexes in the palette of the
+//	labels of the block, each stream with the smallest number of bits for the block. CDB_BLOCKS gives the
+//	offsets (in 64-bit words) of the streams of each block. Only the file is smaller: the blocks are unpacked
+//	into the buckets of the table at loading (hTable::readContainer), so the queries and the memory are the same.
+//
+class dbContainer
+{
+	public:
+	struct Section
+	{
+		uint64_t	offset;
+		uint64_t	length;
+		uint64_t	checksum;
+	};
+
+	struct Header
+	{
+		uint64_t	magic;
+		uint64_t	version;
+		uint64_t	nbBuckets;
+		uint64_t	elements;	// Keys stored
+		uint64_t	nonEmpty;	// Non-empty buckets
+		uint32_t	k;
+		uint32_t	keyBytes;	// sizeof(HKMERr)
+		uint32_t	labelBytes;	// sizeof(ILBL)
+		uint32_t	nbTargets;	// Lines of the CDB_TARGETS section
+		uint64_t	format;		// CDB_RAW or CDB_PACKED
+		uint64_t	minCount;	// -t
+		uint64_t	iterKmers;	// -g (CLARK-l), 0 otherwise
+		uint64_t	created;	// Unix time of the conversion
+		char		program[64];	// "CLARK <version>"
+		Section		sections[CDBSECTIONS];
+		uint64_t	checksum;	// Of the bytes above
+	};
+
+	dbContainer(): m_fd(-1), m_map(NULL), m_bytes(0)
+	{	memset(&m_header, 0, sizeof(Header));	}
+
+	~dbContainer()
+	{	close();	}
+
+	// Reads and checks the header only
+	bool readHeader(const std::string& _file)
+	{
+		close();
+		FILE* fd = fopen(_file.c_str(), "r");
+		if (fd == NULL)
+		{	return false;	}
+		const bool ok = fread(&m_header, sizeof(Header), 1, fd) == 1;
+		fclose(fd);
+		return ok && isHeaderValid();
+	}
+
+	const Header& getHeader() const
+	{	return m_header;	}
+
+	// Same database settings (the first difference found is stored in _reason). Targets are compared
+	// through the hash of their names, so that the header is enough.
+	bool isCompatible(const Header& _settings, const std::vector<std::string>& _targets, std::string& _reason) const
+	{
+		_reason = "";
+		if (m_header.nbBuckets != _settings.nbBuckets)	{ _reason = "number of buckets"; }
+		else if (m_header.k != _settings.k)		{ _reason = "k-mer length"; }
+		else if (m_header.keyBytes != _settings.keyBytes)	{ _reason = "key width"; }
+		else if (m_header.labelBytes != _settings.labelBytes)	{ _reason = "label width"; }
+		else if (m_header.minCount != _settings.minCount)	{ _reason = "minimum k-mer count (-t)"; }
+		else if (m_header.iterKmers != _settings.iterKmers)	{ _reason = "gap (-g)"; }
+		else if (m_header.nbTargets != _targets.size() || m_header.sections[CDB_TARGETS].checksum != hashTargets(_targets))
+		{	_reason = "targets";	}
+		return _reason.empty();
+	}
+
+	// Maps the whole file and verifies the checksums of all sections (if _verify)
+	bool open(const std::string& _file, const size_t& _nbCPU, const bool& _verify)
+	{
+		if (!readHeader(_file))
+		{
+			std::cerr << "Failed to open " << _file << ": not a database container (version " << CDBVERSION << ")" << std::endl;
+			return false;
+		}
+		m_fd = ::open(_file.c_str(), O_RDONLY);
+		struct stat st;
+		if (m_fd == -1 || fstat(m_fd, &st) != 0)
+		{	return false;	}
+		m_bytes = st.st_size;
+		for(size_t s = 0; s < CDBSECTIONS; s++)
+		{
+			if (m_header.sections[s].offset + m_header.sections[s].length > m_bytes)
+			{
+				std::cerr << "Failed to open " << _file << ": the file is truncated." << std::endl;
+				return false;
+			}
+		}
+		m_map = (uint8_t*) mmap(0, m_bytes, PROT_READ, MAP_SHARED, m_fd, 0);
+		if (m_map == MAP_FAILED)
+		{
+			m_map = NULL;
+			return false;
+		}
+		if (!_verify)
+		{	return true;	}
+		std::vector<uint64_t> sums;
+		checksums(getSections(), sums, _nbCPU);
+		for(size_t s = 0; s < CDBSECTIONS; s++)
+		{
+			if (sums[s] != m_header.sections[s].checksum)
+			{
+				std::cerr << "Failed to open " << _file << ": checksum mismatch in section " << s << "." << std::endl;
+				return false;
+			}
+		}
+		return true;
+	}
+
+	const uint8_t* getSection(const size_t& _s) const
+	{	return m_map + m_header.sections[_s].offset;	}
+
+	// Keys and labels of the block _b of a CDB_PACKED container (_sizes: sizes of the buckets of the block)
+	template <typename KEY, typename LABEL>
+	void unpackBlock(const size_t& _b, const uint8_t* _sizes, const size_t& _nbBuckets, const loadIndex& _index, KEY* _keys, LABEL* _labels) const
+	{
+		const uint64_t* blocks = (const uint64_t*) getSection(CDB_BLOCKS);
+		const uint64_t* keys = (const uint64_t*) getSection(CDB_KEYS) + blocks[2 * _b];
+		const uint64_t* labels = (const uint64_t*) getSection(CDB_LABELS) + blocks[2 * _b + 1];
+		const uint64_t	keyWidth = keys[0], nbPalette = labels[0] & 0xFFFFFFFFULL, labelWidth = labels[0] >> 32;
+		const uint64_t*	palette = labels + 1;
+		uint64_t	pk = 64, pl = 64 * (1 + nbPalette), v = 0, key = 0;
+		for(size_t t = 0; t < _nbBuckets; t++)
+		{
+			key = 0;
+			const uint64_t c = _index.getSize(_b * IXBLOCK + t, _sizes[t]);
+			for(uint64_t u = 0; u < c; u++, v++)
+			{
+				key += unzigzag(getBits(keys, pk, keyWidth));
+				_keys[v] = (KEY) key;
+				_labels[v] = (LABEL) palette[getBits(labels, pl, labelWidth)];
+				pk += keyWidth;
+				pl += labelWidth;
+			}
+		}
+	}
+
+	uint64_t getBytes() const
+	{	return m_bytes;	}
+
+	void close()
+	{
+		if (m_map != NULL)
+		{	munmap(m_map, m_bytes);	}
+		if (m_fd != -1)
+		{	::close(m_fd);	}
+		m_map = NULL;
+		m_fd = -1;
+		m_bytes = 0;
+	}
+
+	// Writes <_db>.cdb from the legacy files <_db>.sz, .ky, .lb (and .sx). _settings gives the fields of the
+	// header that the legacy files do not hold (k, widths, build settings, format). The file is written
+	// under a temporary name and renamed once complete.
+	static bool convert(const std::string& _db, const Header& _settings, const std::vector<std::string>& _targets, const size_t& _nbCPU)
+	{
+		const char* ext[3] = {".sz", ".ky", ".lb"};
+		std::vector<const uint8_t*> data(CDBSECTIONS, (const uint8_t*) NULL);
+		std::vector<uint64_t> lengths(CDBSECTIONS, 0);
+		std::vector<int> fds(3, -1);
+		std::vector<const uint8_t*> maps(3, (const uint8_t*) NULL);
+		std::vector<uint64_t> mapLengths(3, 0);
+		std::string names;
+		for(size_t t = 0; t < _targets.size(); t++)
+		{	names += _targets[t] + "\n";	}
+		data[CDB_TARGETS] = (const uint8_t*) names.c_str();
+		lengths[CDB_TARGETS] = names.size();
+		loadIndex index;
+		bool ok = index.readLong(_db + ".sx");
+		data[CDB_LONG] = index.getLong().empty() ? NULL: (const uint8_t*) &index.getLong().front();
+		lengths[CDB_LONG] = index.getLong().size() * sizeof(std::pair<uint64_t, uint64_t>);
+		for(size_t s = 0; s < 3 && ok; s++)
+		{
+			struct stat st;
+			fds[s] = ::open((_db + ext[s]).c_str(), O_RDONLY);
+			ok = fds[s] != -1 && fstat(fds[s], &st) == 0;
+			mapLengths[s] = ok ? st.st_size: 0;
+			maps[s] = mapLengths[s] > 0 ? (const uint8_t*) mmap(0, mapLengths[s], PROT_READ, MAP_SHARED, fds[s], 0): NULL;
+			ok = ok && maps[s] != MAP_FAILED;
+			data[s] = maps[s];
+			lengths[s] = mapLengths[s];
+		}
+		std::vector<uint64_t> packed[3];
+		if (ok)
+		{
+			Header header = _settings;
+			header.magic = CDBMAGIC;
+			header.version = CDBVERSION;
+			header.nbBuckets = lengths[CDB_SIZES];
+			header.elements = lengths[CDB_KEYS] / header.keyBytes;
+			uint64_t nonEmpty = 0;
+			const uint8_t* sizes = data[CDB_SIZES];
+#ifdef _OPENMP
+			omp_set_num_threads(_nbCPU);
+#endif
+#pragma omp parallel for reduction(+:nonEmpty)
+			for(uint64_t b = 0; b < lengths[CDB_SIZES]; b++)
+			{	nonEmpty += sizes[b] > 0 ? 1: 0;	}
+			header.nonEmpty = nonEmpty;
+			header.nbTargets = _targets.size();
+			header.created = time(NULL);
+			if (header.format == CDB_PACKED)
+			{
+				pack(header, maps, index, packed[0], packed[1], packed[2], _nbCPU);
+				data[CDB_KEYS] = (const uint8_t*) &packed[0].front();
+				data[CDB_LABELS] = (const uint8_t*) &packed[1].front();
+				data[CDB_BLOCKS] = (const uint8_t*) &packed[2].front();
+				for(size_t s = 0; s < 3; s++)
+				{	lengths[s == 2 ? CDB_BLOCKS: CDB_KEYS + s] = packed[s].size() * sizeof(uint64_t);	}
+			}
+			uint64_t offset = CDBALIGN;
+			for(size_t s = 0; s < CDBSECTIONS; s++)
+			{
+				header.sections[s].offset = offset;
+				header.sections[s].length = lengths[s];
+				offset += (lengths[s] + CDBALIGN - 1) / CDBALIGN * CDBALIGN;
+			}
+			std::vector<uint64_t> sums;
+			std::vector< std::pair<const uint8_t*, uint64_t> > sections;
+			for(size_t s = 0; s < CDBSECTIONS; s++)
+			{	sections.push_back(std::make_pair(data[s], lengths[s]));	}
+			checksums(sections, sums, _nbCPU);
+			for(size_t s = 0; s < CDBSECTIONS; s++)
+			{	header.sections[s].checksum = sums[s];	}
+			header.checksum = hash((const uint8_t*) &header, offsetof(Header, checksum), 0);
+			ok = write(_db + CDBEXT, header, data, lengths);
+		}
+		for(size_t s = 0; s < 3; s++)
+		{
+			if (maps[s] != NULL && maps[s] != MAP_FAILED)
+			{	munmap((void*) maps[s], mapLengths[s]);	}
+			if (fds[s] != -1)
+			{	::close(fds[s]);	}
+		}
+		return ok;
+	}
+
+	private:
+	dbContainer(const dbContainer&);
+	dbContainer& operator=(const dbContainer&);
+
+	bool isHeaderValid() const
+	{
+		return m_header.magic == CDBMAGIC && m_header.version == CDBVERSION &&
+			m_header.checksum == hash((const uint8_t*) &m_header, offsetof(Header, checksum), 0);
+	}
+
+	std::vector< std::pair<const uint8_t*, uint64_t> > getSections() const
+	{
+		std::vector< std::pair<const uint8_t*, uint64_t> > sections;
+		for(size_t s = 0; s < CDBSECTIONS; s++)
+		{	sections.push_back(std::make_pair(getSection(s), m_header.sections[s].length));	}
+		return sections;
+	}
+
+	// Packs each block in parallel, then appends the streams of the blocks in order
+	static void pack(const Header& _header, const std::vector<const uint8_t*>& _legacy, loadIndex& _index, std::vector<uint64_t>& _keys, std::vector<uint64_t>& _labels, std::vector<uint64_t>& _blocks, const size_t& _nbCPU)
+	{
+		const uint8_t* 	sizes = _legacy[CDB_SIZES];
+		const size_t	nbBlocks = (_header.nbBuckets + IXBLOCK - 1) / IXBLOCK;
+		_index.build(sizes, _header.nbBuckets, _nbCPU);
+		std::vector< std::vector<uint64_t> > keys(nbBlocks), labels(nbBlocks);
+#pragma omp parallel
+		{
+			std::vector<uint64_t> deltas, palette, lbl;
+#pragma omp for schedule(dynamic)
+			for(size_t b = 0; b < nbBlocks; b++)
+			{
+				const size_t len = b + 1 < nbBlocks ? IXBLOCK: _header.nbBuckets - b * IXBLOCK;
+				const uint64_t e = _index.getElements(b), n = _index.getElements(b + 1) - e;
+				deltas.resize(n);
+				lbl.resize(n);
+				uint64_t v = 0, prev = 0, maxDelta = 0;
+				for(size_t t = 0; t < len; t++)
+				{
+					prev = 0;
+					const uint64_t c = _index.getSize(b * IXBLOCK + t, sizes[b * IXBLOCK + t]);
+					for(uint64_t u = 0; u < c; u++, v++)
+					{
+						const uint64_t key = getValue(_legacy[CDB_KEYS], e + v, _header.keyBytes);
+						deltas[v] = zigzag(key - prev);
+						maxDelta |= deltas[v];
+						prev = key;
+						lbl[v] = getValue(_legacy[CDB_LABELS], e + v, _header.labelBytes);
+					}
+				}
+				palette = lbl;
+				std::sort(palette.begin(), palette.end());
+				palette.erase(std::unique(palette.begin(), palette.end()), palette.end());
+				const uint64_t keyWidth = getWidth(maxDelta), labelWidth = getWidth(palette.empty() ? 0: palette.size() - 1);
+				uint64_t pos = 64;
+				keys[b].assign(1 + (n * keyWidth + 63) / 64, 0);
+				keys[b][0] = keyWidth;
+				for(uint64_t u = 0; u < n; u++, pos += keyWidth)
+				{	putBits(&keys[b].front(), pos, deltas[u], keyWidth);	}
+				pos = 64 * (1 + palette.size());
+				labels[b].assign(1 + palette.size() + (n * labelWidth + 63) / 64, 0);
+				labels[b][0] = palette.size() | (labelWidth << 32);
+				std::copy(palette.begin(), palette.end(), labels[b].begin() + 1);
+				for(uint64_t u = 0; u < n; u++, pos += labelWidth)
+				{	putBits(&labels[b].front(), pos, std::lower_bound(palette.begin(), palette.end(), lbl[u]) - palette.begin(), labelWidth);	}
+			}
+		}
+		_keys.clear();
+		_labels.clear();
+		_blocks.clear();
+		for(size_t b = 0; b < nbBlocks; b++)
+		{
+			_blocks.push_back(_keys.size());
+			_blocks.push_back(_labels.size());
+			_keys.insert(_keys.end(), keys[b].begin(), keys[b].end());
+			_labels.insert(_labels.end(), labels[b].begin(), labels[b].end());
+			std::vector<uint64_t>().swap(keys[b]);
+			std::vector<uint64_t>().swap(labels[b]);
+		}
+		_blocks.push_back(_keys.size());
+		_blocks.push_back(_labels.size());
+	}
+
+	// Value _i of an array of little-endian values of _bytes bytes
+	static uint64_t getValue(const uint8_t* _data, const uint64_t& _i, const size_t& _bytes)
+	{
+		uint64_t v = 0;
+		memcpy(&v, _data + _i * _bytes, _bytes);
+		return v;
+	}
+
+	static uint64_t getWidth(uint64_t _max)
+	{
+		uint64_t w = 0;
+		for(; _max > 0; _max >>= 1)
+		{	w++;	}
+		return w;
+	}
+
+	static uint64_t zigzag(const uint64_t& _v)
+	{	return (_v << 1) ^ (uint64_t) ((int64_t) _v >> 63);	}
+
+	static uint64_t unzigzag(const uint64_t& _v)
+	{	return (_v >> 1) ^ (~(_v & 1) + 1);	}
+
+	// _width bits (at most 64) at the bit _pos of _words
+	static uint64_t getBits(const uint64_t* _words, const uint64_t& _pos, const uint64_t& _width)
+	{
+		if (_width == 0)
+		{	return 0;	}
+		const uint64_t w = _pos >> 6, o = _pos & 63, mask = _width == 64 ? ~0ULL: (1ULL << _width) - 1;
+		uint64_t v = _words[w] >> o;
+		if (o + _width > 64)
+		{	v |= _words[w + 1] << (64 - o);	}
+		return v & mask;
+	}
+
+	static void putBits(uint64_t* _words, const uint64_t& _pos, const uint64_t& _value, const uint64_t& _width)
+	{
+		if (_width == 0)
+		{	return;	}
+		const uint64_t w = _pos >> 6, o = _pos & 63;
+		_words[w] |= _value << o;
+		if (o + _width > 64)
+		{	_words[w + 1] |= _value >> (64 - o);	}
+	}
+
+	static bool write(const std::string& _file, const Header& _header, const std::vector<const uint8_t*>& _data, const std::vector<uint64_t>& _lengths)
+	{
+		const std::string tmp = _file + ".tmp";
+		FILE* fd = fopen(tmp.c_str(), "w");
+		if (fd == NULL)
+		{	return false;	}
+		const std::vector<uint8_t> zeros(CDBALIGN, 0);
+		bool ok = fwrite(&_header, sizeof(Header), 1, fd) == 1;
+		ok = ok && fwrite(&zeros.front(), 1, CDBALIGN - sizeof(Header), fd) == CDBALIGN - sizeof(Header);
+		for(size_t s = 0; s < CDBSECTIONS && ok; s++)
+		{
+			const uint64_t pad = (CDBALIGN - _lengths[s] % CDBALIGN) % CDBALIGN;
+			ok = fwrite(_data[s], 1, _lengths[s], fd) == _lengths[s] && fwrite(&zeros.front(), 1, pad, fd) == pad;
+		}
+		ok = fclose(fd) == 0 && ok;
+		if (!ok || rename(tmp.c_str(), _file.c_str()) != 0)
+		{
+			remove(tmp.c_str());
+			return false;
+		}
+		return true;
+	}
+
+	// Checksums of the sections, all chunks of all sections hashed in parallel
+	static void checksums(const std::vector< std::pair<const uint8_t*, uint64_t> >& _sections, std::vector<uint64_t>& _sums, const size_t& _nbCPU)
+	{
+		std::vector<size_t> first(_sections.size() + 1, 0);
+		for(size_t s = 0; s < _sections.size(); s++)
+		{	first[s + 1] = first[s] + (_sections[s].second + CDBCHUNK - 1) / CDBCHUNK;	}
+		std::vector<uint64_t> chunks(first.back(), 0);
+#ifdef _OPENMP
+		omp_set_num_threads(_nbCPU);
+#endif
+#pragma omp parallel for schedule(dynamic)
+		for(size_t c = 0; c < chunks.size(); c++)
+		{
+			size_t s = 0;
+			while (first[s + 1] <= c)
+			{	s++;	}
+			const uint64_t start = (uint64_t) (c - first[s]) * CDBCHUNK;
+			const uint64_t len = _sections[s].second - start < CDBCHUNK ? _sections[s].second - start: CDBCHUNK;
+			chunks[c] = hash(_sections[s].first + start, len, c - first[s]);
+		}
+		_sums.assign(_sections.size(), 0);
+		for(size_t s = 0; s < _sections.size(); s++)
+		{
+			uint64_t h = _sections[s].second;
+			for(size_t c = first[s]; c < first[s + 1]; c++)
+			{	h = mix(h ^ chunks[c]);	}
+			_sums[s] = h;
+		}
+	}
+
+	static uint64_t hashTargets(const std::vector<std::string>& _targets)
+	{
+		std::string names;
+		for(size_t t = 0; t < _targets.size(); t++)
+		{	names += _targets[t] + "\n";	}
+		std::vector< std::pair<const uint8_t*, uint64_t> > sections(1, std::make_pair((const uint8_t*) names.c_str(), (uint64_t) names.size()));
+		std::vector<uint64_t> sums;
+		checksums(sections, sums, 1);
+		return sums[0];
+	}
+
+	// 64-bit hash of _len bytes (8 bytes per step)
+	static uint64_t hash(const uint8_t* _data, const uint64_t& _len, const uint64_t& _seed)
+	{
+		uint64_t h = mix(_seed ^ _len), w = 0, i = 0;
+		for(; i + 8 <= _len; i += 8)
+		{
+			memcpy(&w, _data + i, 8);
+			h = (h ^ mix(w)) * 0x9e3779b97f4a7c15ULL;
+		}
+		w = 0;
+		memcpy(&w, _data + i, _len - i);
+		return mix(h ^ w);
+	}
+
+	static uint64_t mix(uint64_t _h)
+	{
+		_h ^= _h >> 33;
+		_h *= 0xff51afd7ed558ccdULL;
+		_h ^= _h >> 33;
+		_h *= 0xc4ceb9fe1a85ec53ULL;
+		_h ^= _h >> 33;
+		return _h;
+	}
+
+	Header		m_header;
+	int		m_fd;
+	uint8_t*	m_map;
+	uint64_t	m_bytes;
+};
+
+#endif
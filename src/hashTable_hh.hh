@@ -33,6 +33,13 @@
 #include<stdint.h>
 #include<string>
 #include "./dataType.hh"
+#include "./bloomFilter.hh"
+#include "./memoryArena.hh"
+#include "./sharedSegment.hh"
+#include "./loadIndex.hh"
+#include "./dbContainer.hh"
+
+#define SCANBUCKET	32	// Cells of a bucket scanned linearly by find()
 #include "stdint.h"
 
 template <typename HKMERr, typename ELMTr> struct htCell
@@ -71,6 +78,76 @@ class hTable
 		size_t							m_it_x;
 		size_t							m_it_y;
 		uint8_t							m_k;
+		bloomFilter						m_filter;
+		size_t							m_policy;	// NUMA placement (numaPolicy)
+		size_t							m_pages;	// Pages of the buckets (PAGES_*)
+		memoryArena						m_arena;	// Buckets, when a placement or huge pages are set
+		std::vector< memoryArena* >				m_replicaArenas;
+		std::vector< const sVector< htCell<HKMERr,ELMTr> >* >	m_replicas;	// Bucket headers of each node
+		bool							m_shared;	// Database in shared memory
+		sharedSegment						m_segment;	// Bucket headers, then buckets
+		bool							m_container;	// Database in one file (dbContainer)
+		std::vector<uint64_t>					m_changed;	// Buckets changed since the last checkpoint (one bit each)
+
+		template <typename HKMERo, typename ELMTo> friend class hTable;
+
+		void touch(const size_t&			_xElement
+				)
+		{
+			if (!m_changed.empty())
+			{	m_changed[_xElement >> 6] |= 1ULL << (_xElement & 63);	}
+		}
+
+		// Buckets local to the calling thread
+		const sVector< htCell<HKMERr,ELMTr> >* getTable() const
+		{	return m_replicas.empty() ? &m_table.front() : m_replicas[numaPolicy::getThreadNode() % m_replicas.size()];	}
+
+		// First cell of the sorted bucket to scan for _quotient: cells before it are smaller
+		// (binary search down to SCANBUCKET cells, for long buckets)
+		static const htCell<HKMERr,ELMTr>* seek(const sVector< htCell<HKMERr,ELMTr> >& _bucket, const size_t& _quotient)
+		{
+			const htCell<HKMERr,ELMTr>* ptr = &_bucket.front();
+			size_t count = _bucket.size(), half = 0;
+			while (count > SCANBUCKET)
+			{
+				half = count >> 1;
+				if (ptr[half].CKey < _quotient)
+				{
+					ptr += half + 1;
+					count -= half + 1;
+					continue;
+				}
+				count = half;
+			}
+			return ptr;
+		}
+
+		bool useArena() const
+		{	return m_policy != NUMA_NONE || m_pages != PAGES_DEFAULT || m_shared;	}
+
+		void fillBlock(const size_t&			_b,
+				const uint8_t*			_sizes,
+				const HKMERr*			_keys,
+				const ILBL*			_labels,
+				const loadIndex&		_index,
+				const ITYPE&			_modCollision
+				);
+
+		bool readContainer(const std::string&		_file,
+				size_t& 			_fileSize,
+				const size_t&	 		_nbCPU,
+				const ITYPE&			_modCollision
+				);
+
+		void initArena(const size_t& _bytes);
+		void finishArena();
+		bool openShared(const std::vector<std::string>&	_filesname,
+				const size_t& 			_modCollision,
+				size_t& 			_fileSize
+				);
+		void publishShared();
+		void replicate();
+		void reportMemory() const;
 
 	public:
 		hTable();
@@ -109,19 +186,23 @@ class hTable
 				ICount& _count
 			 ) const;
 
+		// Queries of the thread _thread (see mayContain)
 		bool find(const IKMER& 				_ikmer,
 				const size_t& 			_reminderI, 
 				const size_t& 			_quotientI, 
-				ILBL& _label
+				ILBL& _label,
+				const size_t&			_thread
 			 ) const;
 
 		bool find(const uint64_t&                       _ikmer,
-				ILBL&                           _label
+				ILBL&                           _label,
+				const size_t&			_thread
 			 );
 
 		bool find(const uint64_t& 			_ikmer, 
 				const uint64_t& 		_ikmerR, 
-				ILBL& 				_label
+				ILBL& 				_label,
+				const size_t&			_thread
 			 ) const;
 
 		bool findFwd(const uint64_t& 			_ikmer, 
@@ -129,6 +210,43 @@ class hTable
 				const size_t& 			_idHt
 			    ) const;
 
+		void prefetch(const uint64_t&			_ikmer
+			     ) const;
+
+		void buildFilter(const size_t&			_bitsPerKey,
+				const size_t&			_maxBytes,
+				const size_t&			_nbCPU
+				);
+
+		const bloomFilter& getFilter() const
+		{	return m_filter;	}
+
+		// To call before read() or addDB()
+		void setPlacement(const size_t&			_policy
+				)
+		{	m_policy = _policy;	}
+
+		void setPages(const size_t&			_pages
+				)
+		{	m_pages = _pages;	}
+
+		void setShared(const bool&			_shared
+				)
+		{	m_shared = _shared;	}
+
+		void setContainer(const bool&			_container
+				)
+		{	m_container = _container;	}
+
+		// False when the k-mer is surely absent (filter enabled), query of the thread _thread (counters of the filter)
+		bool mayContain(const uint64_t&			_ikmer,
+				const size_t&			_thread
+				) const
+		{	return !m_filter.isEnabled() || m_filter.contains(_ikmer, _thread);	}
+
+		void prefetchBucket(const uint64_t&		_ikmer
+			     ) const;
+
 		void updateElement(const size_t&	 	_xElement, 
 				const size_t& 			_yElement, 
 				const size_t& 			_count, 
@@ -142,8 +260,45 @@ class hTable
                                 const bool&                     _isSameLbl
                                 );
 
+		void relabelElement(const size_t&		_xElement,
+				const size_t&			_yElement,
+				const size_t&			_count,
+				const ILBL&			_label
+				);
+
 		void clear();
 
+		bool removeCount(const size_t&			_xElement,
+				const size_t& 			_yElement,
+				const size_t& 			_count,
+				const bool&			_isSameLbl = true
+				);
+
+		size_t removeLabel(const ILBL&			_label,
+				const ILBL& 			_common,
+				size_t& 			_kept
+				);
+
+		bool dump(FILE*					_fd,
+				const size_t& 			_iteratorPos
+			 ) const;
+
+		// Buckets changed tracked from now on (see buildCheckpoint)
+		void trackChanges()
+		{	m_changed.assign((m_table.size() + 63) >> 6, 0);	}
+
+		bool dumpChanged(FILE*				_fd,
+				const bool& 			_all
+				);
+
+		bool restoreBuckets(FILE*			_fd,
+				const std::vector<ILBL>&	_labels
+				);
+
+		bool restore(FILE*				_fd,
+				const std::vector<ILBL>&	_labels
+			    );
+
 		uint64_t write(const char*	 		_fileht, 
 				const size_t& 			iteratorPos, 
 				const bool& 			_clearAfter = true
@@ -161,6 +316,12 @@ class hTable
 				const ITYPE&                    _modCollision = 1  
 			);
 
+		template <typename ELMTs>
+		void merge(std::vector< hTable<HKMERr, ELMTs>* >&	_tables,
+				const size_t& 			_iteratorPos,
+				const size_t&	 		_nbCPU = 1
+			  );
+
 		bool resetIterator();
 		bool nextIterator();
 		void markElementAtIterator();
@@ -174,8 +335,6 @@ class hTable
 
 };
 
-#endif
-
 /* @Author: Rachid Ounit
  * @Name: hash table class
  *
@@ -199,12 +358,12 @@ class hTable
 using namespace std;
 
 	template <typename HKMERr, typename ELMTr>
-hTable<HKMERr, ELMTr>::hTable(): m_load(0), m_it_x(0), m_it_y(0), m_k(0)
+hTable<HKMERr, ELMTr>::hTable(): m_load(0), m_it_x(0), m_it_y(0), m_k(0), m_policy(NUMA_NONE), m_pages(PAGES_DEFAULT), m_shared(false), m_container(false)
 {
 	m_table.resize(HTSIZE);
 }
 	template <typename HKMERr, typename ELMTr>
-hTable<HKMERr, ELMTr>::hTable(const uint8_t _k): m_load(0), m_it_x(0), m_it_y(0), m_k(_k)
+hTable<HKMERr, ELMTr>::hTable(const uint8_t _k): m_load(0), m_it_x(0), m_it_y(0), m_k(_k), m_policy(NUMA_NONE), m_pages(PAGES_DEFAULT), m_shared(false), m_container(false)
 {
 	m_table.resize(HTSIZE);
 }
@@ -212,6 +371,8 @@ hTable<HKMERr, ELMTr>::hTable(const uint8_t _k): m_load(0), m_it_x(0), m_it_y(0)
 	template <typename HKMERr, typename ELMTr>
 hTable<HKMERr, ELMTr>::~hTable()
 {
+	for(size_t t = 0; t < m_replicaArenas.size(); t++)
+	{	delete m_replicaArenas[t];	}
 }
 
 	template <typename HKMERr, typename ELMTr>
@@ -219,6 +380,12 @@ void hTable<HKMERr, ELMTr>::clear()
 {
 	m_load = 0;
 	m_table.clear();
+	for(size_t t = 0; t < m_replicaArenas.size(); t++)
+	{	delete m_replicaArenas[t];	}
+	m_replicaArenas.clear();
+	m_replicas.clear();
+	m_arena.release();
+	m_segment.detach();
 }
 
 	template <typename HKMERr, typename ELMTr>
@@ -251,6 +418,7 @@ bool hTable<HKMERr, ELMTr>::insert(const uint64_t& _kmer, const ILBL& _label)
 	htCell<HKMERr, ELMTr> e(q, _label, 1);
 	size_t xline = _kmer % HTSIZE;
 	m_table[xline].push_back(e);
+	touch(xline);
 	m_load++;
 	return true;
 }
@@ -278,6 +446,7 @@ bool hTable<HKMERr,  ELMTr>::insert(const uint64_t& _kmer, const htCell<HKMERr,
 			m_table[xline][1] = q;
 		}
 	}
+	touch(xline);
 	m_load++;
 	return true;
 }
@@ -345,16 +514,17 @@ bool hTable<HKMERr, ELMTr>::find(const uint64_t& _kmer, size_t& _xElement, size_
 }
 
 template <typename HKMERr, typename ELMTr>
-bool hTable<HKMERr, ELMTr>::find(const IKMER& _ikmer,  const size_t& _reminderI, const size_t& _quotientI, ILBL& _label) const
+bool hTable<HKMERr, ELMTr>::find(const IKMER& _ikmer,  const size_t& _reminderI, const size_t& _quotientI, ILBL& _label, const size_t& _thread) const
 {
 	const size_t remainder = _ikmer.skmer[_reminderI];
+	const sVector< htCell<HKMERr,ELMTr> >* table = getTable();
 
-	if (m_table[remainder].empty())
+	if (table[remainder].empty() || !mayContain((uint64_t) _ikmer.skmer[_quotientI] * HTSIZE + remainder, _thread))
 	{
 		return false;
 	}
-	size_t _endI = m_table[remainder].size() - 1;
-	if (m_table[remainder][0].CKey > _ikmer.skmer[_quotientI] || m_table[remainder][_endI].CKey < _ikmer.skmer[_quotientI])
+	size_t _endI = table[remainder].size() - 1;
+	if (table[remainder][0].CKey > _ikmer.skmer[_quotientI] || table[remainder][_endI].CKey < _ikmer.skmer[_quotientI])
 	{
 		return false;
 	}
@@ -363,28 +533,29 @@ bool hTable<HKMERr, ELMTr>::find(const IKMER& _ikmer,  const size_t& _reminderI,
 	while (_endI > _startI)
 	{
 		midPoint = _startI + (_endI - _startI)/2;
-		if (_ikmer.skmer[_quotientI] <= m_table[remainder][midPoint].CKey)
+		if (_ikmer.skmer[_quotientI] <= table[remainder][midPoint].CKey)
 		{
 			_endI = midPoint;
 			continue;
 		}
 		_startI = midPoint+1;
 	}
-	if (m_table[remainder][_startI].CKey == _ikmer.skmer[_quotientI])
+	if (table[remainder][_startI].CKey == _ikmer.skmer[_quotientI])
 	{
-		_label = m_table[remainder][_startI].CElement.Label;
+		_label = table[remainder][_startI].CElement.Label;
 		return true;
 	}
 	return false;
 }
 
 	template <typename HKMERr, typename ELMTr>
-bool hTable<HKMERr, ELMTr>::find(const uint64_t& _ikmer, ILBL& _label) 
+bool hTable<HKMERr, ELMTr>::find(const uint64_t& _ikmer, ILBL& _label, const size_t& _thread) 
 {
 	size_t quotient = _ikmer / HTSIZE;
 	size_t remainder = _ikmer - quotient * HTSIZE;
+	const sVector< htCell<HKMERr,ELMTr> >* table = getTable();
 
-	if (m_table[remainder].empty())
+	if (table[remainder].empty() || !mayContain(_ikmer, _thread))
 	{
 		size_t _ikmerR = _ikmer;
 		// The following 6 lines come from Jellyfish source code
@@ -398,13 +569,13 @@ bool hTable<HKMERr, ELMTr>::find(const uint64_t& _ikmer, ILBL& _label)
 		quotient = _ikmerR / HTSIZE;
 		remainder = _ikmerR - quotient * HTSIZE;
 
-		if (m_table[remainder].empty())
+		if (table[remainder].empty() || !mayContain(_ikmerR, _thread))
 		{       return false;   }
-		uint8_t _endI = m_table[remainder].size() - 1;
+		size_t _endI = table[remainder].size() - 1;
 
-		if (m_table[remainder][0].CKey > quotient || m_table[remainder][_endI].CKey < quotient)
+		if (table[remainder][0].CKey > quotient || table[remainder][_endI].CKey < quotient)
 		{       return false;}
-		htCell<HKMERr, ELMTr>* ptr = &m_table[remainder].front();
+		const htCell<HKMERr, ELMTr>* ptr = seek(table[remainder], quotient);
 		while (ptr->CKey <= quotient)
 		{
 			if (ptr->CKey == quotient)
@@ -416,8 +587,8 @@ bool hTable<HKMERr, ELMTr>::find(const uint64_t& _ikmer, ILBL& _label)
 		}
 		return false;
 	}
-	uint8_t _endI = m_table[remainder].size() - 1;
-	if (m_table[remainder][0].CKey > quotient || m_table[remainder][_endI].CKey < quotient)
+	size_t _endI = table[remainder].size() - 1;
+	if (table[remainder][0].CKey > quotient || table[remainder][_endI].CKey < quotient)
 	{
 		size_t _ikmerR = _ikmer;
 		// The following 6 lines come from Jellyfish source code
@@ -431,13 +602,13 @@ bool hTable<HKMERr, ELMTr>::find(const uint64_t& _ikmer, ILBL& _label)
 		quotient = _ikmerR / HTSIZE;
 		remainder = _ikmerR - quotient * HTSIZE;
 
-		if (m_table[remainder].empty())
+		if (table[remainder].empty() || !mayContain(_ikmerR, _thread))
 		{       return false;   }
-		_endI = m_table[remainder].size() - 1;
-		if (m_table[remainder][0].CKey > quotient || m_table[remainder][_endI].CKey < quotient)
+		_endI = table[remainder].size() - 1;
+		if (table[remainder][0].CKey > quotient || table[remainder][_endI].CKey < quotient)
 		{       return false;	}
 
-		htCell<HKMERr, ELMTr>* ptr = &m_table[remainder].front();
+		const htCell<HKMERr, ELMTr>* ptr = seek(table[remainder], quotient);
 		while (ptr->CKey <= quotient)
 		{
 			if (ptr->CKey == quotient)
@@ -450,7 +621,7 @@ bool hTable<HKMERr, ELMTr>::find(const uint64_t& _ikmer, ILBL& _label)
 		return false;
 	}
 
-	htCell<HKMERr, ELMTr>* ptr = &m_table[remainder].front();
+	const htCell<HKMERr, ELMTr>* ptr = seek(table[remainder], quotient);
 	while (ptr->CKey <= quotient)
 	{
 		if (ptr->CKey == quotient)
@@ -473,13 +644,13 @@ bool hTable<HKMERr, ELMTr>::find(const uint64_t& _ikmer, ILBL& _label)
 	quotient = _ikmerR / HTSIZE;
 	remainder = _ikmerR - quotient * HTSIZE;
 	//////////////////////////////////////////////////////////////////////////////////////////////////
-	if (m_table[remainder].empty())
+	if (table[remainder].empty() || !mayContain(_ikmerR, _thread))
 	{       return false;   }
-	_endI = m_table[remainder].size() - 1; 
-	if (m_table[remainder][0].CKey > quotient || m_table[remainder][_endI].CKey < quotient)
+	_endI = table[remainder].size() - 1; 
+	if (table[remainder][0].CKey > quotient || table[remainder][_endI].CKey < quotient)
 	{       return false;	}
 
-	ptr = &m_table[remainder].front();
+	ptr = seek(table[remainder], quotient);
 	while (ptr->CKey <= quotient)
 	{
 		if (ptr->CKey == quotient)
@@ -493,18 +664,49 @@ bool hTable<HKMERr, ELMTr>::find(const uint64_t& _ikmer, ILBL& _label)
 	/////////////////////////////////////////////////////////////////////////////////////////////////////
 }
 
+	template <typename HKMERr, typename ELMTr>
+bool hTable<HKMERr, ELMTr>::find(const uint64_t& _ikmer, const uint64_t& _ikmerR, ILBL& _label, const size_t& _thread) const
+{
+	// Same as find(_ikmer, _label) when _ikmerR is the reverse complement of _ikmer,
+	// for callers that already maintain both orientations.
+	const uint64_t kmers[2] = {_ikmer, _ikmerR};
+	const sVector< htCell<HKMERr,ELMTr> >* table = getTable();
+	for(size_t t = 0; t < 2; t++)
+	{
+		const size_t quotient = kmers[t] / HTSIZE;
+		const size_t remainder = kmers[t] - quotient * HTSIZE;
+		if (!mayContain(kmers[t], _thread) || table[remainder].empty())
+		{	continue;	}
+		size_t _endI = table[remainder].size() - 1;
+		if (table[remainder][0].CKey > quotient || table[remainder][_endI].CKey < quotient)
+		{	continue;	}
+		const htCell<HKMERr, ELMTr>* ptr = seek(table[remainder], quotient);
+		while (ptr->CKey <= quotient)
+		{
+			if (ptr->CKey == quotient)
+			{
+				_label = (ptr->CElement).Label;
+				return true;
+			}
+			ptr++;
+		}
+	}
+	return false;
+}
+
 	template <typename HKMERr, typename ELMTr>
 bool hTable<HKMERr, ELMTr>::findFwd(const uint64_t& _ikmer, ILBL& _label, const size_t& _idHt) const
 {
 	size_t quotient = _ikmer / HTSIZE;
 	size_t remainder = _ikmer - quotient * HTSIZE;
+	const sVector< htCell<HKMERr,ELMTr> >* table = getTable();
 
-	if (m_table[remainder].empty())
+	if (table[remainder].empty())
 	{       return false;   }
-	size_t endI = m_table[remainder].size();
+	size_t endI = table[remainder].size();
 	size_t _endI = endI - 1;
 
-	if (m_table[remainder][0].CKey > quotient || m_table[remainder][_endI].CKey < quotient)
+	if (table[remainder][0].CKey > quotient || table[remainder][_endI].CKey < quotient)
 	{       return false;   }
 
 	size_t midPoint;
@@ -512,21 +714,198 @@ bool hTable<HKMERr, ELMTr>::findFwd(const uint64_t& _ikmer, ILBL& _label, const
 	while (_endI > _startI)
 	{
 		midPoint = _startI + (_endI - _startI)/2;
-		if (quotient <= m_table[remainder][midPoint].CKey)
+		if (quotient <= table[remainder][midPoint].CKey)
 		{
 			_endI = midPoint;
 			continue;
 		}
 		_startI = midPoint+1;
 	}
-	if (_startI < endI && m_table[remainder][_startI].CKey == quotient && m_table[remainder][_startI].CElement.GetLabel(_idHt) != NV)
+	if (_startI < endI && table[remainder][_startI].CKey == quotient && table[remainder][_startI].CElement.GetLabel(_idHt) != NV)
 	{
-		_label = m_table[remainder][_startI].CElement.GetLabel(_idHt);
+		_label = table[remainder][_startI].CElement.GetLabel(_idHt);
 		return true;
 	}
 	return false;
 }
 
+	template <typename HKMERr, typename ELMTr>
+void hTable<HKMERr, ELMTr>::buildFilter(const size_t& _bitsPerKey, const size_t& _maxBytes, const size_t& _nbCPU)
+{
+	// Stored k-mer of the cell y of the bucket t: CKey * HTSIZE + t
+	// (m_load is not maintained by read())
+	const sVector< htCell<HKMERr,ELMTr> >* table = getTable();
+	const size_t nbBuckets = HTSIZE;
+	size_t nbKeys = 0;
+	for(size_t t = 0; t < nbBuckets; t++)
+	{	nbKeys += table[t].size();	}
+	m_filter.init(nbKeys, _bitsPerKey, _maxBytes, _nbCPU);
+#ifdef _OPENMP
+	omp_set_num_threads(_nbCPU);
+#endif
+#pragma omp parallel for
+	for(size_t t = 0; t < nbBuckets; t++)
+	{
+		for(size_t y = 0; y < table[t].size(); y++)
+		{	m_filter.insert((uint64_t) table[t][y].CKey * HTSIZE + t);	}
+	}
+}
+
+	template <typename HKMERr, typename ELMTr>
+void hTable<HKMERr, ELMTr>::initArena(const size_t& _bytes)
+{
+	if (m_segment.isAttached())
+	{	return;	}	// Buckets written in the shared segment (openShared)
+	m_arena.init(_bytes, m_policy, 0, m_pages);
+	// Bucket headers: same placement, transparent huge pages at most
+	numaPolicy::bind(&m_table.front(), m_table.size() * sizeof(m_table[0]), m_policy);
+	if (m_pages != PAGES_DEFAULT)
+	{	memoryArena::adviseHuge(&m_table.front(), m_table.size() * sizeof(m_table[0]));	}
+}
+
+	template <typename HKMERr, typename ELMTr>
+void hTable<HKMERr, ELMTr>::finishArena()
+{
+	if (m_segment.isAttached())
+	{	publishShared();	}
+	else if (m_policy == NUMA_REPLICATE)
+	{	replicate();	}
+	reportMemory();
+}
+
+	template <typename HKMERr, typename ELMTr>
+bool hTable<HKMERr, ELMTr>::openShared(const std::vector<std::string>& _filesname, const size_t& _modCollision, size_t& _fileSize)
+{
+	// Attaches the segment of the database if published already, otherwise creates it
+	// for the loader: headers of the HTSIZE buckets first, then the buckets (at most one per key).
+	typedef sVector< htCell<HKMERr,ELMTr> > bucket;
+	std::string path;
+	uint64_t stamp = 0;
+	size_t nbKeys = 0;
+	const char* ext[3] = {".sz", ".ky", ".lb"};
+	for(size_t t = 0; t < _filesname.size(); t++)
+	{
+		char* full = realpath((_filesname[t] + (m_container ? CDBEXT: ".ky")).c_str(), NULL);
+		path += full != NULL ? full: _filesname[t];
+		path += t + 1 < _filesname.size() ? ",": "";
+		free(full);
+		if (m_container)
+		{
+			dbContainer container;
+			sharedSegment::addStamp((_filesname[t] + CDBEXT).c_str(), stamp);
+			nbKeys += container.readHeader(_filesname[t] + CDBEXT) ? container.getHeader().elements: 0;
+			continue;
+		}
+		for(size_t e = 0; e < 3; e++)
+		{	sharedSegment::addStamp((_filesname[t] + ext[e]).c_str(), stamp);	}
+		struct stat st;
+		if (stat((_filesname[t] + ".ky").c_str(), &st) == 0)
+		{	nbKeys += st.st_size / sizeof(HKMERr);	}
+	}
+	const std::string name = sharedSegment::getName(path, ((uint64_t) HTSIZE * 31 + sizeof(htCell<HKMERr,ELMTr>)) * 31 + _modCollision);
+	const size_t headersBytes = HTSIZE * sizeof(bucket);
+	for(size_t a = 0; a < 2; a++)
+	{
+		if (m_segment.attach(name, stamp))
+		{
+			m_replicas.assign(1, (const bucket*) m_segment.data());
+			std::vector< bucket >().swap(m_table);
+			_fileSize = m_segment.size();
+			cerr << "Database attached from shared memory " << name << " (" << _fileSize / 1000000 << " MB, ";
+			cerr << m_segment.getRefs() << " process(es) attached)" << endl;
+			return true;
+		}
+		if (m_segment.create(name, headersBytes + nbKeys * sizeof(htCell<HKMERr,ELMTr>), stamp, path))
+		{
+			m_arena.adopt(m_segment.data() + headersBytes, nbKeys * sizeof(htCell<HKMERr,ELMTr>));
+			return false;
+		}
+		// Created by another process meanwhile: attach it
+	}
+	cerr << "Failed to create the shared memory segment " << name << ": loading the database." << endl;
+	return false;
+}
+
+	template <typename HKMERr, typename ELMTr>
+void hTable<HKMERr, ELMTr>::publishShared()
+{
+	// Headers point to the buckets of the segment, valid in any process mapping it at the same address
+	typedef sVector< htCell<HKMERr,ELMTr> > bucket;
+	memcpy(m_segment.data(), &m_table.front(), HTSIZE * sizeof(bucket));
+	m_segment.publish();
+	m_replicas.assign(1, (const bucket*) m_segment.data());
+	std::vector< bucket >().swap(m_table);
+}
+
+	template <typename HKMERr, typename ELMTr>
+void hTable<HKMERr, ELMTr>::replicate()
+{
+	// Copy of the buckets and of their headers on each other node. Node 0 uses m_table.
+	typedef sVector< htCell<HKMERr,ELMTr> > bucket;
+	const size_t nbNodes = numaPolicy::getNbNodes();
+	const size_t cellsBytes = m_arena.used(), nbBuckets = m_table.size();
+	m_replicas.assign(1, &m_table.front());
+	for(size_t n = 1; n < nbNodes; n++)
+	{
+		memoryArena* arena = new memoryArena();
+		arena->init(cellsBytes + nbBuckets * sizeof(bucket), NUMA_REPLICATE, n, m_pages);
+		memcpy(arena->base(), m_arena.base(), cellsBytes);
+		bucket* table = (bucket*) arena->at(cellsBytes);
+		const uint8_t* base = m_arena.base();
+		// Headers rebased on the arena of the node (the arena memory is zeroed: empty buckets)
+#pragma omp parallel for
+		for(size_t t = 0; t < nbBuckets; t++)
+		{
+			if (!m_table[t].empty())
+			{	table[t].attach((htCell<HKMERr,ELMTr>*) arena->at((const uint8_t*) m_table[t].begin() - base), m_table[t].size());	}
+		}
+		m_replicaArenas.push_back(arena);
+		m_replicas.push_back(table);
+	}
+}
+
+	template <typename HKMERr, typename ELMTr>
+void hTable<HKMERr, ELMTr>::reportMemory() const
+{
+	const size_t nbNodes = numaPolicy::getNbNodes();
+	const size_t bytes = m_arena.used() + HTSIZE * sizeof(sVector< htCell<HKMERr,ELMTr> >);
+	if (m_segment.isAttached())
+	{
+		cerr << "Database published in shared memory (" << bytes / 1000000 << " MB)" << endl;
+		return;
+	}
+	if (m_pages != PAGES_DEFAULT)
+	{	cerr << "Database memory: " << m_arena.getPageSize() << endl;	}
+	if (m_policy == NUMA_NONE)
+	{	return;	}
+	if (nbNodes < 2)
+	{
+		cerr << "NUMA placement: single node (" << bytes / 1000000 << " MB)" << endl;
+		return;
+	}
+	for(size_t n = 0; n < nbNodes; n++)
+	{
+		cerr << "NUMA placement: node " << n << ": ";
+		cerr << (m_policy == NUMA_INTERLEAVE ? bytes / nbNodes: bytes) / 1000000 << " MB" << endl;
+	}
+}
+
+	template <typename HKMERr, typename ELMTr>
+void hTable<HKMERr, ELMTr>::prefetch(const uint64_t& _ikmer) const
+{
+	// Bring the bucket header in cache before a batch of findFwd
+	__builtin_prefetch(getTable() + _ikmer % HTSIZE);
+}
+
+	template <typename HKMERr, typename ELMTr>
+void hTable<HKMERr, ELMTr>::prefetchBucket(const uint64_t& _ikmer) const
+{
+	// Bring the bucket content in cache (the header should be prefetched first)
+	const sVector< htCell<HKMERr,ELMTr> >& bucket = getTable()[_ikmer % HTSIZE];
+	if (!bucket.empty())
+	{	__builtin_prefetch(bucket.begin() + (bucket.size() >> 1));	}
+}
+
 	template <typename HKMERr, typename ELMTr>
 void hTable<HKMERr, ELMTr>::updateElement(const size_t& _xElement, const size_t& _yElement, const size_t& _count, const bool& _lbl, const bool& _isSameLbl)
 {
@@ -539,6 +918,7 @@ void hTable<HKMERr, ELMTr>::updateElement(const size_t& _xElement, const size_t&
 	{
 		m_table[_xElement][_yElement].CElement.IncreaseMultiplicity();
 	}
+	touch(_xElement);
 }
 
         template <typename HKMERr, typename ELMTr>
@@ -549,6 +929,196 @@ void hTable<HKMERr, ELMTr>::updateElement(const size_t& _xElement, const size_t&
                 m_table[_xElement][_yElement].CElement.IncreaseMultiplicity(2);
         }
         m_table[_xElement][_yElement].CElement.AddToCount(_count);
+	touch(_xElement);
+}
+
+	template <typename HKMERr, typename ELMTr>
+void hTable<HKMERr, ELMTr>::relabelElement(const size_t& _xElement, const size_t& _yElement, const size_t& _count, const ILBL& _label)
+{
+	m_table[_xElement][_yElement].CElement.Label = _label;
+	m_table[_xElement][_yElement].CElement.AddToCount(_count);
+	touch(_xElement);
+}
+
+	template <typename HKMERr, typename ELMTr>
+bool hTable<HKMERr, ELMTr>::removeCount(const size_t& _xElement, const size_t& _yElement, const size_t& _count, const bool& _isSameLbl)
+{
+	// Count of the cell decreased by _count, the cell removed when no occurrence remains (true). Cells after
+	// the two first ones of the bucket are not ordered while building: the last one takes its place.
+	// Occurrences of another label than the cell's (!_isSameLbl) also take back their multiplicity (see updateElement).
+	sVector< htCell<HKMERr,ELMTr> >& bucket = m_table[_xElement];
+	ELMTr& e = bucket[_yElement].CElement;
+	touch(_xElement);
+	if (!_isSameLbl)
+	{	e.DecreaseMultiplicity(2);	}
+	if (e.GetCount() > _count)
+	{
+		e.Set(e.Label, e.GetCount() - _count);
+		return false;
+	}
+	bucket[_yElement] = bucket[bucket.size() - 1];
+	bucket.pop_back();
+	if (bucket.size() <= 2)
+	{	bucket.clear();	}
+	m_load--;
+	return true;
+}
+
+	template <typename HKMERr, typename ELMTr>
+size_t hTable<HKMERr, ELMTr>::removeLabel(const ILBL& _label, const ILBL& _common, size_t& _kept)
+{
+	// Cells of the label _label removed when specific to it, relabelled _common otherwise (_kept of them; as
+	// removeCount, the last cell of the bucket takes the place of a removed one). Returns the cells removed.
+	size_t removed = 0;
+	for(size_t t = 0; t < m_table.size(); t++)
+	{
+		sVector< htCell<HKMERr,ELMTr> >& bucket = m_table[t];
+		for(size_t u = 2; u < bucket.size(); )
+		{
+			ELMTr& e = bucket[u].CElement;
+			if (e.Label != _label)
+			{	u++;	continue;	}
+			if (e.GetMultiplicity() != 1)
+			{
+				e.Set(_common, e.GetCount());
+				_kept++;
+				u++;
+				continue;
+			}
+			bucket[u] = bucket[bucket.size() - 1];
+			bucket.pop_back();
+			removed++;
+		}
+		if (bucket.size() <= 2)
+		{	bucket.clear();	}
+	}
+	m_load -= removed;
+	return removed;
+}
+
+	template <typename HKMERr, typename ELMTr>
+bool hTable<HKMERr, ELMTr>::dump(FILE* _fd, const size_t& _iteratorPos) const
+{
+	// Cells of the buckets from _iteratorPos: number of cells, one size byte per bucket (LONGBUCKET and the
+	// sizes of the long buckets as in loadIndex), then the cells as in memory
+	loadIndex index;
+	std::vector<uint8_t> sizes(m_table.size());
+	uint64_t nbCells = 0;
+	for(size_t t = 0; t < m_table.size(); t++)
+	{
+		const size_t n = m_table[t].size() > _iteratorPos ? m_table[t].size() - _iteratorPos: 0;
+		sizes[t] = index.push(n);
+		nbCells += n;
+	}
+	const uint64_t nbLong = index.getLong().size();
+	bool done = fwrite(&nbCells, sizeof(uint64_t), 1, _fd) == 1 && fwrite(&sizes.front(), 1, sizes.size(), _fd) == sizes.size();
+	done = done && fwrite(&nbLong, sizeof(uint64_t), 1, _fd) == 1;
+	done = done && (nbLong == 0 || fwrite(&index.getLong().front(), sizeof(std::pair<uint64_t, uint64_t>), nbLong, _fd) == nbLong);
+	for(size_t t = 0; done && t < m_table.size(); t++)
+	{
+		if (m_table[t].size() > _iteratorPos)
+		{	done = fwrite(m_table[t].begin() + _iteratorPos, sizeof(htCell<HKMERr,ELMTr>), m_table[t].size() - _iteratorPos, _fd) == m_table[t].size() - _iteratorPos;	}
+	}
+	return done;
+}
+
+	template <typename HKMERr, typename ELMTr>
+bool hTable<HKMERr, ELMTr>::dumpChanged(FILE* _fd, const bool& _all)
+{
+	// Buckets changed since the last call (all the non-empty ones with _all), each one as its number, its
+	// number of cells then the cells after the two first ones, ended by the number HTSIZE. Changes cleared.
+	uint64_t head[2];
+	bool done = true;
+	for(size_t w = 0; done && w < m_changed.size(); w++)
+	{
+		uint64_t bits = m_changed[w];
+		m_changed[w] = 0;
+		for(size_t t = w << 6; done && t < m_table.size() && t < (w + 1) << 6; t++)
+		{
+			if (!((bits >> (t & 63)) & 1) && !(_all && !m_table[t].empty()))
+			{	continue;	}
+			head[0] = t;
+			head[1] = m_table[t].size() > 2 ? m_table[t].size() - 2: 0;
+			done = fwrite(head, sizeof(uint64_t), 2, _fd) == 2 &&
+				(head[1] == 0 || fwrite(m_table[t].begin() + 2, sizeof(htCell<HKMERr,ELMTr>), head[1], _fd) == head[1]);
+		}
+	}
+	head[0] = HTSIZE;
+	return done && fwrite(head, sizeof(uint64_t), 1, _fd) == 1;
+}
+
+	template <typename HKMERr, typename ELMTr>
+bool hTable<HKMERr, ELMTr>::restoreBuckets(FILE* _fd, const std::vector<ILBL>& _labels)
+{
+	// Buckets written by dumpChanged() replacing those of the table, labels renamed as by restore()
+	uint64_t head[2];
+	while (fread(head, sizeof(uint64_t), 1, _fd) == 1)
+	{
+		if (head[0] == HTSIZE)
+		{	return true;	}
+		if (head[0] > HTSIZE || fread(head + 1, sizeof(uint64_t), 1, _fd) != 1)
+		{	return false;	}
+		sVector< htCell<HKMERr,ELMTr> >& bucket = m_table[head[0]];
+		m_load -= bucket.size() > 2 ? bucket.size() - 2: 0;
+		bucket.clear();
+		if (head[1] == 0)
+		{	continue;	}
+		bucket.resize_init(head[1] + 2);
+		if (fread(bucket.begin() + 2, sizeof(htCell<HKMERr,ELMTr>), head[1], _fd) != head[1])
+		{	return false;	}
+		bucket[0] = bucket[2];
+		bucket[1] = bucket[2];
+		for(size_t u = 2; u < bucket.size(); u++)
+		{
+			if (bucket[u].CElement.Label >= _labels.size())
+			{	return false;	}
+			bucket[u].CElement.Label = _labels[bucket[u].CElement.Label];
+			bucket[0].CKey = bucket[u].CKey < bucket[0].CKey ? bucket[u].CKey: bucket[0].CKey;
+			bucket[1].CKey = bucket[u].CKey > bucket[1].CKey ? bucket[u].CKey: bucket[1].CKey;
+		}
+		m_load += head[1];
+	}
+	return false;
+}
+
+	template <typename HKMERr, typename ELMTr>
+bool hTable<HKMERr, ELMTr>::restore(FILE* _fd, const std::vector<ILBL>& _labels)
+{
+	// Table written by dump(_fd, 2), as built by insert(): the two first cells of a bucket hold its smallest
+	// and largest keys. The label l of a cell becomes _labels[l].
+	uint64_t nbCells = 0, nbLong = 0;
+	std::vector<uint8_t> sizes(m_table.size());
+	if (fread(&nbCells, sizeof(uint64_t), 1, _fd) != 1 || fread(&sizes.front(), 1, sizes.size(), _fd) != sizes.size() ||
+		fread(&nbLong, sizeof(uint64_t), 1, _fd) != 1)
+	{	return false;	}
+	std::vector< std::pair<uint64_t, uint64_t> > longs(nbLong);
+	if (nbLong > 0 && fread(&longs.front(), sizeof(std::pair<uint64_t, uint64_t>), nbLong, _fd) != nbLong)
+	{	return false;	}
+	loadIndex index;
+	index.setLong(nbLong > 0 ? &longs.front(): NULL, nbLong);
+	for(size_t t = 0; t < m_table.size(); t++)
+	{
+		const uint64_t c = sizes[t] < LONGBUCKET ? sizes[t]: index.getSize(t, sizes[t]);
+		if (c == 0)
+		{	continue;	}
+		sVector< htCell<HKMERr,ELMTr> >& bucket = m_table[t];
+		bucket.clear();
+		bucket.resize_init(c + 2);
+		if (fread(bucket.begin() + 2, sizeof(htCell<HKMERr,ELMTr>), c, _fd) != c)
+		{	return false;	}
+		bucket[0] = bucket[2];
+		bucket[1] = bucket[2];
+		for(size_t u = 2; u < bucket.size(); u++)
+		{
+			if (bucket[u].CElement.Label >= _labels.size())
+			{	return false;	}
+			bucket[u].CElement.Label = _labels[bucket[u].CElement.Label];
+			bucket[0].CKey = bucket[u].CKey < bucket[0].CKey ? bucket[u].CKey: bucket[0].CKey;
+			bucket[1].CKey = bucket[u].CKey > bucket[1].CKey ? bucket[u].CKey: bucket[1].CKey;
+		}
+		m_load += c;
+	}
+	return true;
 }
 
 	template <typename HKMERr, typename ELMTr>
@@ -633,6 +1203,7 @@ uint64_t hTable<HKMERr, ELMTr>::write(const char* _fileht, const size_t& _iterat
 	FILE * fd_s = fopen(file_sze,"w+");
 	uint64_t nbElement = 0;
 	uint8_t size = 0;
+	loadIndex index;
 	for(ITYPE t = 0; t < HTSIZE; t++)
 	{
 		size = 0;
@@ -643,17 +1214,8 @@ uint64_t hTable<HKMERr, ELMTr>::write(const char* _fileht, const size_t& _iterat
 			{
 				l_size += m_table[t][u].CElement.Marked() ? 1: 0;
 			}
-			if ( l_size >=  256) 
-			{
-				cerr << "This table can not be stored on disk: Some bucket list size exceeds 255." << endl;
-				cerr << "Please relaunch all computations by applying the following modifications: " << endl;
-				cerr << "- choose a smaller k-mers length, and/or" << endl;
-				cerr << "- increase the size of the hash-table as " << m_table.size() << " is way too small!" << endl;
-				cerr << "The program must exit now." << endl;
-				exit(-1);
-			}
 			nbElement += l_size;
-			size = l_size;
+			size = index.push(l_size);
 			fwrite(&size, 1,1, fd_s);
 			for(size_t u = _iteratorPos; u < m_table[t].size() ;u++)
 			{
@@ -671,11 +1233,14 @@ uint64_t hTable<HKMERr, ELMTr>::write(const char* _fileht, const size_t& _iterat
 		else
 		{
 			fwrite(&size, 1,1, fd_s);
+			index.push(size);
 		}
 	}
 	fclose(fd_l);
 	fclose(fd_k);
 	fclose(fd_s);
+	index.write(_fileht);
+	index.writeLong(string(_fileht) + ".sx");
 	free(file_lbl); 
 	file_lbl=NULL;
 	free(file_key); 
@@ -689,296 +1254,292 @@ uint64_t hTable<HKMERr, ELMTr>::write(const char* _fileht, const size_t& _iterat
 	return nbElement;
 }
 
+	template <typename HKMERr, typename ELMTr>
+void hTable<HKMERr, ELMTr>::fillBlock(const size_t& _b, const uint8_t* _sizes, const HKMERr* _keys, const ILBL* _labels, const loadIndex& _index, const ITYPE& _modCollision)
+{
+	// Buckets of the block _b from its size bytes, keys and labels. With a sampling factor, one non-empty
+	// bucket out of _modCollision is loaded (counted from the first bucket of the table).
+	const bool allCollision = _modCollision <= 1;
+	const size_t min = _b * IXBLOCK, max = min + IXBLOCK < HTSIZE ? min + IXBLOCK: HTSIZE;
+	uint64_t loadf = _index.getNonEmpty(_b), it_e = _index.getElements(_b), v = 0;
+	for(size_t t = min; t < max; t++)
+	{
+		const uint64_t c = _sizes[t - min] < LONGBUCKET ? _sizes[t - min]: _index.getSize(t, _sizes[t - min]);
+		if (c == 0)
+		{	continue;	}
+		loadf++;
+		if (allCollision || (loadf % _modCollision) == 0)
+		{
+			if (m_arena.isEnabled())
+			{	m_table[t].attach((htCell<HKMERr, ELMTr>*) m_arena.at(it_e * sizeof(htCell<HKMERr, ELMTr>)), c);	}
+			else
+			{	m_table[t].resize_init(c);	}
+			for(size_t u = 0; u < c; u++)
+			{
+				m_table[t][u].CKey = _keys[v + u];
+				m_table[t][u].CElement.Label = _labels[v + u];
+			}
+		}
+		v += c;
+		it_e += c;
+	}
+}
+
 	template <typename HKMERr, typename ELMTr>
 bool hTable<HKMERr, ELMTr>::read(const char * _filename, size_t& _fileSize,  const size_t& _nbCPU, const ITYPE& _modCollision, const bool& _isfastLoadingRequested)
 {
-	char * file_lbl = (char*) calloc(strlen(_filename)+4,sizeof(char));
-	char * file_key = (char*) calloc(strlen(_filename)+4,sizeof(char));
-	char * file_sze = (char*) calloc(strlen(_filename)+4,sizeof(char));
+	// Blocks of buckets loaded in parallel, located in the files by the sidecar <db>.ix (see loadIndex).
+	// Files are memory mapped with _isfastLoadingRequested, read with pread otherwise.
+	const std::string db(_filename), file_sze = db + ".sz", file_key = db + ".ky", file_lbl = db + ".lb";
 
-	sprintf(file_lbl, "%s.lb", _filename);
-	sprintf(file_key, "%s.ky", _filename);
-	sprintf(file_sze, "%s.sz", _filename);
+	if (m_shared && openShared(std::vector<std::string>(1, db), _modCollision, _fileSize))
+	{	return true;	}
+	if (m_container)
+	{	return readContainer(db + CDBEXT, _fileSize, _nbCPU, _modCollision);	}
 
-	if (_isfastLoadingRequested)
+	loadIndex index;
+	if (!index.load(db, HTSIZE, _nbCPU))
+	{
+		cerr << "Failed to open " << file_sze << endl;
+		return false;
+	}
+	const size_t nbBlocks = index.getNbBlocks(), nbElement = index.getElements();
+	const size_t _fileSizek = nbElement * sizeof(HKMERr), _fileSizel = nbElement * sizeof(ILBL);
+	int fd_s = open(file_sze.c_str(), O_RDONLY);
+	int fd_k = open(file_key.c_str(), O_RDONLY);
+	int fd_l = open(file_lbl.c_str(), O_RDONLY);
+	if (fd_s == -1 || fd_k == -1 || fd_l == -1)
+	{
+		cerr << "Failed to open " << (fd_s == -1 ? file_sze: (fd_k == -1 ? file_key: file_lbl)) << endl;
+		return false;
+	}
+	struct stat st_k, st_l;
+	fstat(fd_k, &st_k);
+	fstat(fd_l, &st_l);
+	if (_fileSizek < 1 || (size_t) st_k.st_size < _fileSizek || (size_t) st_l.st_size < _fileSizel)
 	{
+		cerr << "Failed to load database: ["<< (_fileSizek < 1 || (size_t) st_k.st_size < _fileSizek ? file_key: file_lbl) << "] contains no data or is truncated." << endl;
+		exit(-1);
+	}
+	if (useArena())
+	{
+		// Bucket of the element v of the files at the offset v of the arena
+		initArena(nbElement * sizeof(htCell<HKMERr, ELMTr>));
+		m_arena.setUsed(nbElement * sizeof(htCell<HKMERr, ELMTr>));
+	}
 #ifdef _OPENMP
-		omp_set_num_threads(_nbCPU);
+	omp_set_num_threads(_nbCPU);
 #endif
-
-		// Opening File with sizes
-		_fileSize = HTSIZE;
-		int fd_s = open(file_sze, O_RDONLY);
-		if (fd_s == -1)
-		{
-			cerr << "Failed to open " << file_sze << endl;
-			return false;
-		}
-		uint8_t *map;
-		map = (uint8_t*) mmap(0, _fileSize, PROT_READ, MAP_SHARED, fd_s, 0);
-		if (map == MAP_FAILED)
+	if (_isfastLoadingRequested)
+	{
+		uint8_t* map = (uint8_t*) mmap(0, HTSIZE, PROT_READ, MAP_SHARED, fd_s, 0);
+		HKMERr* key = (HKMERr*) mmap(0, _fileSizek, PROT_READ, MAP_SHARED, fd_k, 0);
+		ILBL* lbl = (ILBL*) mmap(0, _fileSizel, PROT_READ, MAP_SHARED, fd_l, 0);
+		if (map == MAP_FAILED || key == MAP_FAILED || lbl == MAP_FAILED)
 		{
-			close(fd_s);
 			cerr << "Failed to mmapping the file!" << endl;
 			exit(-1);
 		}
-		if (_fileSize < 1)
-		{
-			close(fd_s);
-			cerr << "Failed to load database: the database ["<< file_sze<< "] contains no data." << endl;
-			exit(-1);
-		}
-		// Initialization
-		ITYPE loadf = 0;
-		bool allCollision = _modCollision <= 1;
-
-		uint64_t 		nbElement = 0;
-		vector<uint8_t>		choice(HTSIZE,0);
-		vector<uint64_t> 	it_Key(_nbCPU,0);
-
-		ITYPE i = 0;
-		vector<ITYPE> Pos(_nbCPU+1, 0);
-		for(i = 1; i < _nbCPU ; i++)
-		{       Pos[i] = (HTSIZE/_nbCPU) * i;   }
-		Pos[_nbCPU] = HTSIZE;
-
-		/// PART 1: Setting bucket size
-		i = 0;
-		for(size_t t = 0; t < HTSIZE; t++)
-		{
-			if (t == Pos[i+1])
-			{       it_Key[++i] = nbElement; }
-			if (map[t] > 0)
-			{
-				loadf++;
-				nbElement += map[t];
-				choice[t] = (allCollision || (loadf % _modCollision)== 0) ? 2: 1;	
-			}
-		}
-		i = 0;
-#ifdef _OPENMP
-#pragma omp parallel for
-#endif
-		for (i = 0; i < _nbCPU; i++)
+		if (m_pages != PAGES_DEFAULT)
 		{
-			ITYPE min = Pos[i], max = Pos[i+1];
-			for(ITYPE u = min; u < max; u++)
-			{
-				if (choice[u] == 2)
-				{	m_table[u].resize_init(map[u]); } 
-			}
+			memoryArena::adviseHuge(map, HTSIZE);
+			memoryArena::adviseHuge(key, _fileSizek);
+			memoryArena::adviseHuge(lbl, _fileSizel);
 		}
-		/// PART 2: Populating key/label
-		// Opening Files
-		size_t _fileSizek = nbElement * sizeof(HKMERr);
-		size_t _fileSizel = nbElement * sizeof(ILBL);
-		// kmers keys
-		int fd_k = open(file_key, O_RDONLY);
-		if (fd_k == -1)
+#pragma omp parallel for schedule(dynamic)
+		for(size_t b = 0; b < nbBlocks; b++)
+		{	fillBlock(b, map + b * IXBLOCK, key + index.getElements(b), lbl + index.getElements(b), index, _modCollision);	}
+		if (munmap(map, HTSIZE) == -1)
 		{
-			cerr << "Failed to open " << file_key << endl;
-			return false;
-		}
-		HKMERr *key;
-		key = (HKMERr*) mmap(0, _fileSizek, PROT_READ, MAP_SHARED, fd_k, 0);
-		if (key == MAP_FAILED)
-		{
-			close(fd_k);
-			cerr << "Failed to mmapping the file!" << endl;
-			exit(-1);
+			perror("Error un-mmapping the database file (size)");
 		}
-		if ( _fileSizek < 1)
+		if (munmap(key, _fileSizek) == -1)
 		{
-			close(fd_k);
-			cerr << "Failed to load database: ["<< file_key<< "] contains no data." << endl;
-			exit(-1);
+			perror("Error un-mmapping the database file (key)");
 		}
-		/// targets Labels
-		int fd_l = open(file_lbl, O_RDONLY);
-		if (fd_l == -1)
+		if (munmap(lbl, _fileSizel) == -1)
 		{
-			cerr << "Failed to open " << file_lbl << endl;
-			return false;
+			perror("Error un-mmapping the database file (label)");
 		}
-		ILBL *lbl;
-		lbl = (ILBL*) mmap(0, _fileSizel, PROT_READ, MAP_SHARED, fd_l, 0);
-		if (lbl == MAP_FAILED)
+	}
+	else
+	{
+		bool failed = false;
+#pragma omp parallel
 		{
-			close(fd_l);
-			cerr << "Failed to mmapping the file!" << endl;
-			exit(-1);
+			std::vector<uint8_t>	sizes(IXBLOCK);
+			std::vector<HKMERr>	keys(1);
+			std::vector<ILBL>	labels(1);
+#pragma omp for schedule(dynamic)
+			for(size_t b = 0; b < nbBlocks; b++)
+			{
+				const size_t len = b + 1 < nbBlocks ? IXBLOCK: HTSIZE - b * IXBLOCK;
+				const size_t e = index.getElements(b), n = index.getElements(b + 1) - e;
+				if (keys.size() < n)
+				{
+					keys.resize(n);
+					labels.resize(n);
+				}
+				if (!loadIndex::readAt(fd_s, &sizes.front(), len, b * IXBLOCK) ||
+					!loadIndex::readAt(fd_k, &keys.front(), n * sizeof(HKMERr), e * sizeof(HKMERr)) ||
+					!loadIndex::readAt(fd_l, &labels.front(), n * sizeof(ILBL), e * sizeof(ILBL)))
+				{
+					failed = true;
+					continue;
+				}
+				fillBlock(b, &sizes.front(), &keys.front(), &labels.front(), index, _modCollision);
+			}
 		}
-		if ( _fileSizel < 1)
+		if (failed)
 		{
-			close(fd_l);
-			cerr << "Failed to load database: ["<< file_lbl<< "] contains no data." << endl;
+			cerr << "Failed to load database: error while reading [" << db << ".*]" << endl;
 			exit(-1);
 		}
-		/// Loading in memory key-label for each k-mer
-		i = 0;
+	}
+	close(fd_s);
+	close(fd_k);
+	close(fd_l);
+
+	_fileSize = HTSIZE + _fileSizek + _fileSizel;
+	if (m_arena.isEnabled())
+	{	finishArena();	}
+	return true;
+}
+
+	template <typename HKMERr, typename ELMTr>
+bool hTable<HKMERr, ELMTr>::readContainer(const std::string& _file, size_t& _fileSize, const size_t& _nbCPU, const ITYPE& _modCollision)
+{
+	// Sections mapped and verified, then loaded by blocks as read() (unpacked first with CDB_PACKED)
+	dbContainer container;
+	if (!container.open(_file, _nbCPU, true))
+	{
+		cerr << "Failed to load database: [" << _file << "] is missing or corrupted." << endl;
+		exit(-1);
+	}
+	const dbContainer::Header& header = container.getHeader();
+	if (header.nbBuckets != HTSIZE || header.keyBytes != sizeof(HKMERr) || header.labelBytes != sizeof(ILBL))
+	{
+		cerr << "Failed to load database: [" << _file << "] has " << header.nbBuckets << " buckets, keys of " << header.keyBytes;
+		cerr << " bytes and labels of " << header.labelBytes << " bytes (expected: " << HTSIZE << ", " << sizeof(HKMERr) << " and " << sizeof(ILBL) << ")." << endl;
+		exit(-1);
+	}
+	if (header.elements == 0)
+	{
+		cerr << "Failed to load database: [" << _file << "] contains no data." << endl;
+		exit(-1);
+	}
+	const uint8_t* sizes = container.getSection(CDB_SIZES);
+	const HKMERr* keys = (const HKMERr*) container.getSection(CDB_KEYS);
+	const ILBL* labels = (const ILBL*) container.getSection(CDB_LABELS);
+	loadIndex index;
+	index.setLong((const std::pair<uint64_t, uint64_t>*) container.getSection(CDB_LONG), header.sections[CDB_LONG].length / sizeof(std::pair<uint64_t, uint64_t>));
+	index.build(sizes, HTSIZE, _nbCPU);
+	if (useArena())
+	{
+		initArena(header.elements * sizeof(htCell<HKMERr, ELMTr>));
+		m_arena.setUsed(header.elements * sizeof(htCell<HKMERr, ELMTr>));
+	}
 #ifdef _OPENMP
-#pragma omp parallel for
+	omp_set_num_threads(_nbCPU);
 #endif
-		for(i = 0; i < _nbCPU ; i++)
+	if (header.format == CDB_PACKED)
+	{
+#pragma omp parallel
 		{
-			ITYPE min = Pos[i], max = Pos[i+1];
-			uint64_t u =0, v = 0, it_e = it_Key[i];
-
-			for(ITYPE t = min; t < max; t++)
+			std::vector<HKMERr>	blockKeys(1);
+			std::vector<ILBL>	blockLabels(1);
+#pragma omp for schedule(dynamic)
+			for(size_t b = 0; b < index.getNbBlocks(); b++)
 			{
-				if (choice[t] > 0)
+				const size_t len = b + 1 < index.getNbBlocks() ? IXBLOCK: HTSIZE - b * IXBLOCK;
+				const size_t n = index.getElements(b + 1) - index.getElements(b);
+				if (blockKeys.size() < n)
 				{
-					if (choice[t] == 2)
-					{
-						u = 0;
-						for(v = it_e; v < it_e + map[t]; v++)
-						{
-							m_table[t][u].CKey = key[v];
-							m_table[t][u++].CElement.Label = lbl[v];
-						}
-					}
-					it_e += map[t];
+					blockKeys.resize(n);
+					blockLabels.resize(n);
 				}
+				container.unpackBlock(b, sizes + b * IXBLOCK, len, index, &blockKeys.front(), &blockLabels.front());
+				fillBlock(b, sizes + b * IXBLOCK, &blockKeys.front(), &blockLabels.front(), index, _modCollision);
 			}
 		}
-		/// End
-		if (munmap(map, _fileSize) == -1)
-		{
-			perror("Error un-mmapping the database file (size)");
-		}
-		close(fd_s);
-		if (munmap(key, _fileSizek) == -1)
-		{
-			perror("Error un-mmapping the database file (key)");
-		}
-		if (munmap(lbl, _fileSizel) == -1)
-		{
-			perror("Error un-mmapping the database file (label)");
-		}
-		close(fd_l);
-		close(fd_k);
-
-		_fileSize = HTSIZE + _fileSizek + _fileSizel;
-
-		free(file_lbl); 
-		file_lbl=NULL;
-		free(file_key); 
-		file_key=NULL;
-		free(file_sze); 
-		file_sze=NULL;
-
-		return true;
 	}
-	FILE * fd_l = fopen(file_lbl,"r");
-	FILE * fd_k = fopen(file_key,"r");
-	FILE * fd_s = fopen(file_sze,"r");
-
-#define LEN 100000
-
-	if (fd_l == NULL)
-	{	cerr << "Failed to open " << file_lbl << endl; return false;	}
-	if (fd_k == NULL)
-	{       cerr << "Failed to open " << file_key << endl; return false;   }
-	if (fd_s == NULL)
-	{       cerr << "Failed to open " << file_sze << endl; return false;   }
-
-
-	ITYPE t = 0, i	= 0;
-	ITYPE loadf 	= 0;
-	bool allCollision = _modCollision <= 1;
-
-	uint8_t 	c[LEN];
-	ILBL 		lbl[LEN];
-	HKMERr  	key[LEN];
-	size_t len 	= fread(c,   1, LEN, fd_s);
-	size_t len_l 	= fread(lbl, sizeof(ILBL), LEN, fd_l);
-	size_t len_k 	= fread(key, sizeof(HKMERr), LEN, fd_k);
-
-	size_t nbElement = 0, u = 0, v = 0, v_c = 0;
+	else
+	{
+#pragma omp parallel for schedule(dynamic)
+		for(size_t b = 0; b < index.getNbBlocks(); b++)
+		{	fillBlock(b, sizes + b * IXBLOCK, keys + index.getElements(b), labels + index.getElements(b), index, _modCollision);	}
+	}
+	_fileSize = container.getBytes();
+	if (m_arena.isEnabled())
+	{	finishArena();	}
+	return true;
+}
 
-	_fileSize = len + len_l*sizeof(ILBL) + len_k*sizeof(HKMERr);
-	//htCell<HKMERr, ELMTr> defCell;
-	bool readDone = false;
-	while (true)
+	template <typename HKMERr, typename ELMTr>
+	template <typename ELMTs>
+void hTable<HKMERr, ELMTr>::merge(std::vector< hTable<HKMERr, ELMTs>* >& _tables, const size_t& _iteratorPos, const size_t& _nbCPU)
+{
+	// Marked cells of the tables (from the cell _iteratorPos) gathered bucket by bucket, in parallel. A key held
+	// by several tables takes the label of the first one (label and index of the table, as addDB).
+	// Buckets of the tables are released once merged.
+	size_t load = 0;
+#ifdef _OPENMP
+	omp_set_num_threads(_nbCPU);
+#endif
+#pragma omp parallel reduction(+:load)
 	{
-		while (i < len)
+		std::vector< htCell<HKMERr, uint32_t> > kmers;
+		htCell<HKMERr, uint32_t> kmCell;
+#pragma omp for schedule(dynamic, 4096)
+		for(size_t t = 0; t < m_table.size(); t++)
 		{
-			if (c[i] > 0)
+			kmers.clear();
+			for(size_t i = 0; i < _tables.size(); i++)
 			{
-				loadf++;
-				nbElement += c[i];
-				readDone = false;
-				if (allCollision || (loadf % _modCollision)== 0)
-				{	
-					//m_table[t].reserve(c[i]);	
-					m_table[t].resize_init(c[i]);
-					u = 0;
-					v_c = v;
-					while (u < c[i])
+				sVector< htCell<HKMERr, ELMTs> >& bucket = _tables[i]->m_table[t];
+				for(size_t u = _iteratorPos; u < bucket.size(); u++)
+				{
+					if (bucket[u].CElement.Marked())
 					{
-						if (v_c < len_l)
-						{
-							//m_table[t].push_back(defCell);
-							m_table[t][u].CKey = key[v_c];
-							m_table[t][u++].CElement.Label = lbl[v_c++];
-							continue;
-						}
-						len_l = fread(lbl, sizeof(ILBL), LEN, fd_l);
-						len_k = fread(key, sizeof(HKMERr), LEN, fd_k);
-						readDone = true;
-						_fileSize += len_l*sizeof(ILBL) + len_k*sizeof(HKMERr);
-						v_c = 0;
-						if (len_l == 0)
-						{       break;  }
+						kmCell.CKey = bucket[u].CKey;
+						kmCell.CElement = (((uint32_t) bucket[u].CElement.Label) << 2) ^ i;
+						kmers.push_back(kmCell);
 					}
 				}
-				if (readDone)
-				{	v = v_c;}
-				else
-				{
-					if (v+c[i] >= LEN)
-					{ 
-						len_l = fread(lbl, sizeof(ILBL), LEN, fd_l);
-						len_k = fread(key, sizeof(HKMERr), LEN, fd_k);
-						_fileSize += len_l*sizeof(ILBL) + len_k*sizeof(HKMERr);
-						if (len_l == 0)
-						{       break;  }
-						v = v+c[i] - LEN;
-					}
-					else
-					{	v += c[i];}
-				}  
+				bucket.clear();
 			}
-			i++;
-			t++;
+			if (kmers.empty())
+			{	continue;	}
+			// Cells of a same key in the order of the tables
+			stable_sort(kmers.begin(), kmers.end());
+			size_t n = 0;
+			for(size_t u = 0; u < kmers.size(); u++)
+			{
+				if (n == 0 || kmers[n-1].CKey != kmers[u].CKey)
+				{	kmers[n++] = kmers[u];	}
+			}
+			m_table[t].resize_init(n);
+			for(size_t y = 0; y < n; y++)
+			{
+				m_table[t][y].CKey = kmers[y].CKey;
+				m_table[t][y].CElement.SetLabel((ILBL) (kmers[y].CElement >> 2),(ILBL) (kmers[y].CElement&0x3UL));
+			}
+			load += n;
 		}
-		len = fread(c, 1, LEN, fd_s);
-		_fileSize += len;
-		i = 0;
-		if (len == 0)
-		{	break;	}
 	}
-	fclose(fd_l);
-	fclose(fd_k);
-	fclose(fd_s);
-
-	free(file_lbl); 
-	file_lbl=NULL;
-	free(file_key); 
-	file_key=NULL;
-	free(file_sze); 
-	file_sze=NULL;
-
-	return true;	
+	m_load += load;
 }
 
 	template <typename HKMERr, typename ELMTr>
 bool hTable<HKMERr, ELMTr>::addDB(const std::vector<std::string>& _filesname, size_t& _fileSize, const ITYPE& _modCollision)
 {
 #define NBHT 3
+	if (m_shared && openShared(_filesname, _modCollision, _fileSize))
+	{	return true;	}
 
 	vector<FILE*> fd_l(NBHT), fd_k(NBHT), fd_s(NBHT);
 	vector<char*> file_lbl(NBHT,NULL), file_key(NBHT,NULL), file_sze(NBHT,NULL);
+	vector<loadIndex> longs(NBHT);
 	for(size_t t = 0; t < _filesname.size(); t++)
 	{
 		file_lbl[t] = (char*) calloc(strlen(_filesname[t].c_str())+4,sizeof(char));
@@ -1002,6 +1563,9 @@ bool hTable<HKMERr, ELMTr>::addDB(const std::vector<std::string>& _filesname, si
 		if (fd_s[t] == NULL)
 		{       cerr << "The database of discriminative spaced k-mers is missing: Failed to open " << file_sze[t] << endl;
 			exit(1);   }
+		if (!longs[t].readLong(_filesname[t] + ".sx"))
+		{       cerr << "Failed to read " << _filesname[t] << ".sx" << endl;
+			exit(1);   }
 	}
 #define LEN 100000
 	ITYPE t = 0, i  = 0;
@@ -1023,38 +1587,48 @@ bool hTable<HKMERr, ELMTr>::addDB(const std::vector<std::string>& _filesname, si
 	len_k[2] = fread(key2, sizeof(HKMERr), LEN, fd_k[2]);
 	size_t nbElement = 0, u = 0, v_c = 0, v0 = 0, v1 = 0, v2 = 0;
 
+	if (useArena())
+	{
+		// At most one cell per key of the files
+		size_t nbKeys = 0;
+		struct stat st;
+		for(size_t t = 0; t < _filesname.size(); t++)
+		{
+			fstat(fileno(fd_k[t]), &st);
+			nbKeys += st.st_size / sizeof(HKMERr);
+		}
+		initArena(nbKeys * sizeof(htCell<HKMERr, ELMTr>));
+	}
 	_fileSize = len[0] + len[1] + len[2];
 	_fileSize += (len_l[0] + len_l[1] + len_l[2])*sizeof(ILBL);
 	_fileSize += (len_k[0] + len_k[1] + len_k[2])*sizeof(HKMERr);
 	htCell<HKMERr, ELMTr> defCell;
 	htCell<HKMERr, uint32_t> kmCell;
 	vector< htCell<HKMERr, uint32_t> > kmers(1000);
-	vector<bool> Taken(65536,false);
 	size_t iSize = 0;
-	vector<size_t> keyIdx(65536,0);
 	while (true)
 	{
 		while (i < len[0] || i < len[1] || i < len[2])
 		{
 			iSize = 0;
+			const size_t s0 = i < len[0] ? longs[0].getSize(t, c0[i]): 0;
+			const size_t s1 = i < len[1] ? longs[1].getSize(t, c1[i]): 0;
+			const size_t s2 = i < len[2] ? longs[2].getSize(t, c2[i]): 0;
+			if (kmers.size() < s0 + s1 + s2)
+			{	kmers.resize(s0 + s1 + s2);	}
 			if (i < len[0] && c0[i] > 0)
 			{
 				u = 0;
 				v_c = v0;
-				while (u < c0[i])
+				while (u < s0)
 				{
 					if (v_c < len_l[0])
 					{
-						if (!Taken[key0[v_c]])
-						{
-							uint32_t LabelID = lbl0[v_c];
-							LabelID <<= 2;
-							LabelID ^= 0;
-							kmers[iSize].CKey = key0[v_c];
-							kmers[iSize].CElement = LabelID;
-							Taken[key0[v_c]] = true;
-							keyIdx[iSize++] = key0[v_c];
-						}
+						uint32_t LabelID = lbl0[v_c];
+						LabelID <<= 2;
+						LabelID ^= 0;
+						kmers[iSize].CKey = key0[v_c];
+						kmers[iSize++].CElement = LabelID;
 						v_c++;
 						u++;
 						continue;
@@ -1072,20 +1646,15 @@ bool hTable<HKMERr, ELMTr>::addDB(const std::vector<std::string>& _filesname, si
 			{
 				u = 0;
 				v_c = v1;
-				while (u < c1[i])
+				while (u < s1)
 				{
 					if (v_c < len_l[1])
 					{
-						if (!Taken[key1[v_c]])
-						{
-							uint32_t LabelID = lbl1[v_c];
-							LabelID <<= 2;
-							LabelID ^= 1;
-							kmers[iSize].CKey = key1[v_c];
-							kmers[iSize].CElement = LabelID;
-							Taken[key1[v_c]] = true;
-							keyIdx[iSize++] = key1[v_c];
-						}
+						uint32_t LabelID = lbl1[v_c];
+						LabelID <<= 2;
+						LabelID ^= 1;
+						kmers[iSize].CKey = key1[v_c];
+						kmers[iSize++].CElement = LabelID;
 						v_c++;
 						u++;
 						continue;
@@ -1103,20 +1672,15 @@ bool hTable<HKMERr, ELMTr>::addDB(const std::vector<std::string>& _filesname, si
 			{
 				u = 0;
 				v_c = v2;
-				while (u < c2[i])
+				while (u < s2)
 				{
 					if (v_c < len_l[2])
 					{
-						if (!Taken[key2[v_c]])
-						{
-							uint32_t LabelID = lbl2[v_c];
-							LabelID <<= 2;
-							LabelID ^= 2;
-							kmers[iSize].CKey = key2[v_c];
-							kmers[iSize].CElement = LabelID;
-							Taken[key2[v_c]] = true;
-							keyIdx[iSize++] = key2[v_c];
-						}
+						uint32_t LabelID = lbl2[v_c];
+						LabelID <<= 2;
+						LabelID ^= 2;
+						kmers[iSize].CKey = key2[v_c];
+						kmers[iSize++].CElement = LabelID;
 						v_c++;
 						u++;
 						continue;
@@ -1132,20 +1696,24 @@ bool hTable<HKMERr, ELMTr>::addDB(const std::vector<std::string>& _filesname, si
 			}
 			if ((allCollision || (t % _modCollision)== 0))
                         {
-				m_table[t].resize_init(iSize);
-				sort(kmers.begin(),kmers.begin()+iSize);
+				// Cells of a same key in the order of the files: the first one is kept (as merge)
+				stable_sort(kmers.begin(),kmers.begin()+iSize);
+				size_t n = 0;
 				for(size_t y = 0 ; y < iSize ; y++)
+				{
+					if (n == 0 || kmers[n-1].CKey != kmers[y].CKey)
+					{	kmers[n++] = kmers[y];	}
+				}
+				if (m_arena.isEnabled() && n > 0)
+				{	m_table[t].attach((htCell<HKMERr, ELMTr>*) m_arena.allocate(n * sizeof(htCell<HKMERr, ELMTr>)), n);	}
+				else
+				{	m_table[t].resize_init(n);	}
+				for(size_t y = 0 ; y < n ; y++)
 				{
 					m_table[t][y].CKey = kmers[y].CKey;
 					m_table[t][y].CElement.SetLabel((ILBL) (kmers[y].CElement >> 2),(ILBL) (kmers[y].CElement&0x3UL));
-					Taken[keyIdx[y]] = false;
 				}
-				m_load += iSize;
-			}
-			else
-			{
-				for(size_t y = 0 ; y < iSize ; y++)
-					Taken[keyIdx[y]] = false;
+				m_load += n;
 			}
 			iSize = 0;
 			i++;
@@ -1192,6 +1760,9 @@ bool hTable<HKMERr, ELMTr>::addDB(const std::vector<std::string>& _filesname, si
 		free(file_sze[t]);
 		file_sze[t]=NULL;
 	}
+	if (m_arena.isEnabled())
+	{	finishArena();	}
 	return true;
 }
 
+#endif
@@ -145,80 +145,53 @@ void IndexTovector(const uint64_t& _index, const size_t& _kmerSize, std::string&
  *
  */
 
-void getSpacedSeed(const std::string& _setting, const uint64_t& _kmerR, uint64_t& _skmerR)
+bool isSeedMask(const std::string& _mask)
 {
-	if (_setting == "T295")
-	{	return getSpacedSeedOPTSS95s2(_kmerR, _skmerR); }
-	if (_setting == "T58570")
-	{       return getSpacedSeedT58570(_kmerR, _skmerR); }
-	if (_setting == "T38570")
-	{       return getSpacedSeedT38570(_kmerR, _skmerR); }
-	cerr << "Failed to find the mask for the spaced seed requested."<< endl;
-	exit(1);
+	if (_mask.size() == 0 || _mask.size() > 32)
+	{	return false;	}
+	bool hasCare = false;
+	for(size_t t = 0; t < _mask.size(); t++)
+	{
+		if (_mask[t] == '1')
+		{	hasCare = true;
+			continue;	}
+		if (_mask[t] != '0' && _mask[t] != '*')
+		{	return false;	}
+	}
+	return hasCare;
 }
 
-void getSpacedSeedT58570(const uint64_t& _kmerR,  uint64_t& _skmerR)
-{
-	// 1111101001110101101100111011111
-	// 11111*1**111*1*11*11**111*11111
-	_skmerR = _kmerR >> 52; // 26, Add 1
-	_skmerR <<= 2 ;
-	_skmerR ^= (_kmerR & 0x3FFFFFFFFFFFFUL)>> 48; // Add 1
-	_skmerR <<= 6 ;
-	_skmerR ^= (_kmerR & 0xFFFFFFFFFFFUL)>> 38; // Add 1
-	_skmerR <<= 2 ;
-	_skmerR ^= (_kmerR & 0xFFFFFFFFFUL)>> 34; // Add 1
-	_skmerR <<= 4 ;
-	_skmerR ^= (_kmerR & 0xFFFFFFFFUL)>> 28; // Add 1
-	_skmerR <<= 4 ;
-	_skmerR ^= (_kmerR & 0x3FFFFFFUL)>> 22; // Add 1
-	_skmerR <<= 6 ;
-	_skmerR ^= (_kmerR & 0x3FFFFUL)>> 12; // Add 1
-	_skmerR <<= 10;
-	_skmerR ^= (_kmerR & 0x3FFUL); // Add 1
-	return;
-}
-//////////
-void getSpacedSeedT38570(const uint64_t& _kmerR, uint64_t& _skmerR)
-{
-	// 1111101011100101101110011011111
-	// 11111*1*111**1*11*111**11*11111
-	_skmerR = _kmerR >> 52; // 26, Add 1
-	_skmerR <<= 2 ;
-	_skmerR ^= (_kmerR & 0x3FFFFFFFFFFFFUL)>> 48; // Add 1
-	_skmerR <<= 6 ;
-	_skmerR ^= (_kmerR & 0x3FFFFFFFFFFFUL)>> 40; // Add 1
-	_skmerR <<= 2 ;
-	_skmerR ^= (_kmerR & 0xFFFFFFFFFUL)>> 34; // Add 1
-	_skmerR <<= 4 ;
-	_skmerR ^= (_kmerR & 0xFFFFFFFFUL)>> 28; // Add 1
-	_skmerR <<= 6 ;
-	_skmerR ^= (_kmerR & 0x3FFFFFFUL)>> 20; // Add 1
-	_skmerR <<= 4 ;
-	_skmerR ^= (_kmerR & 0xFFFFUL)>> 12; // Add 1
-	_skmerR <<= 10;
-	_skmerR ^= (_kmerR & 0x3FFUL); // Add 1
-	return;
-}
+seedExtractor::seedExtractor(): m_mask(0), m_nbRuns(0)
+{}
 
-void getSpacedSeedOPTSS95s2(const uint64_t& _kmerR,  uint64_t& _skmerR)
+bool seedExtractor::compile(const std::string& _mask)
 {
-	// 1111*111*111**1*111**1*11*11111
-	_skmerR = _kmerR >> 54; // Add 1111
-	_skmerR <<= 6 ;
-	_skmerR ^= (_kmerR & 0xFFFFFFFFFFFFFUL)>> 46; // Add 111
-	_skmerR <<= 6 ;
-	_skmerR ^= (_kmerR & 0xFFFFFFFFFFFUL) >> 38; // Add 111
-	_skmerR <<= 2 ;
-	_skmerR ^= (_kmerR & 0x3FFFFFFFFUL) >> 32; // Add 1
-	_skmerR <<= 6 ;
-	_skmerR ^= (_kmerR & 0x3FFFFFFFUL) >> 24; // Add 111
-	_skmerR <<= 2 ;
-	_skmerR ^= (_kmerR & 0xFFFFFUL) >> 18; // Add 1
-	_skmerR <<= 4 ;
-	_skmerR ^= (_kmerR & 0xFFFFUL) >> 12; // Add 11
-	_skmerR <<= 10 ;
-	_skmerR ^= (_kmerR & 0x3FFUL); // Add 11111
-	return;
+	m_mask = 0;
+	m_nbRuns = 0;
+	if (!isSeedMask(_mask))
+	{	return false;	}
+	const size_t length = _mask.size();
+	for(size_t t = 0; t < length; t++)
+	{
+		if (_mask[t] == '1')
+		{	m_mask |= ((uint64_t) 3) << ((length - 1 - t) << 1);	}
+	}
+	// Runs of consecutive bases kept, from the lowest bits
+	uint8_t offset = 0, bit = 0;
+	while (bit < 64)
+	{
+		if (((m_mask >> bit) & 1) == 0)
+		{	bit++;
+			continue;	}
+		uint8_t len = 0;
+		while (bit + len < 64 && ((m_mask >> (bit + len)) & 1) == 1)
+		{	len++;	}
+		m_runs[m_nbRuns].shift 	= bit;
+		m_runs[m_nbRuns].offset = offset;
+		m_runs[m_nbRuns].mask	= len < 64 ? (((uint64_t) 1) << len) - 1: (uint64_t) -1;
+		m_nbRuns++;
+		offset 	+= len;
+		bit 	+= len;
+	}
+	return true;
 }
-
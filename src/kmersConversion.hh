@@ -31,6 +31,9 @@
 
 #include<string>
 #include<stdint.h>
+#ifdef __BMI2__
+#include<immintrin.h>
+#endif
 
 //      FUNCTION
 //      Name: getReverseComplement
@@ -52,14 +55,49 @@ void IndexTovector(const uint64_t& _index, const size_t& _kmerSize, std::string&
 //
 void vectorToIndex(const std::string& _kmer, uint64_t& _index);
 
-//	FUNCTION
-//	Name: getSpacedSeed
-//	Implementation notes: Build the spaced seed (forward) given a weight from a contiguous seed of length 31.
+//	CLASS
+//	Name: seedExtractor
+//	Implementation notes: Gather the bases of a k-mer selected by a spaced seed mask (e.g., "1111*111*111**1*111**1*11*11111").
+//	The mask is compiled once into a 64-bit PEXT mask (used when built with BMI2, e.g. -mbmi2) and into
+//	a table of shift/mask runs for the portable path.
 //
-void getSpacedSeed(const std::string& _setting, const uint64_t& _kmerR, uint64_t& _skmerR);
+class seedExtractor
+{
+	public:
+	seedExtractor();
+
+	bool compile(const std::string& _mask);
+
+	void extract(const uint64_t& _kmer, uint64_t& _skmer) const
+	{
+#ifdef __BMI2__
+		_skmer = _pext_u64(_kmer, m_mask);
+#else
+		_skmer = 0;
+		for(uint8_t t = 0; t < m_nbRuns; t++)
+		{	_skmer |= ((_kmer >> m_runs[t].shift) & m_runs[t].mask) << m_runs[t].offset;	}
+#endif
+	}
+
+	uint64_t getMask() const
+	{	return m_mask;	}
 
-void getSpacedSeedT38570(const uint64_t& _kmerR, uint64_t& _skmerR);
-void getSpacedSeedT58570(const uint64_t& _kmerR, uint64_t& _skmerR);
-void getSpacedSeedOPTSS95s2(const uint64_t& _kmerR, uint64_t& _skmerR);
+	private:
+	struct Run
+	{
+		uint8_t		shift;
+		uint8_t		offset;
+		uint64_t	mask;
+	};
+	uint64_t	m_mask;
+	uint8_t		m_nbRuns;
+	Run		m_runs[16];
+};
+
+//	FUNCTION
+//	Name: isSeedMask
+//	Implementation notes: Check that a string is a valid mask of spaced seed ('1' for a base kept, '0' or '*' otherwise, 32 bases max).
+//
+bool isSeedMask(const std::string& _mask);
 
 #endif //KMERSCONVERSION_HH
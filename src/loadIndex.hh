@@ -0,0 +1,338 @@
+/*
+ * CLARK, CLAssifier based on Reduced K-mers.
+ */
+
+/*
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+   Copyright 2013-2017, Rachid Ounit <clark.ucr.help at gmail.com>
+*/
+
+/*
+ * @author: Rachid Ounit, Ph.D Candidate.
+ * @project: CLARK, Metagenomic and Genomic Sequences Classification project.
+ * @note: C++ IMPLEMENTATION supported on latest Linux and Mac OS.
+ *
+ */
+
+#ifndef LOADINDEX_HH
+#define LOADINDEX_HH
+
+#include <vector>
+#include <string>
+#include <utility>
+#include <algorithm>
+#include <cstdio>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#define IXMAGIC		0x58494b52414c43ULL	// "CLARKIX"
+#define IXVERSION	2
+#define IXBLOCK		65536			// Buckets per block
+#define IXHEADER	9			// Magic, version, buckets, IXBLOCK, blocks, keys, sizes of the .sz, .ky and .lb files
+#define LONGBUCKET	255			// Size byte of the buckets of LONGBUCKET keys or more (sizes in <db>.sx)
+
+//	CLASS
+//	Name: loadIndex
+//	Implementation notes: Sidecar of a database (<db>.ix) splitting its buckets into blocks of IXBLOCK buckets.
+//	For each block, it keeps the number of keys stored before it (offset in the .ky and .lb files) and the
+//	number of non-empty buckets before it (for the sampling factor), so that blocks are loaded independently.
+//	Written with the database, with the sizes of its .sz, .ky and .lb files and its number of keys; rebuilt
+//	from the .sz file (in parallel) and rewritten when missing, older than the .sz file or not matching them.
+//	It also holds the sizes of the long buckets (escaped by LONGBUCKET in the .sz file), as pairs
+//	(bucket, size) in bucket order, stored in <db>.sx when there are some.
+//
+class loadIndex
+{
+	public:
+	loadIndex(): m_nbBuckets(0)
+	{	m_last[0] = m_last[1] = 0;	}
+
+	// Adds the size of the next bucket (database creation). Returns the size byte to store.
+	uint8_t push(const size_t& _size)
+	{
+		if (m_nbBuckets % IXBLOCK == 0)
+		{
+			m_elements.push_back(getElements());
+			m_nonEmpty.push_back(getNonEmpty());
+		}
+		if (_size >= LONGBUCKET)
+		{	m_long.push_back(std::make_pair((uint64_t) m_nbBuckets, (uint64_t) _size));	}
+		m_last[0] += _size;
+		m_last[1] += _size > 0 ? 1: 0;
+		m_nbBuckets++;
+		return _size >= LONGBUCKET ? LONGBUCKET: _size;
+	}
+
+	// Size of the bucket _bucket, whose size byte is _byte
+	uint64_t getSize(const uint64_t& _bucket, const uint8_t& _byte) const
+	{
+		if (_byte < LONGBUCKET)
+		{	return _byte;	}
+		std::vector< std::pair<uint64_t, uint64_t> >::const_iterator it = std::lower_bound(m_long.begin(), m_long.end(), std::make_pair(_bucket, (uint64_t) 0));
+		return it != m_long.end() && it->first == _bucket ? it->second: LONGBUCKET;
+	}
+
+	// Sizes of the _len buckets of the block _b from their size bytes
+	void getSizes(const size_t& _b, const uint8_t* _bytes, const size_t& _len, uint32_t* _sizes) const
+	{
+		for(size_t t = 0; t < _len; t++)
+		{	_sizes[t] = _bytes[t] < LONGBUCKET ? _bytes[t]: getSize(_b * IXBLOCK + t, _bytes[t]);	}
+	}
+
+	const std::vector< std::pair<uint64_t, uint64_t> >& getLong() const
+	{	return m_long;	}
+
+	void setLong(const std::pair<uint64_t, uint64_t>* _long, const size_t& _nb)
+	{	m_long.assign(_long, _long + _nb);	}
+
+	// Writes the sizes of the long buckets (the file is removed when there is none)
+	bool writeLong(const std::string& _file) const
+	{
+		if (m_long.empty())
+		{
+			remove(_file.c_str());
+			return true;
+		}
+		FILE* fd = fopen(_file.c_str(), "w");
+		if (fd == NULL)
+		{	return false;	}
+		bool ok = fwrite(&m_long.front(), sizeof(std::pair<uint64_t, uint64_t>), m_long.size(), fd) == m_long.size();
+		return fclose(fd) == 0 && ok;
+	}
+
+	// Reads the sizes of the long buckets (none if the file is missing)
+	bool readLong(const std::string& _file)
+	{
+		m_long.clear();
+		struct stat st;
+		if (stat(_file.c_str(), &st) != 0)
+		{	return true;	}
+		FILE* fd = fopen(_file.c_str(), "r");
+		if (fd == NULL)
+		{	return false;	}
+		m_long.resize(st.st_size / sizeof(std::pair<uint64_t, uint64_t>));
+		bool ok = m_long.empty() || fread(&m_long.front(), sizeof(std::pair<uint64_t, uint64_t>), m_long.size(), fd) == m_long.size();
+		fclose(fd);
+		return ok;
+	}
+
+	// Index only: the sizes of the long buckets are kept
+	void clear()
+	{
+		m_elements.clear();
+		m_nonEmpty.clear();
+		m_last[0] = m_last[1] = 0;
+		m_nbBuckets = 0;
+	}
+
+	size_t getNbBlocks() const
+	{	return m_elements.size();	}
+
+	// Keys and non-empty buckets before the block _b (_b = getNbBlocks() for the totals)
+	uint64_t getElements(const size_t& _b) const
+	{	return _b < m_elements.size() ? m_elements[_b]: m_last[0];	}
+
+	uint64_t getNonEmpty(const size_t& _b) const
+	{	return _b < m_nonEmpty.size() ? m_nonEmpty[_b]: m_last[1];	}
+
+	uint64_t getElements() const
+	{	return m_last[0];	}
+
+	uint64_t getNonEmpty() const
+	{	return m_last[1];	}
+
+	// Writes <_db>.ix, once the files of the database are written
+	bool write(const std::string& _db) const
+	{
+		uint64_t bytes[3];
+		if (!fileSizes(_db, bytes))
+		{	return false;	}
+		FILE* fd = fopen((_db + ".ix").c_str(), "w");
+		if (fd == NULL)
+		{	return false;	}
+		const uint64_t header[IXHEADER] = {IXMAGIC, IXVERSION, m_nbBuckets, IXBLOCK, m_elements.size(), getElements(), bytes[0], bytes[1], bytes[2]};
+		bool ok = fwrite(header, sizeof(uint64_t), IXHEADER, fd) == IXHEADER;
+		for(size_t b = 0; ok && b <= m_elements.size(); b++)
+		{
+			const uint64_t entry[2] = {getElements(b), getNonEmpty(b)};
+			ok = fwrite(entry, sizeof(uint64_t), 2, fd) == 2;
+		}
+		return fclose(fd) == 0 && ok;
+	}
+
+	// Loads <_db>.ix, or rebuilds it from <_db>.sz (and saves it if possible) when it does not describe the
+	// files of the database. Returns false if the .sz file is missing or does not hold _nbBuckets sizes.
+	bool load(const std::string& _db, const size_t& _nbBuckets, const size_t& _nbCPU)
+	{
+		const std::string fileIx = _db + ".ix", fileSz = _db + ".sz";
+		struct stat stIx, stSz;
+		if (stat(fileSz.c_str(), &stSz) != 0 || (size_t) stSz.st_size != _nbBuckets || !readLong(_db + ".sx"))
+		{	return false;	}
+		if (stat(fileIx.c_str(), &stIx) == 0 && stIx.st_mtime >= stSz.st_mtime && read(_db, _nbBuckets))
+		{	return true;	}
+		if (!build(fileSz, _nbBuckets, _nbCPU))
+		{	return false;	}
+		write(_db);
+		return true;
+	}
+
+	// Builds the index from the size bytes of the buckets in memory (database container, see setLong())
+	void build(const uint8_t* _sizes, const size_t& _nbBuckets, const size_t& _nbCPU)
+	{
+		clear();
+		const size_t nbBlocks = (_nbBuckets + IXBLOCK - 1) / IXBLOCK;
+		m_elements.resize(nbBlocks, 0);
+		m_nonEmpty.resize(nbBlocks, 0);
+#ifdef _OPENMP
+		omp_set_num_threads(_nbCPU);
+#endif
+#pragma omp parallel for schedule(dynamic)
+		for(size_t b = 0; b < nbBlocks; b++)
+		{	count(b, _sizes + b * IXBLOCK, b + 1 < nbBlocks ? IXBLOCK: _nbBuckets - b * IXBLOCK);	}
+		prefixSums(_nbBuckets);
+	}
+
+	// pread of _bytes at _offset, until done
+	static bool readAt(const int& _fd, void* _buffer, const size_t& _bytes, const size_t& _offset)
+	{
+		size_t done = 0;
+		while (done < _bytes)
+		{
+			const ssize_t r = pread(_fd, (uint8_t*) _buffer + done, _bytes - done, _offset + done);
+			if (r <= 0)
+			{	return false;	}
+			done += r;
+		}
+		return true;
+	}
+
+	private:
+	// Sizes of <_db>.sz, <_db>.ky and <_db>.lb
+	static bool fileSizes(const std::string& _db, uint64_t* _bytes)
+	{
+		const char* ext[3] = {".sz", ".ky", ".lb"};
+		for(size_t f = 0; f < 3; f++)
+		{
+			struct stat st;
+			if (stat((_db + ext[f]).c_str(), &st) != 0)
+			{	return false;	}
+			_bytes[f] = st.st_size;
+		}
+		return true;
+	}
+
+	// Reads <_db>.ix, rejected if its header does not match the files of the database
+	bool read(const std::string& _db, const size_t& _nbBuckets)
+	{
+		clear();
+		uint64_t bytes[3];
+		if (!fileSizes(_db, bytes))
+		{	return false;	}
+		FILE* fd = fopen((_db + ".ix").c_str(), "r");
+		if (fd == NULL)
+		{	return false;	}
+		uint64_t header[IXHEADER];
+		bool ok = fread(header, sizeof(uint64_t), IXHEADER, fd) == IXHEADER && header[0] == IXMAGIC && header[1] == IXVERSION
+			&& header[2] == _nbBuckets && header[3] == IXBLOCK && header[4] == (_nbBuckets + IXBLOCK - 1) / IXBLOCK
+			&& header[6] == bytes[0] && header[7] == bytes[1] && header[8] == bytes[2];
+		std::vector<uint64_t> entries(ok ? 2 * (header[4] + 1): 0);
+		ok = ok && fread(&entries.front(), sizeof(uint64_t), entries.size(), fd) == entries.size();
+		fclose(fd);
+		if (!ok || entries[2*header[4]] != header[5])
+		{	return false;	}
+		for(size_t b = 0; b < header[4]; b++)
+		{
+			m_elements.push_back(entries[2*b]);
+			m_nonEmpty.push_back(entries[2*b+1]);
+		}
+		m_last[0] = entries[2*header[4]];
+		m_last[1] = entries[2*header[4]+1];
+		m_nbBuckets = _nbBuckets;
+		return true;
+	}
+
+	// Counts of each block in parallel, then prefix sums
+	bool build(const std::string& _fileSz, const size_t& _nbBuckets, const size_t& _nbCPU)
+	{
+		clear();
+		const int fd = open(_fileSz.c_str(), O_RDONLY);
+		if (fd == -1)
+		{	return false;	}
+		const size_t nbBlocks = (_nbBuckets + IXBLOCK - 1) / IXBLOCK;
+		m_elements.resize(nbBlocks, 0);
+		m_nonEmpty.resize(nbBlocks, 0);
+		bool ok = true;
+#ifdef _OPENMP
+		omp_set_num_threads(_nbCPU);
+#endif
+#pragma omp parallel
+		{
+			std::vector<uint8_t> sizes(IXBLOCK);
+#pragma omp for schedule(dynamic)
+			for(size_t b = 0; b < nbBlocks; b++)
+			{
+				const size_t len = b + 1 < nbBlocks ? IXBLOCK: _nbBuckets - b * IXBLOCK;
+				if (!readAt(fd, &sizes.front(), len, b * IXBLOCK))
+				{
+					ok = false;
+					continue;
+				}
+				count(b, &sizes.front(), len);
+			}
+		}
+		close(fd);
+		prefixSums(_nbBuckets);
+		return ok;
+	}
+
+	void count(const size_t& _b, const uint8_t* _sizes, const size_t& _len)
+	{
+		for(size_t t = 0; t < _len; t++)
+		{
+			m_elements[_b] += _sizes[t] < LONGBUCKET ? _sizes[t]: getSize(_b * IXBLOCK + t, _sizes[t]);
+			m_nonEmpty[_b] += _sizes[t] > 0 ? 1: 0;
+		}
+	}
+
+	void prefixSums(const size_t& _nbBuckets)
+	{
+		uint64_t e = 0, n = 0, c = 0;
+		for(size_t b = 0; b < m_elements.size(); b++)
+		{
+			c = m_elements[b];
+			m_elements[b] = e;
+			e += c;
+			c = m_nonEmpty[b];
+			m_nonEmpty[b] = n;
+			n += c;
+		}
+		m_last[0] = e;
+		m_last[1] = n;
+		m_nbBuckets = _nbBuckets;
+	}
+
+	std::vector<uint64_t>	m_elements;	// Keys before each block
+	std::vector<uint64_t>	m_nonEmpty;	// Non-empty buckets before each block
+	std::vector< std::pair<uint64_t, uint64_t> >	m_long;	// Sizes of the long buckets
+	uint64_t		m_last[2];	// Totals
+	size_t			m_nbBuckets;
+};
+
+#endif
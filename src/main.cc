@@ -54,8 +54,10 @@ void printUsage()
 	cout << "-O <fileObjects>,    \t filename of objects (or list of objects):\t text." << endl;
 	cout << "-P <file1> <file2>,  \t filenames of paired-end reads:\t texts." << endl;
 	cout << "-R <fileResults>,    \t filename to store results (or corresponding list of results file):\t text.\n";
-	cout << "-m <mode>,           \t mode of execution: 0 (full), 1 (default), 2 (express) and 3 (spectrum).\n";
+	cout << "-m <mode>,           \t mode of execution: 0 (full), 1 (default), 2 (express), 3 (spectrum) and 4 (cascade).\n";
 	cout << "                     \t For CLARK-S, the full and default mode are the same.\n";
+	cout << "                     \t The cascade mode scores with all k-mers only the objects whose non-overlapping k-mers give no confident\n";
+	cout << "                     \t assignment, and reports results as the full mode.\n";
 	cout << "-n <numberofthreads>,\t number of threads:\tinteger >= 1." << endl;
 	cout << "--tsk,               \t to request a detailed creation of the database (target specific k-mers files). This option is no more supported." << endl;
 	cout << "--ldm,               \t to request the loading of the database by memory mapped-file (in multithreaded mode, multiple parallel threads are requested)." << endl;
@@ -63,6 +65,52 @@ void printUsage()
 	cout << "--extended,          \t to request an extended output of the full mode (for CLARK only)." << endl;
 	cout << "-g <iteration>,      \t gap or number of non-overlapping k-mers to pass for the database creation (for CLARK-l only). The default value is 4." << endl;
 	cout << "-s <factor>,         \t sampling factor value in the default mode (for CLARK/CLARK-S only). " << endl;
+	cout << "--seeds <m1,m2,m3>,  \t spaced seeds to use instead of T295,T58570,T38570, given as names (T295, T58570, T38570) or masks of '1' and '*' (for CLARK-S only)." << endl;
+	cout << "--early <bins>,      \t to stop scoring an object in the full mode once its assignment and its confidence score, rounded to\n";
+	cout << "                     \t one of <bins> intervals of [0,1], cannot change (scores and gamma then cover the k-mers scanned only)." << endl;
+	cout << "--stride <s>,        \t to query one k-mer out of <s> in the first pass of the cascade mode (adaptive to the length of the object and\n";
+	cout << "                     \t the hit density by default), or in the express mode of CLARK-S (2 by default)." << endl;
+	cout << "--dust <score>,      \t to skip the k-mers of low-complexity regions, i.e., windows of 64 bases with a DUST score higher than <score>\n";
+	cout << "                     \t (20 is usual)." << endl;
+	cout << "--minq <quality>,    \t to skip the k-mers containing a base of quality lower than <quality> (fastq files, Phred+33)." << endl;
+	cout << "--cache <MB>,        \t to reuse the results of identical objects (e.g., duplicated reads), within <MB> megabytes of RAM." << endl;
+	cout << "--bloom <bits>,      \t to check a Bloom filter of <bits> bits per k-mer of the database before each lookup (8 bits give about\n";
+	cout << "                     \t 2% of false positives, 12 bits about 0.3%)." << endl;
+	cout << "--numa <policy>,     \t to place the database on the NUMA nodes: 'interleave' (pages spread over the nodes) or 'replicate'\n";
+	cout << "                     \t (one copy per node, each thread reading the copy of its node)." << endl;
+	cout << "--hugepages <type>,  \t to store the database in huge pages: 'thp' (transparent huge pages), '2m' or '1g' (explicit huge pages\n";
+	cout << "                     \t reserved by the system, transparent ones otherwise)." << endl;
+	cout << "--shm,               \t to attach the database from shared memory, where it is published by the first process loading it\n";
+	cout << "                     \t (other processes then attach it instead of loading their own copy)." << endl;
+	cout << "--shm-preload,       \t to publish the database in shared memory, then exit (-O and -R are not needed)." << endl;
+	cout << "--shm-evict <dir>,   \t to remove from shared memory the databases of the directory <dir>, then exit (only option)." << endl;
+	cout << "--container,         \t to store the database in one file (<db>.cdb) with its settings and checksums, verified at loading\n";
+	cout << "                     \t (database files of the former format are converted)." << endl;
+	cout << "--packed,            \t as '--container', with the keys and labels packed on fewer bits: a smaller file only, the database\n";
+	cout << "                     \t is unpacked at loading and takes as much memory as with '--container'." << endl;
+	cout << "--syncmer <s>,       \t to keep in the database, and to query, only the k-mers that are open syncmers of parameter <s> (0 < s < k):\n";
+	cout << "                     \t about one k-mer out of k - s + 1 (smaller database, faster classification)." << endl;
+	cout << "--incremental,       \t to save the index of the build (<db>.mx), then to update the database from it when targets are\n";
+	cout << "                     \t added or removed (the sequences of the removed targets should still be readable)." << endl;
+	cout << "--partial,           \t to build only the table of the targets of <fileTargets> (a share of all targets), saved in\n";
+	cout << "                     \t <directoryDB/> (db_mother_*_part_<hash of the targets>.mx, name printed) to be merged, then exit\n";
+	cout << "                     \t (-O and -R are not needed)." << endl;
+	cout << "--merge <file>,      \t to create the database by merging the tables of partial builds listed in <file> (one per line),\n";
+	cout << "                     \t built from the targets of <fileTargets> (each target in one partial build): the database of a\n";
+	cout << "                     \t single build." << endl;
+	cout << "--lineage <file>,    \t to build a multi-rank database from the labels of <fileTargets> and their lineage in <file>\n";
+	cout << "                     \t (from getfilesToTaxNodes): each k-mer is kept at the lowest rank where it is discriminative." << endl;
+	cout << "--rank <r>,          \t with '--lineage', rank of the classification: 0 for species, 1 for genus, ..., 5 for phylum\n";
+	cout << "                     \t (default: the rank of the labels of <fileTargets>)." << endl;
+	cout << "--subset <file> <dir>,\t to create the database of the targets of <fileTargets> (a panel) by extracting the k-mers of their\n";
+	cout << "                     \t labels from the database of the targets in <file> saved in <dir> (same settings)." << endl;
+	cout << "--dedup,             \t to skip the targets that are exact duplicates (same sequences) of a target of the same label\n";
+	cout << "                     \t when building the database; they are listed in <db>.dup." << endl;
+	cout << "--checkpoint <min>,  \t to save the state of the build of the database every <min> minutes (<db>.ckp): the build\n";
+	cout << "                     \t pauses to append the buckets changed since the previous checkpoint." << endl;
+	cout << "--resume,            \t to resume the build of the database from its last checkpoint." << endl;
+	cout << "--pin,               \t to pin the classification threads to cores, spread over the NUMA nodes." << endl;
+	cout << "--bloom-mb <MB>,     \t maximum size of the Bloom filter in megabytes (the false positive rate increases accordingly)." << endl;
 	cout << endl;
 	cout << "--help,              \t to print help/options." << endl;
 	cout << "--version,           \t to print the version info." << endl;
@@ -84,6 +132,21 @@ int main(int argc, char** argv)
 			return 0; 
 		}
 	}
+	if (argc == 3 && string(argv[1]) == "--shm-evict")
+	{
+		char* folder = realpath(argv[2], NULL);
+		if (folder == NULL)
+		{
+			cerr << "Failed to find the directory " << argv[2] << endl;
+			return 1;
+		}
+		string path(folder);
+		free(folder);
+		path.push_back('/');
+		if (sharedSegment::evict(path) == 0)
+		{	cerr << "No database of " << path << " in shared memory." << endl;	}
+		return 0;
+	}
 	if (argc < 6)
 	{		
 		cerr << "To run " << argv[0] << ", at least four  parameters are necessary:\n" ;
@@ -91,10 +154,10 @@ int main(int argc, char** argv)
 		printUsage();
 		return -1;
 	}
-	size_t	k 		= LENGTH, w = 0, mode = 1, cpu = 1, iterKmers = 0;
+	size_t	k 		= LENGTH, w = 0, mode = 1, cpu = 1, iterKmers = 0, bins = 0, stride = 0, dust = 0, minq = 0, cacheMB = 0, bloom = 0, bloomMB = 0, numa = NUMA_NONE, pages = PAGES_DEFAULT, dbFormat = CDB_LEGACY, syncmer = 0;
 	ITYPE minT 		= 0, minO = 0, sfactor = 0;
-	bool cLightDB 		= false, spacedK = false, ldm = false, tsk = false, kso= false, ext = false, isReduced = false;
-	int i_targets	 	= -1, i_objects = -1, i_objects2 = -1, i_folder=-1, i_results =-1;
+	bool cLightDB 		= false, spacedK = false, ldm = false, tsk = false, kso= false, ext = false, isReduced = false, pin = false, shm = false, shmPreload = false, incremental = false, partial = false, dedup = false, resume = false;
+	int i_targets	 	= -1, i_objects = -1, i_objects2 = -1, i_folder=-1, i_results =-1, i_merge = -1, i_lineage = -1, rank = -1, i_subset = -1, checkpoint = 0;
 	std::vector<std::string> DSS;
 
 	if (WEIGHT != LENGTH) 
@@ -107,7 +170,7 @@ int main(int argc, char** argv)
 		DSS.push_back(s3);
 	}
 
-	for(size_t i = 1; i < argc ; i++)
+	for(int i = 1; i < argc ; i++)
 	{
 		string val(argv[i]);
 		if (val ==  "-k")
@@ -131,7 +194,7 @@ int main(int argc, char** argv)
 		{
 			if (++i >= argc) {cerr << "Please specify the mode!"<< endl; exit(1);    }
 			mode =  atoi(argv[i]);
-			if (mode > 3) {	cerr <<"The mode of execution should be 0, 1, 2 or 3." << endl; exit(1);}
+			if (mode > 4) {	cerr <<"The mode of execution should be 0, 1, 2, 3 or 4." << endl; exit(1);}
 			if (mode != 3) {	kso = false;	}
 			continue;
 		}
@@ -202,6 +265,163 @@ int main(int argc, char** argv)
 			{	cerr << "The sampling factor value should be in the interval [1,"<< SFACTORMAX <<"]."<< endl; 
 				exit(1);    }
 			continue;}
+		if (val == "--seeds")
+		{
+			if (++i >= argc) {cerr << "Please specify the spaced seeds (e.g., 1111*111*111**1*111**1*11*11111,...)!"<< endl; exit(1);    }
+			if (!spacedK) {	cerr << "The option '--seeds' is only for CLARK-S." << endl; exit(1);	}
+			DSS.clear();
+			string seeds(argv[i]);
+			size_t pos = 0;
+			while (pos <= seeds.size())
+			{
+				size_t end = seeds.find(',', pos);
+				if (end == string::npos)
+				{	end = seeds.size();	}
+				string mask = seeds.substr(pos, end - pos);
+				if (!spacedKmer::isSeed(mask)) {	cerr << "Invalid spaced seed: '" << mask << "' (expected T295, T58570, T38570 or a mask of '1' and '*' or '0')." << endl; exit(1);	}
+				DSS.push_back(mask);
+				pos = end + 1;
+			}
+			if (DSS.size() > NBSEEDS) {	cerr << "At most " << NBSEEDS << " spaced seeds can be used." << endl; exit(1);	}
+			continue;}
+		if (val == "--early")
+		{
+			if (++i >= argc) {cerr << "Please specify the number of confidence intervals!"<< endl; exit(1);    }
+			const int value = atoi(argv[i]);
+			if (value < 1) { cerr << "The number of confidence intervals should be higher than 0." << endl; exit(1);}
+			bins = value;
+			continue;}
+		if (val == "--stride")
+		{
+			if (++i >= argc) {cerr << "Please specify a stride value!"<< endl; exit(1);    }
+			const int value = atoi(argv[i]);
+			if (value < 1) { cerr << "The stride value should be higher than 0." << endl; exit(1);}
+			stride = value;
+			continue;}
+		if (val == "--dust")
+		{
+			if (++i >= argc) {cerr << "Please specify a DUST score!"<< endl; exit(1);    }
+			const int value = atoi(argv[i]);
+			if (value < 1) { cerr << "The DUST score should be higher than 0." << endl; exit(1);}
+			dust = value;
+			continue;}
+		if (val == "--minq")
+		{
+			if (++i >= argc) {cerr << "Please specify a quality value!"<< endl; exit(1);    }
+			const int value = atoi(argv[i]);
+			if (value < 1 || value > 93) { cerr << "The quality value should be in [1,93]." << endl; exit(1);}
+			minq = value;
+			continue;}
+		if (val == "--cache")
+		{
+			if (++i >= argc) {cerr << "Please specify the size of the cache (MB)!"<< endl; exit(1);    }
+			const int value = atoi(argv[i]);
+			if (value < 1) { cerr << "The size of the cache should be higher than 0." << endl; exit(1);}
+			cacheMB = value;
+			continue;}
+		if (val == "--bloom")
+		{
+			if (++i >= argc) {cerr << "Please specify the number of bits per k-mer of the Bloom filter!"<< endl; exit(1);    }
+			const int value = atoi(argv[i]);
+			if (value < 1 || value > 64) { cerr << "The number of bits per k-mer should be in [1,64]." << endl; exit(1);}
+			bloom = value;
+			continue;}
+		if (val == "--numa")
+		{
+			if (++i >= argc) {cerr << "Please specify the NUMA policy (interleave or replicate)!"<< endl; exit(1);    }
+			string policy(argv[i]);
+			if (policy == "interleave") 	{ numa = NUMA_INTERLEAVE; continue;}
+			if (policy == "replicate") 	{ numa = NUMA_REPLICATE; continue;}
+			cerr << "Failed to recognize the NUMA policy: " << policy << " (interleave or replicate)." << endl;
+			exit(1);}
+		if (val == "--hugepages")
+		{
+			if (++i >= argc) {cerr << "Please specify the type of huge pages (thp, 2m or 1g)!"<< endl; exit(1);    }
+			string type(argv[i]);
+			if (type == "thp") 	{ pages = PAGES_THP; continue;}
+			if (type == "2m") 	{ pages = PAGES_2M; continue;}
+			if (type == "1g") 	{ pages = PAGES_1G; continue;}
+			cerr << "Failed to recognize the type of huge pages: " << type << " (thp, 2m or 1g)." << endl;
+			exit(1);}
+		if (val == "--shm")
+		{
+			shm = true;
+			continue;}
+		if (val == "--shm-preload")
+		{
+			shm = true;
+			shmPreload = true;
+			continue;}
+		if (val == "--container")
+		{
+			dbFormat = dbFormat == CDB_LEGACY ? CDB_RAW: dbFormat;
+			continue;}
+		if (val == "--packed")
+		{
+			dbFormat = CDB_PACKED;
+			continue;}
+		if (val == "--syncmer")
+		{
+			if (++i >= argc) {cerr << "Please specify the length of the s-mers!"<< endl; exit(1);    }
+			const int value = atoi(argv[i]);
+			if (value < 1) { cerr << "The length of the s-mers should be higher than 0." << endl; exit(1);}
+			syncmer = value;
+			continue;}
+		if (val == "--incremental")
+		{
+			incremental = true;
+			continue;}
+		if (val == "--checkpoint")
+		{
+			if (++i >= argc) {cerr << "Please specify the number of minutes between two checkpoints!"<< endl; exit(1);    }
+			checkpoint = atoi(argv[i]);
+			if (checkpoint <= 0) { cerr << "The number of minutes between two checkpoints should be positive." << endl; exit(1);}
+			continue;}
+		if (val == "--resume")
+		{
+			resume = true;
+			continue;}
+		if (val == "--dedup")
+		{
+			dedup = true;
+			continue;}
+		if (val == "--partial")
+		{
+			partial = true;
+			continue;}
+		if (val == "--merge")
+		{
+			if (++i >= argc) {cerr << "Please specify the file listing the partial builds!"<< endl; exit(1);    }
+			i_merge = i;
+			continue;}
+		if (val == "--lineage")
+		{
+			if (++i >= argc) {cerr << "Please specify the lineage file!"<< endl; exit(1);    }
+			i_lineage = i;
+			continue;}
+		if (val == "--subset")
+		{
+			if (i+2 >= argc) {cerr << "Please specify the targets file and the directory of the database to extract from!"<< endl; exit(1);    }
+			i_subset = ++i;
+			if (!validFile(argv[i++])) { cerr <<"Failed to find/read " << argv[i-1] << endl; exit(1);}
+			continue;}
+		if (val == "--rank")
+		{
+			if (++i >= argc) {cerr << "Please specify the rank (between 0 and 5)!"<< endl; exit(1);    }
+			rank = atoi(argv[i]);
+			if (rank < 0 || rank > 5) { cerr << "The rank should be between 0 (species) and 5 (phylum)." << endl; exit(1);}
+			continue;}
+		if (val == "--pin")
+		{
+			pin = true;
+			continue;}
+		if (val == "--bloom-mb")
+		{
+			if (++i >= argc) {cerr << "Please specify the size of the Bloom filter (MB)!"<< endl; exit(1);    }
+			const int value = atoi(argv[i]);
+			if (value < 1) { cerr << "The size of the Bloom filter should be higher than 0." << endl; exit(1);}
+			bloomMB = value;
+			continue;}
 		cerr << "Failed to recognize option: " << val << endl;
 		exit(1);
 	}
@@ -223,6 +443,19 @@ int main(int argc, char** argv)
         {
                 k = LENGTH;
                 w = WEIGHT;
+		for(size_t t = 0; t < DSS.size(); t++)
+		{
+			spacedKmer seed(DSS[t]);
+			if (t == 0)
+			{	k = seed.getLength();
+				w = seed.getWeight();
+			}
+			if (seed.getLength() != k || seed.getWeight() != w)
+			{
+				cerr << "All spaced seeds should have the same length and weight." << endl;
+				exit(1);
+			}
+		}
         }
 	else
 	{
@@ -237,7 +470,7 @@ int main(int argc, char** argv)
 		cerr << "Please specify a k-mer length: -k <integer>" << endl;
 		exit(1);
 	}
-	if ( i_targets < 0 || i_folder < 0 || i_objects < 0 ||  i_results < 0)
+	if ( i_targets < 0 || i_folder < 0 || (!shmPreload && !partial && (i_objects < 0 ||  i_results < 0)))
 	{
 		cerr << "Failed to run " << argv[0] << ": at least four  parameters are necessary" ;
 		cerr << ": file of targets, directory of database, file of objects, file for results."<< endl;
@@ -250,9 +483,105 @@ int main(int argc, char** argv)
 		cerr << "Please, the option '--kso' is only for the spectrum mode."<< endl;
 		exit(1);
 	}
+	if (bins > 0 && (mode == 2 || mode == 3 || (mode == 1 && !spacedK) || ext))
+	{
+		cerr << "Please, the option '--early' is only for the full and cascade modes (without '--extended')."<< endl;
+		exit(1);
+	}
+	if (stride == 1 && mode == 4)
+	{
+		// All k-mers queried in the first pass: the full mode, without the vote
+		cerr << "The cascade mode with a stride of 1 is the full mode: '-m 0' is used." << endl;
+		mode = 0;
+		stride = 0;
+	}
+	if (stride > 0 && mode != 4 && !(mode == 2 && spacedK))
+	{
+		cerr << "Please, the option '--stride' is only for the cascade mode, and the express mode of CLARK-S."<< endl;
+		exit(1);
+	}
+	if (cacheMB > 0 && (mode == 3 || ext))
+	{
+		cerr << "Please, the option '--cache' is not for the spectrum mode, nor with '--extended'."<< endl;
+		exit(1);
+	}
+	if (bloom > 0 && mode == 3)
+	{
+		cerr << "Please, the option '--bloom' is not for the spectrum mode."<< endl;
+		exit(1);
+	}
+	if (syncmer > 0 && (cLightDB || spacedK || mode == 3))
+	{
+		cerr << "Please, the option '--syncmer' is not for CLARK-l, CLARK-S, nor the spectrum mode."<< endl;
+		exit(1);
+	}
+	if (incremental && (cLightDB || spacedK))
+	{
+		cerr << "Please, the option '--incremental' is not for CLARK-l, nor CLARK-S."<< endl;
+		exit(1);
+	}
+	if ((partial || i_merge > 0) && (cLightDB || spacedK || tsk))
+	{
+		cerr << "Please, the options '--partial' and '--merge' are not for CLARK-l, CLARK-S, nor with '--tsk'."<< endl;
+		exit(1);
+	}
+	if (i_merge > 0 && (partial || incremental))
+	{
+		cerr << "Please, the option '--merge' is not with '--partial', nor '--incremental'."<< endl;
+		exit(1);
+	}
+	if (i_lineage > 0 && (cLightDB || spacedK || partial || i_merge > 0))
+	{
+		cerr << "Please, the option '--lineage' is not for CLARK-l, CLARK-S, nor with '--partial' or '--merge'."<< endl;
+		exit(1);
+	}
+	if (i_subset > 0 && (cLightDB || spacedK || tsk || partial || incremental || i_merge > 0 || i_lineage > 0))
+	{
+		cerr << "Please, the option '--subset' is not for CLARK-l, CLARK-S, nor with '--tsk', '--partial', '--incremental', '--merge' or '--lineage'."<< endl;
+		exit(1);
+	}
+	if (dedup && (spacedK || incremental))
+	{
+		cerr << "Please, the option '--dedup' is not for CLARK-S, nor with '--incremental'."<< endl;
+		exit(1);
+	}
+	if ((checkpoint > 0 || resume) && (spacedK || tsk))
+	{
+		cerr << "Please, the options '--checkpoint' and '--resume' are not for CLARK-S, nor with '--tsk'."<< endl;
+		exit(1);
+	}
+	if (rank >= 0 && i_lineage < 0)
+	{
+		cerr << "Please, the option '--rank' needs a multi-rank database ('--lineage')."<< endl;
+		exit(1);
+	}
+	if (syncmer >= k)
+	{
+		cerr << "The length of the s-mers should be lower than the k-mer length (" << k << ")." << endl;
+		exit(1);
+	}
+	if (bloomMB > 0 && bloom == 0)
+	{
+		bloom = 8;
+	}
 	const char * objects 	= i_objects > 0 ? argv[i_objects] : NULL;
 	const char * objects2 	= i_objects2 > 0 ? argv[i_objects2] : NULL;
 	const bool paired 	= i_objects2 > 0;
+	dbOptions options;
+	options.numaPolicy 	= numa;
+	options.pages 		= pages;
+	options.sharedMemory 	= shm;
+	options.dbFormat 	= dbFormat;
+	options.syncmer 	= syncmer;
+	options.incremental 	= incremental;
+	options.partial 	= partial;
+	options.indexes 	= i_merge > 0 ? argv[i_merge] : NULL;
+	options.lineage 	= i_lineage > 0 ? argv[i_lineage] : NULL;
+	options.subset 		= i_subset > 0 ? argv[i_subset] : NULL;
+	options.subsetFolder 	= i_subset > 0 ? argv[i_subset + 1] : NULL;
+	options.dedup 		= dedup;
+	options.checkpoint 	= checkpoint;
+	options.resume 		= resume;
 
 	string folder(argv[i_folder]);
 	if (folder[folder.size()-1] != '/')
@@ -267,31 +596,61 @@ int main(int argc, char** argv)
 	if (w <= max16)
 	{
 		// Use 2Bytes to store each discriminative k-mer
-		CLARK<T16> classifier(k, argv[i_targets], folder.c_str(), w, DSS, minT, tsk, cLightDB, spacedK, iterKmers, cpu, sfactor, ldm);
+		CLARK<T16> classifier(k, argv[i_targets], folder.c_str(), w, DSS, minT, tsk, cLightDB, spacedK, iterKmers, cpu, sfactor, ldm, options);
+		if (partial)
+		{	exit(0);	}
+		classifier.setPrefilter(dust, minq);
+		classifier.setCache(cacheMB);
+		classifier.setBloom(bloom, bloomMB);
+		classifier.setPinning(pin);
+		if (rank >= 0)
+		{	classifier.setRank(rank);	}
+		if (shmPreload)
+		{	exit(0);	}
 		if (paired)
-		{	classifier.run(objects, objects2, argv[i_results], mode, minO, kso, ext, true);	}
+		{	classifier.run(objects, objects2, argv[i_results], mode, minO, kso, ext, true, bins, stride);	}
 		else
-		{	classifier.run(objects, argv[i_results], mode, minO, kso, ext, true); 	}
+		{	classifier.run(objects, argv[i_results], mode, minO, kso, ext, true, bins, stride); 	}
 		exit(0);
 	}
 	if (w <= max32)
 	{
 		// Use 4Bytes to store each discriminative k-mer
-		CLARK<T32> classifier(k, argv[i_targets], folder.c_str(), w, DSS, minT, tsk, cLightDB, spacedK, iterKmers, cpu, sfactor, ldm);
+		CLARK<T32> classifier(k, argv[i_targets], folder.c_str(), w, DSS, minT, tsk, cLightDB, spacedK, iterKmers, cpu, sfactor, ldm, options);
+		if (partial)
+		{	exit(0);	}
+		classifier.setPrefilter(dust, minq);
+		classifier.setCache(cacheMB);
+		classifier.setBloom(bloom, bloomMB);
+		classifier.setPinning(pin);
+		if (rank >= 0)
+		{	classifier.setRank(rank);	}
+		if (shmPreload)
+		{	exit(0);	}
 		if (paired)
-                {       classifier.run(objects, objects2, argv[i_results], mode, minO, kso, ext, true); }
+                {       classifier.run(objects, objects2, argv[i_results], mode, minO, kso, ext, true, bins, stride); }
                 else
-                {       classifier.run(objects, argv[i_results], mode, minO, kso, ext, true);   }  
+                {       classifier.run(objects, argv[i_results], mode, minO, kso, ext, true, bins, stride);   }  
 		exit(0);
 	}
 	if (w <= MAXK)
 	{
 		// Use 8Bytes to store each discriminative k-mer
-		CLARK<T64> classifier(k, argv[i_targets], folder.c_str(), w, DSS, minT, tsk, cLightDB, spacedK, iterKmers, cpu, sfactor, ldm);
+		CLARK<T64> classifier(k, argv[i_targets], folder.c_str(), w, DSS, minT, tsk, cLightDB, spacedK, iterKmers, cpu, sfactor, ldm, options);
+		if (partial)
+		{	exit(0);	}
+		classifier.setPrefilter(dust, minq);
+		classifier.setCache(cacheMB);
+		classifier.setBloom(bloom, bloomMB);
+		classifier.setPinning(pin);
+		if (rank >= 0)
+		{	classifier.setRank(rank);	}
+		if (shmPreload)
+		{	exit(0);	}
 		if (paired)
-                {       classifier.run(objects, objects2, argv[i_results], mode, minO, kso, ext, true); }
+                {       classifier.run(objects, objects2, argv[i_results], mode, minO, kso, ext, true, bins, stride); }
                 else
-                {       classifier.run(objects, argv[i_results], mode, minO, kso, ext, true);   }  
+                {       classifier.run(objects, argv[i_results], mode, minO, kso, ext, true, bins, stride);   }  
 		exit(0);
 	}
 	std::cout <<"This version of CLARK does not support k-mer length strictly higher than " << MAXK << std::endl;
@@ -38,11 +38,20 @@
 
 using namespace std;
 
+	template <typename HKMERc, typename HKMERs>
+int convert(const size_t& _w, const string& _setting, const size_t& _len, const string& _sfile)
+{
+	contiguousTospaced<HKMERc,HKMERs> converter(_w, _setting, _len);
+	converter.populate(_sfile.c_str());
+	converter.write(_sfile.c_str());
+	return 0;
+}
+
 int main(int argc, const char** argv)
 {
 	if (argc != 5)
 	{
-		cerr << argv[0] << " <DatabaseFilename: TSK file> <weight> <len> <setting:T295,...>"<< endl;
+		cerr << argv[0] << " <DatabaseFilename: TSK file> <weight> <len> <setting:T295,T38570,T58570 or mask, e.g. 1111*111*111**1*111**1*11*11111>"<< endl;
 		return 1;
 	}
 	size_t w  = atoi(argv[2]);
@@ -54,20 +63,11 @@ int main(int argc, const char** argv)
 
 	string file(argv[1]);
 	string sfile = file.substr(0,file.size()-3);
+	// Keys of the contiguous database read in the type CLARK wrote them with (as makeSpacedTargetSets)
 	if (max16 >= w)
-	{
-		contiguousTospaced<T32,T16> converter(w, setting, len);
-		converter.populate(sfile.c_str());
-		converter.write(sfile.c_str());
-		exit(0);
-	}
+	{	return len <= max32 ? convert<T32,T16>(w, setting, len, sfile): convert<T64,T16>(w, setting, len, sfile);	}
 	if (max32 >= w)
-        {
-                contiguousTospaced<T32,T32> converter(w, setting, len);
-                converter.populate(sfile.c_str());
-                converter.write(sfile.c_str());
-                exit(0);
-        }
+	{	return len <= max32 ? convert<T32,T32>(w, setting, len, sfile): convert<T64,T32>(w, setting, len, sfile);	}
+	cerr << "The weight " << w << " is too large for the spaced databases (at most " << max32 << ")." << endl;
 	return 1;
 }
-
@@ -0,0 +1,214 @@
+/*
+ * CLARK, CLAssifier based on Reduced K-mers.
+ */
+
+/*
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+   Copyright 2013-2017, Rachid Ounit <clark.ucr.help at gmail.com>
+*/
+
+/*
+ * @author: Rachid Ounit, Ph.D Candidate.
+ * @project: CLARK, Metagenomic and Genomic Sequences Classification project.
+ * @note: C++ IMPLEMENTATION supported on latest Linux and Mac OS.
+ *
+ */
+
+#ifndef MEMORYARENA_HH
+#define MEMORYARENA_HH
+
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <iostream>
+#include <stdint.h>
+#include <sys/mman.h>
+#include "./numaPolicy.hh"
+
+#define PAGES_DEFAULT	0	// Base pages
+#define PAGES_THP	1	// Transparent huge pages (madvise)
+#define PAGES_2M	2	// Explicit 2 MB huge pages (MAP_HUGETLB)
+#define PAGES_1G	3	// Explicit 1 GB huge pages (MAP_HUGETLB)
+
+#ifndef MAP_NORESERVE
+#define MAP_NORESERVE 0
+#endif
+#ifndef MAP_HUGE_SHIFT
+#define MAP_HUGE_SHIFT	26
+#endif
+
+//	CLASS
+//	Name: memoryArena
+//	Implementation notes: One anonymous mapping holding the buckets of the database (instead of one
+//	allocation per bucket), so that its placement can be set at once before the pages are touched.
+//	Memory is handed out in order (allocate) or at a given offset (at); it is released as a whole.
+//	Huge pages: explicit ones (MAP_HUGETLB, from the pool of the system) fall back to transparent ones,
+//	which fall back to base pages; getPageSize() reports what was obtained.
+//
+class memoryArena
+{
+	public:
+	memoryArena(): m_base(NULL), m_size(0), m_used(0), m_pages(PAGES_DEFAULT), m_owned(false)
+	{}
+	~memoryArena()
+	{	release();	}
+
+	void init(const size_t& _bytes, const size_t& _policy = NUMA_NONE, const size_t& _node = 0, const size_t& _pages = PAGES_DEFAULT)
+	{
+		release();
+		m_size = _bytes > 0 ? _bytes: 1;
+		m_pages = _pages;
+		void* p = MAP_FAILED;
+#ifdef MAP_HUGETLB
+		if (_pages == PAGES_2M || _pages == PAGES_1G)
+		{
+			const size_t page = _pages == PAGES_1G ? 1UL << 30: 1UL << 21;
+			const size_t size = (m_size + page - 1) & ~(page - 1);
+			const int flags = MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | ((_pages == PAGES_1G ? 30: 21) << MAP_HUGE_SHIFT);
+			p = mmap(0, size, PROT_READ | PROT_WRITE, flags, -1, 0);
+			if (p != MAP_FAILED)
+			{	m_size = size;	}
+		}
+#endif
+		if (p == MAP_FAILED)
+		{
+			if (_pages == PAGES_2M || _pages == PAGES_1G)
+			{	std::cerr << "Failed to map explicit huge pages (see /proc/sys/vm/nr_hugepages): using transparent huge pages." << std::endl;	}
+			m_pages = _pages == PAGES_DEFAULT ? PAGES_DEFAULT: PAGES_THP;
+			p = mmap(0, m_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+		}
+		if (p == MAP_FAILED)
+		{
+			std::cerr << "Failed to allocate " << m_size / 1000000 << " MB for the database." << std::endl;
+			exit(1);
+		}
+		m_base = (uint8_t*) p;
+		m_owned = true;
+		if (m_pages == PAGES_THP)
+		{	adviseHuge(m_base, m_size);	}
+		if (!numaPolicy::bind(m_base, m_size, _policy, _node))
+		{	std::cerr << "Failed to set the NUMA placement of the database (ignored)." << std::endl;	}
+	}
+
+	// Memory mapped by someone else (e.g., a sharedSegment), not released by the arena
+	void adopt(void* _base, const size_t& _bytes)
+	{
+		release();
+		m_base 	= (uint8_t*) _base;
+		m_size 	= _bytes;
+		m_owned = false;
+	}
+
+	bool isEnabled() const
+	{	return m_base != NULL;	}
+
+	// Next _bytes, aligned on 8 bytes
+	void* allocate(const size_t& _bytes)
+	{
+		void* p = at(m_used);
+		m_used += (_bytes + 7) & ~(size_t) 7;
+		if (m_used > m_size)
+		{
+			std::cerr << "Failed to allocate memory for the database (arena of " << m_size << " bytes full)." << std::endl;
+			exit(1);
+		}
+		return p;
+	}
+
+	void* at(const size_t& _offset) const
+	{	return m_base + _offset;	}
+
+	uint8_t* base() const
+	{	return m_base;	}
+
+	size_t size() const
+	{	return m_size;	}
+
+	size_t used() const
+	{	return m_used;	}
+
+	void setUsed(const size_t& _used)
+	{	m_used = _used;	}
+
+	// Page size backing the arena: explicit huge pages, or the share of transparent huge pages
+	// found in /proc/self/smaps (Linux)
+	std::string getPageSize() const
+	{
+		if (m_pages == PAGES_2M || m_pages == PAGES_1G)
+		{	return m_pages == PAGES_1G ? "1 GB pages": "2 MB pages";	}
+		char line[256], info[128];
+		sprintf(info, "4 kB pages");
+		FILE* fd = fopen("/proc/self/smaps", "r");
+		if (fd == NULL || m_base == NULL)
+		{
+			if (fd != NULL)
+			{	fclose(fd);	}
+			return info;
+		}
+		bool inside = false;
+		while (fgets(line, sizeof(line), fd) != NULL)
+		{
+			unsigned long s = 0, e = 0;
+			if (sscanf(line, "%lx-%lx ", &s, &e) == 2)
+			{
+				inside = s <= (uintptr_t) m_base && (uintptr_t) m_base < e;
+				continue;
+			}
+			unsigned long kb = 0;
+			if (inside && sscanf(line, "AnonHugePages: %lu kB", &kb) == 1)
+			{
+				if (kb > 0)
+				{	sprintf(info, "2 MB transparent pages for %lu MB", kb >> 10);	}
+				break;
+			}
+		}
+		fclose(fd);
+		return info;
+	}
+
+	// Transparent huge pages for [_addr, _addr + _length) (aligned inside), when supported
+	static void adviseHuge(void* _addr, const size_t& _length)
+	{
+#ifdef MADV_HUGEPAGE
+		const uintptr_t page = 1UL << 21;
+		const uintptr_t s = ((uintptr_t) _addr + page - 1) & ~(page - 1);
+		const uintptr_t e = ((uintptr_t) _addr + _length) & ~(page - 1);
+		if (e > s)
+		{	madvise((void*) s, e - s, MADV_HUGEPAGE);	}
+#endif
+	}
+
+	void release()
+	{
+		if (m_base != NULL && m_owned)
+		{	munmap(m_base, m_size);	}
+		m_base = NULL;
+		m_size = 0;
+		m_used = 0;
+	}
+
+	private:
+	memoryArena(const memoryArena&);
+	memoryArena& operator=(const memoryArena&);
+
+	uint8_t*	m_base;
+	size_t		m_size;
+	size_t		m_used;
+	size_t		m_pages;	// Pages obtained (PAGES_*)
+	bool		m_owned;	// Mapped by init()
+};
+
+#endif
@@ -0,0 +1,236 @@
+/*
+ * CLARK, CLAssifier based on Reduced K-mers.
+ */
+
+/*
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+   Copyright 2013-2017, Rachid Ounit <clark.ucr.help at gmail.com>
+*/
+
+/*
+ * @author: Rachid Ounit, Ph.D Candidate.
+ * @project: CLARK, Metagenomic and Genomic Sequences Classification project.
+ * @note: C++ IMPLEMENTATION supported on latest Linux and Mac OS.
+ *
+ */
+#ifndef MOTHERINDEX_HH
+#define MOTHERINDEX_HH
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cstdio>
+#include <stdint.h>
+#include "./dataType.hh"
+#include "./loadIndex.hh"
+
+#define MXMAGIC		0x31584d4b52414c43ULL	// "CLARKMX1"
+#define MXVERSION	2
+#define MXEXT		".mx"
+
+//	CLASS
+//	Name: motherIndex
+//	Implementation notes: Mother table of a build saved before the removal of the common k-mers (every k-mer
+//	with its label, multiplicity and count) with the targets it was built from and the names of its labels,
+//	so that a later build only processes the targets added or removed. A header, then the targets (file,
+//	offset and length, then label) and the labels as strings, then the table (hTable::dump).
+//	The file is written under a temporary name and renamed once complete. The table of a partial build
+//	(keys in canonical orientation) is also read one bucket at a time to be merged with others.
+//
+class motherIndex
+{
+	public:
+	motherIndex(): m_fd(NULL), m_canonical(false)
+	{}
+	~motherIndex()
+	{	close();	}
+
+	// Opens _file and reads its targets and labels when its settings match; the table follows (readTable)
+	bool open(const std::string& _file, const size_t& _k, const size_t& _s, const size_t& _keyBytes, const size_t& _cellBytes)
+	{
+		close();
+		m_fd = fopen(_file.c_str(), "r");
+		Header header;
+		if (m_fd == NULL || fread(&header, sizeof(Header), 1, m_fd) != 1)
+		{
+			close();
+			return false;
+		}
+		if (header.magic != MXMAGIC || header.version != MXVERSION || header.nbBuckets != HTSIZE || header.k != _k ||
+			header.s != _s || header.keyBytes != _keyBytes || header.cellBytes != _cellBytes)
+		{
+			std::cerr << "The index " << _file << " was built with other settings: ignored." << std::endl;
+			close();
+			return false;
+		}
+		if (!readStrings(m_fd, m_targets, header.nbTargets) || !readStrings(m_fd, m_ids, header.nbTargets) || !readStrings(m_fd, m_labels, header.nbLabels))
+		{
+			std::cerr << "Failed to read " << _file << std::endl;
+			close();
+			return false;
+		}
+		m_canonical = header.canonical != 0;
+		return true;
+	}
+
+	// Table of the index, labels renamed by _labels (label of the current build of each label of the index)
+	template <typename TABLE>
+	bool readTable(TABLE& _table, const std::vector<ILBL>& _labels)
+	{
+		const bool done = m_fd != NULL && _table.Restore(m_fd, _labels);
+		close();
+		return done;
+	}
+
+	// Sizes of the buckets of the table, read then one by one in order (readBucket)
+	bool openTable()
+	{
+		uint64_t nbCells = 0, nbLong = 0;
+		m_sizes.resize(HTSIZE);
+		if (m_fd == NULL || fread(&nbCells, sizeof(uint64_t), 1, m_fd) != 1 || fread(&m_sizes.front(), 1, HTSIZE, m_fd) != HTSIZE ||
+			fread(&nbLong, sizeof(uint64_t), 1, m_fd) != 1)
+		{	return false;	}
+		std::vector< std::pair<uint64_t, uint64_t> > longs(nbLong);
+		if (nbLong > 0 && fread(&longs.front(), sizeof(std::pair<uint64_t, uint64_t>), nbLong, m_fd) != nbLong)
+		{	return false;	}
+		m_index.setLong(nbLong > 0 ? &longs.front(): NULL, nbLong);
+		return true;
+	}
+
+	// Cells of the bucket _bucket (buckets read in increasing order)
+	template <typename CELL>
+	bool readBucket(const size_t& _bucket, std::vector<CELL>& _cells)
+	{
+		const uint64_t c = m_index.getSize(_bucket, m_sizes[_bucket]);
+		_cells.resize(c);
+		return c == 0 || fread(&_cells.front(), sizeof(CELL), c, m_fd) == c;
+	}
+
+	template <typename TABLE>
+	static bool write(const std::string&			_file,
+			const size_t&				_k,
+			const size_t&				_s,
+			const bool&				_canonical,
+			const size_t&				_keyBytes,
+			const size_t&				_cellBytes,
+			const std::vector<std::string>&		_targets,
+			const std::vector<std::string>&		_ids,
+			const std::vector<std::string>&		_labels,
+			const TABLE&				_table,
+			const size_t&				_iteratorPos
+			)
+	{
+		const std::string tmp = _file + ".tmp";
+		FILE* fd = fopen(tmp.c_str(), "w");
+		if (fd == NULL)
+		{	return false;	}
+		Header header;
+		header.magic 	 = MXMAGIC;
+		header.version 	 = MXVERSION;
+		header.nbBuckets = HTSIZE;
+		header.k 	 = _k;
+		header.s 	 = _s;
+		header.canonical = _canonical ? 1: 0;
+		header.keyBytes  = _keyBytes;
+		header.cellBytes = _cellBytes;
+		header.nbTargets = _targets.size();
+		header.nbLabels  = _labels.size();
+		bool done = fwrite(&header, sizeof(Header), 1, fd) == 1;
+		done = done && writeStrings(fd, _targets) && writeStrings(fd, _ids) && writeStrings(fd, _labels);
+		done = done && _table.Dump(fd, _iteratorPos);
+		done = fclose(fd) == 0 && done;
+		if (!done || rename(tmp.c_str(), _file.c_str()) != 0)
+		{
+			remove(tmp.c_str());
+			return false;
+		}
+		return true;
+	}
+
+	const std::vector<std::string>& getTargets() const
+	{	return m_targets;	}
+
+	const std::vector<std::string>& getIds() const
+	{	return m_ids;	}
+
+	const std::vector<std::string>& getLabels() const
+	{	return m_labels;	}
+
+	// Keys in canonical orientation (partial build)
+	bool isCanonical() const
+	{	return m_canonical;	}
+
+	// Strings as their length then their characters (also used by buildCheckpoint)
+	static bool readStrings(FILE* _fd, std::vector<std::string>& _strings, const uint64_t& _nb)
+	{
+		uint32_t length = 0;
+		_strings.resize(_nb);
+		for(size_t t = 0; t < _nb; t++)
+		{
+			if (fread(&length, sizeof(uint32_t), 1, _fd) != 1)
+			{	return false;	}
+			_strings[t].resize(length);
+			if (length > 0 && fread(&_strings[t][0], 1, length, _fd) != length)
+			{	return false;	}
+		}
+		return true;
+	}
+
+	static bool writeStrings(FILE* _fd, const std::vector<std::string>& _strings)
+	{
+		for(size_t t = 0; t < _strings.size(); t++)
+		{
+			const uint32_t length = _strings[t].size();
+			if (fwrite(&length, sizeof(uint32_t), 1, _fd) != 1 || fwrite(_strings[t].c_str(), 1, length, _fd) != length)
+			{	return false;	}
+		}
+		return true;
+	}
+
+	private:
+	struct Header
+	{
+		uint64_t	magic;
+		uint32_t	version;
+		uint32_t	k;
+		uint64_t	nbBuckets;
+		uint32_t	keyBytes;
+		uint32_t	cellBytes;	// sizeof(htCell) of the table
+		uint32_t	s;		// Length of the s-mers of the syncmers (0 if none)
+		uint32_t	canonical;	// 1 if the keys are in canonical orientation
+		uint64_t	nbTargets;
+		uint64_t	nbLabels;
+	};
+
+	motherIndex(const motherIndex&);
+	motherIndex& operator=(const motherIndex&);
+
+	void close()
+	{
+		if (m_fd != NULL)
+		{	fclose(m_fd);	}
+		m_fd = NULL;
+	}
+
+	FILE*				m_fd;
+	std::vector<std::string>	m_targets;
+	std::vector<std::string>	m_ids;
+	std::vector<std::string>	m_labels;
+	bool				m_canonical;
+	std::vector<uint8_t>		m_sizes;
+	loadIndex			m_index;
+};
+
+#endif
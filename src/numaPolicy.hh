@@ -0,0 +1,179 @@
+/*
+ * CLARK, CLAssifier based on Reduced K-mers.
+ */
+
+/*
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+   Copyright 2013-2017, Rachid Ounit <clark.ucr.help at gmail.com>
+*/
+
+/*
+ * @author: Rachid Ounit, Ph.D Candidate.
+ * @project: CLARK, Metagenomic and Genomic Sequences Classification project.
+ * @note: C++ IMPLEMENTATION supported on latest Linux and Mac OS.
+ *
+ */
+
+#ifndef NUMAPOLICY_HH
+#define NUMAPOLICY_HH
+
+#include <vector>
+#include <string>
+#include <cstdio>
+#include <cstdlib>
+#include <stdint.h>
+#ifdef __linux__
+#include <sched.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#endif
+
+#define NUMA_NONE	0	// Default placement (first touch)
+#define NUMA_INTERLEAVE	1	// Pages of the database interleaved over the nodes
+#define NUMA_REPLICATE	2	// One copy of the database per node
+
+#ifndef MPOL_BIND
+#define MPOL_BIND	2
+#define MPOL_INTERLEAVE	3
+#endif
+#ifndef MPOL_MF_MOVE
+#define MPOL_MF_MOVE	(1 << 1)
+#endif
+
+//	CLASS
+//	Name: numaPolicy
+//	Implementation notes: NUMA topology read from /sys/devices/system/node, placement of memory ranges by
+//	the mbind system call (no dependency on libnuma), and pinning of the classification threads. Thread i
+//	is pinned to a core of the node i modulo the number of nodes, so that threads are spread evenly; the
+//	node of each thread is kept in a thread-local variable to route its lookups to the local replica.
+//	Without Linux (or with a single node), all functions are no-ops.
+//
+class numaPolicy
+{
+	public:
+	static size_t getNbNodes()
+	{	return getTopology().size();	}
+
+	// Places [_addr, _addr + _length) on all nodes (NUMA_INTERLEAVE) or on _node (NUMA_REPLICATE).
+	// Pages already touched are moved.
+	static bool bind(void* _addr, const size_t& _length, const size_t& _policy, const size_t& _node = 0)
+	{
+#ifdef __linux__
+		const size_t nbNodes = getNbNodes();
+		if (_policy == NUMA_NONE || nbNodes < 2 || _length == 0)
+		{	return true;	}
+		// mbind works on whole pages
+		const size_t page = sysconf(_SC_PAGESIZE);
+		const uintptr_t s = ((uintptr_t) _addr + page - 1) & ~(uintptr_t) (page - 1);
+		const uintptr_t e = ((uintptr_t) _addr + _length) & ~(uintptr_t) (page - 1);
+		if (e <= s)
+		{	return true;	}
+		unsigned long mask[16] = {0};
+		for(size_t n = 0; n < nbNodes && n < 1024; n++)
+		{
+			if (_policy == NUMA_INTERLEAVE || n == _node)
+			{	mask[n >> 6] |= 1UL << (n & 63);	}
+		}
+		const int mode = _policy == NUMA_INTERLEAVE ? MPOL_INTERLEAVE: MPOL_BIND;
+		return syscall(SYS_mbind, s, e - s, mode, mask, 1024, MPOL_MF_MOVE) == 0;
+#else
+		return true;
+#endif
+	}
+
+	// Called by the thread _i of a parallel region: pins it if requested, and records its node
+	static void enterThread(const size_t& _i, const bool& _pin)
+	{
+#ifdef __linux__
+		const std::vector< std::vector<int> >& nodes = getTopology();
+		if (_pin && !nodes.empty())
+		{
+			const std::vector<int>& cpus = nodes[_i % nodes.size()];
+			if (!cpus.empty())
+			{
+				cpu_set_t set;
+				CPU_ZERO(&set);
+				CPU_SET(cpus[(_i / nodes.size()) % cpus.size()], &set);
+				sched_setaffinity(0, sizeof(set), &set);
+			}
+		}
+		const int cpu = sched_getcpu();
+		threadNode() = 0;
+		for(size_t n = 0; n < nodes.size(); n++)
+		{
+			for(size_t c = 0; c < nodes[n].size(); c++)
+			{
+				if (nodes[n][c] == cpu)
+				{	threadNode() = n;	}
+			}
+		}
+#endif
+	}
+
+	static size_t getThreadNode()
+	{	return threadNode();	}
+
+	private:
+	static size_t& threadNode()
+	{
+		static __thread size_t node = 0;
+		return node;
+	}
+
+	// CPUs of each node
+	static const std::vector< std::vector<int> >& getTopology()
+	{
+		static const std::vector< std::vector<int> > nodes = readTopology();
+		return nodes;
+	}
+
+	static std::vector< std::vector<int> > readTopology()
+	{
+		std::vector< std::vector<int> > nodes;
+#ifdef __linux__
+		for(size_t n = 0; ; n++)
+		{
+			char name[128];
+			sprintf(name, "/sys/devices/system/node/node%lu/cpulist", n);
+			FILE* fd = fopen(name, "r");
+			if (fd == NULL)
+			{	break;	}
+			char line[4096];
+			std::vector<int> cpus;
+			if (fgets(line, sizeof(line), fd) != NULL)
+			{
+				// Ranges as 0-3,8-11
+				char* p = line;
+				while (*p >= '0' && *p <= '9')
+				{
+					const int a = strtol(p, &p, 10);
+					int b = a;
+					if (*p == '-')
+					{	b = strtol(p + 1, &p, 10);	}
+					for(int c = a; c <= b; c++)
+					{	cpus.push_back(c);	}
+					if (*p == ',')
+					{	p++;	}
+				}
+			}
+			fclose(fd);
+			nodes.push_back(cpus);
+		}
+#endif
+		return nodes;
+	}
+};
+
+#endif
@@ -0,0 +1,433 @@
+/*
+ * CLARK, CLAssifier based on Reduced K-mers.
+ */
+
+/*
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+   Copyright 2013-2017, Rachid Ounit <clark.ucr.help at gmail.com>
+*/
+
+/*
+ * @author: Rachid Ounit, Ph.D Candidate.
+ * @project: CLARK, Metagenomic and Genomic Sequences Classification project.
+ * @note: C++ IMPLEMENTATION supported on latest Linux and Mac OS.
+ *
+ */
+
+#ifndef READENCODER_HH
+#define READENCODER_HH
+
+#include <vector>
+#include <stdint.h>
+#include <cstring>
+#if defined(__AVX2__) || defined(__SSSE3__)
+#include <immintrin.h>
+#endif
+
+//	CLASS
+//	Name: readEncoder
+//	Implementation notes: Convert a sequence into 2-bit codes (A=0, C=1, G=2, T/U=3, as m_table in CLARK)
+//	and a bitmap of ambiguous positions (any other symbol, code set to 0). A second bitmap flags the
+//	ambiguous symbols that are not IUPAC codes either ('.', '-', 'X'...), which invalidate a spaced seed
+//	even on a don't-care position. Sequences split over several lines are appended line by line.
+//	Uses 32 (AVX2) or 16 (SSSE3) bytes per step when available.
+//
+class readEncoder
+{
+	public:
+	readEncoder(): m_size(0)
+	{
+		// 4: IUPAC code other than a base, 5: any other symbol
+		for(size_t t = 0; t < 256; t++)
+		{	m_table[t] = 5;	}
+		const char* iupac = "NMRWVDKYSHBnmrwvdkyshb";
+		for(size_t t = 0; iupac[t] != '\0'; t++)
+		{	m_table[(uint8_t) iupac[t]] = 4;	}
+		m_table['A'] = 0;	m_table['C'] = 1;	m_table['G'] = 2;	m_table['T'] = 3;	m_table['U'] = 3;
+		m_table['a'] = 0;	m_table['c'] = 1;	m_table['g'] = 2;	m_table['t'] = 3;	m_table['u'] = 3;
+	}
+	~readEncoder(){}
+
+	void clear()
+	{	m_size = 0;	}
+
+	size_t size() const
+	{	return m_size;	}
+
+	const uint8_t* getCodes() const
+	{	return &m_codes.front();	}
+
+	bool isAmbiguous(const size_t& _i) const
+	{	return (m_ambiguity[_i >> 6] >> (_i & 63)) & 1;	}
+
+	// True if the symbol at _i is neither a base nor an IUPAC code
+	bool isInvalid(const size_t& _i) const
+	{	return (m_invalid[_i >> 6] >> (_i & 63)) & 1;	}
+
+	// Code of a symbol, more than 3 if it is not a base
+	uint8_t getCode(const uint8_t& _symbol) const
+	{	return m_table[_symbol];	}
+
+	// Bitmap word covering the 64 positions from _i (multiple of 64)
+	uint64_t getAmbiguityWord(const size_t& _i) const
+	{	return m_ambiguity[_i >> 6];	}
+
+	void encode(const uint8_t* _seq, const size_t& _len)
+	{
+		clear();
+		append(_seq, _len);
+	}
+
+	void append(const uint8_t* _seq, const size_t& _len)
+	{
+		reserve(m_size + _len);
+		uint8_t* codes = &m_codes.front() + m_size;
+		size_t i = 0;
+#if defined(__AVX2__)
+		const __m256i lut = _mm256_setr_epi8(0,0,0,1,3,3,0,2,0,0,0,0,0,0,0,0, 0,0,0,1,3,3,0,2,0,0,0,0,0,0,0,0);
+		const __m256i low = _mm256_set1_epi8(0x0F), up = _mm256_set1_epi8((char) 0xDF);
+		for(; i + 32 <= _len; i += 32)
+		{
+			const __m256i c = _mm256_loadu_si256((const __m256i*) (_seq + i));
+			const __m256i u = _mm256_and_si256(c, up);
+			__m256i valid = _mm256_cmpeq_epi8(u, _mm256_set1_epi8('A'));
+			valid = _mm256_or_si256(valid, _mm256_cmpeq_epi8(u, _mm256_set1_epi8('C')));
+			valid = _mm256_or_si256(valid, _mm256_cmpeq_epi8(u, _mm256_set1_epi8('G')));
+			valid = _mm256_or_si256(valid, _mm256_cmpeq_epi8(u, _mm256_set1_epi8('T')));
+			valid = _mm256_or_si256(valid, _mm256_cmpeq_epi8(u, _mm256_set1_epi8('U')));
+			const __m256i code = _mm256_and_si256(_mm256_shuffle_epi8(lut, _mm256_and_si256(c, low)), valid);
+			_mm256_storeu_si256((__m256i*) (codes + i), code);
+			setAmbiguity(m_size + i, ~((uint64_t) (uint32_t) _mm256_movemask_epi8(valid)) & 0xFFFFFFFFUL, 32);
+			setInvalid(_seq, i, ~((uint64_t) (uint32_t) _mm256_movemask_epi8(valid)) & 0xFFFFFFFFUL);
+		}
+#elif defined(__SSSE3__)
+		const __m128i lut = _mm_setr_epi8(0,0,0,1,3,3,0,2,0,0,0,0,0,0,0,0);
+		const __m128i low = _mm_set1_epi8(0x0F), up = _mm_set1_epi8((char) 0xDF);
+		for(; i + 16 <= _len; i += 16)
+		{
+			const __m128i c = _mm_loadu_si128((const __m128i*) (_seq + i));
+			const __m128i u = _mm_and_si128(c, up);
+			__m128i valid = _mm_cmpeq_epi8(u, _mm_set1_epi8('A'));
+			valid = _mm_or_si128(valid, _mm_cmpeq_epi8(u, _mm_set1_epi8('C')));
+			valid = _mm_or_si128(valid, _mm_cmpeq_epi8(u, _mm_set1_epi8('G')));
+			valid = _mm_or_si128(valid, _mm_cmpeq_epi8(u, _mm_set1_epi8('T')));
+			valid = _mm_or_si128(valid, _mm_cmpeq_epi8(u, _mm_set1_epi8('U')));
+			const __m128i code = _mm_and_si128(_mm_shuffle_epi8(lut, _mm_and_si128(c, low)), valid);
+			_mm_storeu_si128((__m128i*) (codes + i), code);
+			setAmbiguity(m_size + i, ~((uint64_t) _mm_movemask_epi8(valid)) & 0xFFFFUL, 16);
+			setInvalid(_seq, i, ~((uint64_t) _mm_movemask_epi8(valid)) & 0xFFFFUL);
+		}
+#endif
+		for(; i < _len; i++)
+		{
+			const uint8_t v = m_table[_seq[i]];
+			codes[i] = v & 3;
+			setAmbiguity(m_size + i, v >> 2, 1);
+			if (v == 5)
+			{	m_invalid[(m_size + i) >> 6] |= ((uint64_t) 1) << ((m_size + i) & 63);	}
+		}
+		m_size += _len;
+	}
+
+	// 64-bit hash of the codes and of the ambiguous positions
+	uint64_t getHash() const
+	{
+		const uint8_t*	codes = &m_codes.front();
+		uint64_t	h = m_size, w = 0;
+		for(size_t i = 0; i < m_size; i += 32)
+		{
+			const size_t e = i + 32 < m_size ? i + 32: m_size;
+			w = 0;
+			for(size_t j = i; j < e; j++)
+			{	w = (w << 2) | codes[j];	}
+			h = mix(h ^ w ^ m_ambiguity[i >> 6] >> (i & 32));
+			if (m_invalid[i >> 6] != 0)
+			{	h = mix(h ^ m_invalid[i >> 6] >> (i & 32));	}
+		}
+		return h;
+	}
+
+	// Number of k-mers without ambiguous base
+	size_t countKmers(const size_t& _k) const
+	{
+		size_t nb = 0, run = 0;
+		for(size_t i = 0; i < m_size; i++)
+		{
+			run = isAmbiguous(i) ? 0: run + 1;
+			nb += run >= _k ? 1: 0;
+		}
+		return nb;
+	}
+
+	// Masks the bases whose quality symbol is lower than _minSymbol, among the first _length ones (the
+	// bases after a quality line shorter than the read are kept)
+	void maskQuality(const uint8_t* _qual, const size_t& _length, const uint8_t& _minSymbol)
+	{
+		const size_t n = _length < m_size ? _length: m_size;
+		for(size_t i = 0; i < n; i++)
+		{
+			if (_qual[i] < _minSymbol)
+			{	setAmbiguity(i, 1, 1);	}
+		}
+	}
+
+	// Masks the windows of _window bases whose DUST score (sum of c(c-1)/2 over the counts c of
+	// the triplets, divided by the number of triplets minus one) is higher than _threshold
+	void maskLowComplexity(const size_t& _window, const size_t& _threshold)
+	{
+		const size_t w = _window < m_size ? _window: m_size;
+		if (w < 4)
+		{	return;	}
+		const size_t 	l = w - 2;
+		const uint8_t*	codes = &m_codes.front();
+		uint16_t	counts[64];
+		size_t		score = 0, masked = 0, t = 0;
+		memset(counts, 0, sizeof(counts));
+		for(size_t i = 2; i < m_size; i++)
+		{
+			t = (codes[i-2] << 4) | (codes[i-1] << 2) | codes[i];
+			score += counts[t]++;
+			if (i >= w)
+			{
+				// Triplet leaving the window
+				t = (codes[i-l-2] << 4) | (codes[i-l-1] << 2) | codes[i-l];
+				score -= --counts[t];
+			}
+			if (i + 1 >= w && score > _threshold * (l - 1))
+			{
+				for(size_t p = masked > i + 1 - w ? masked: i + 1 - w; p <= i; p++)
+				{	setAmbiguity(p, 1, 1);	}
+				masked = i + 1;
+			}
+		}
+	}
+
+	private:
+	friend class sequenceFingerprint;
+
+	void reserve(const size_t& _size)
+	{
+		// Codes are written by blocks of 32 bytes
+		if (m_codes.size() < _size + 32)
+		{	m_codes.resize(2 * _size + 32);	}
+		const size_t words = (_size >> 6) + 2;
+		if (m_ambiguity.size() < words)
+		{
+			m_ambiguity.resize(2 * words, 0);
+			m_invalid.resize(2 * words, 0);
+		}
+		// Words not yet reached by the current sequence are reset
+		for(size_t w = (m_size + 63) >> 6; w < words; w++)
+		{
+			m_ambiguity[w] = 0;
+			m_invalid[w] = 0;
+		}
+	}
+
+	static uint64_t mix(uint64_t _h)
+	{
+		_h ^= _h >> 33;
+		_h *= 0xff51afd7ed558ccdULL;
+		_h ^= _h >> 33;
+		_h *= 0xc4ceb9fe1a85ec53ULL;
+		_h ^= _h >> 33;
+		return _h;
+	}
+
+	void setAmbiguity(const size_t& _i, const uint64_t& _bits, const size_t& _nb)
+	{
+		const size_t w = _i >> 6, o = _i & 63;
+		m_ambiguity[w] |= _bits << o;
+		if (o + _nb > 64)
+		{	m_ambiguity[w + 1] |= _bits >> (64 - o);	}
+	}
+
+	// Positions _i + p of _seq that are not IUPAC codes, p over the bits of _ambiguous
+	void setInvalid(const uint8_t* _seq, const size_t& _i, uint64_t _ambiguous)
+	{
+		for(; _ambiguous != 0; _ambiguous &= _ambiguous - 1)
+		{
+			const size_t p = _i + __builtin_ctzll(_ambiguous);
+			if (m_table[_seq[p]] == 5)
+			{	m_invalid[(m_size + p) >> 6] |= ((uint64_t) 1) << ((m_size + p) & 63);	}
+		}
+	}
+
+	uint8_t			m_table[256];
+	std::vector<uint8_t>	m_codes;
+	std::vector<uint64_t>	m_ambiguity;
+	std::vector<uint64_t>	m_invalid;	// Symbols neither a base nor an IUPAC code
+	size_t			m_size;
+};
+
+//	CLASS
+//	Name: kmerRoller
+//	Implementation notes: Rolling k-mer over the codes of readEncoder, updated by shifts only.
+//	getFwd() matches _km_f in CLARK (first base in the lowest bits), getRvs() matches _km_r
+//	(complement, first base in the highest bits), so no bit-reversal is needed when a run restarts.
+//	With K > 0, the k-mer length is a constant of the kernel (shifts and masks are folded);
+//	K = 0 uses the length given at run time.
+//
+template <size_t K>
+class kmerRoller
+{
+	public:
+	kmerRoller(const size_t& _k = K): m_k(K > 0 ? K : _k), m_shift((m_k - 1) << 1), m_mask(((uint64_t) -1) >> (64 - (m_k << 1)))
+	{	reset();	}
+
+	void reset()
+	{
+		m_kmF = 0;
+		m_kmR = 0;
+		m_length = 0;
+	}
+
+	// Returns true once k consecutive valid bases were pushed
+	bool push(const uint8_t& _code)
+	{
+		m_kmF = (m_kmF >> 2) | (((uint64_t) _code) << getShift());
+		m_kmR = ((m_kmR << 2) | (3 - _code)) & getMask();
+		return ++m_length >= getK();
+	}
+
+	// As push(), for the reverse k-mer only (getFwd() is then not maintained)
+	bool pushRvs(const uint8_t& _code)
+	{
+		m_kmR = ((m_kmR << 2) | (3 - _code)) & getMask();
+		return ++m_length >= getK();
+	}
+
+	// True for the first k-mer since the last reset
+	bool isFirst() const
+	{	return m_length == getK();	}
+
+	const uint64_t& getFwd() const
+	{	return m_kmF;	}
+
+	const uint64_t& getRvs() const
+	{	return m_kmR;	}
+
+	private:
+	size_t getK() const
+	{	return K > 0 ? K : m_k;	}
+
+	uint8_t getShift() const
+	{	return K > 0 ? (K - 1) << 1 : m_shift;	}
+
+	uint64_t getMask() const
+	{	return K > 0 ? ((uint64_t) -1) >> (64 - ((K > 0 ? K : 32) << 1)) : m_mask;	}
+
+	const size_t	m_k;
+	const uint8_t	m_shift;
+	const uint64_t	m_mask;
+	uint64_t	m_kmF;
+	uint64_t	m_kmR;
+	size_t		m_length;
+};
+
+//	CLASS
+//	Name: sequenceFingerprint
+//	Implementation notes: Streaming 64-bit hash of the sequences of a target over the codes of readEncoder,
+//	by words of 32 codes, with the ambiguous positions and the end of each record (fasta entry or fastq read).
+//	Independent of the line breaks and of the case: targets with the same fingerprint give the same k-mers.
+//	The sequences can also be tracked (one byte per base, see track()) to confirm that two targets of the
+//	same fingerprint are the same.
+//
+class sequenceFingerprint
+{
+	public:
+	sequenceFingerprint(): m_hash(0), m_word(0), m_ambiguity(0), m_size(0), m_record(0), m_sequence(NULL), m_compare(false), m_offset(0), m_same(true)
+	{}
+
+	// The codes of the sequences (4 added for an ambiguous base, 8 for the end of a record) stored in
+	// _sequence, or compared with _sequence when _compare (see same())
+	void track(std::vector<uint8_t>* _sequence, const bool& _compare = false)
+	{
+		m_sequence = _sequence;
+		m_compare = _compare;
+		m_offset = 0;
+		m_same = true;
+	}
+
+	// True if the sequences are those of the tracked sequence compared
+	bool same() const
+	{	return m_same && m_sequence != NULL && m_offset == m_sequence->size();	}
+
+	void append(const readEncoder& _encoder)
+	{
+		const uint8_t* codes = _encoder.getCodes();
+		for(size_t i = 0; i < _encoder.size(); i++)
+		{
+			m_word = (m_word << 2) | codes[i];
+			m_ambiguity = (m_ambiguity << 1) | (_encoder.isAmbiguous(i) ? 1: 0);
+			if (m_sequence != NULL)
+			{	put(codes[i] | (_encoder.isAmbiguous(i) ? 4: 0));	}
+			if ((++m_record & 31) == 0)
+			{	flush();	}
+		}
+	}
+
+	void endRecord()
+	{
+		if (m_record == 0)
+		{	return;	}
+		if (m_sequence != NULL)
+		{	put(8);	}
+		flush();
+		m_hash = readEncoder::mix(m_hash ^ m_record ^ 0x9e3779b97f4a7c15ULL);
+		m_size += m_record;
+		m_record = 0;
+	}
+
+	uint64_t getHash() const
+	{	return m_hash;	}
+
+	// Number of bases of the records ended
+	uint64_t size() const
+	{	return m_size;	}
+
+	private:
+	void put(const uint8_t& _byte)
+	{
+		if (!m_compare)
+		{
+			m_sequence->push_back(_byte);
+			return;
+		}
+		m_same = m_same && m_offset < m_sequence->size() && (*m_sequence)[m_offset] == _byte;
+		m_offset++;
+	}
+
+	void flush()
+	{
+		m_hash = readEncoder::mix(m_hash ^ m_word);
+		if (m_ambiguity != 0)
+		{	m_hash = readEncoder::mix(m_hash ^ m_ambiguity ^ m_record);	}
+		m_word = 0;
+		m_ambiguity = 0;
+	}
+
+	uint64_t	m_hash;
+	uint64_t	m_word;
+	uint64_t	m_ambiguity;
+	uint64_t	m_size;
+	uint64_t	m_record;
+	std::vector<uint8_t>*	m_sequence;	// Tracked sequences (NULL if none)
+	bool		m_compare;
+	size_t		m_offset;
+	bool		m_same;
+};
+
+#endif
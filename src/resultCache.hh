@@ -0,0 +1,204 @@
+/*
+ * CLARK, CLAssifier based on Reduced K-mers.
+ */
+
+/*
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+   Copyright 2013-2017, Rachid Ounit <clark.ucr.help at gmail.com>
+*/
+
+/*
+ * @author: Rachid Ounit, Ph.D Candidate.
+ * @project: CLARK, Metagenomic and Genomic Sequences Classification project.
+ * @note: C++ IMPLEMENTATION supported on latest Linux and Mac OS.
+ *
+ */
+
+#ifndef RESULTCACHE_HH
+#define RESULTCACHE_HH
+
+#include <vector>
+#include <stdint.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#include "./dataType.hh"
+
+#define NBCACHED	5	// Values stored per object (as m_ResultsCentral in full mode)
+#define CACHEPROBES	4	// Slots checked per lookup before evicting
+#define CACHESHARD	1024	// Slots per shard (one lock per shard)
+
+//	CLASS
+//	Name: resultCache
+//	Implementation notes: Results of objects already scored, keyed by the hash of the encoded object
+//	(readEncoder::getHash) and its length. Shared by the threads: the slots are split into shards of
+//	CACHESHARD slots, each one with its own lock, and a key only probes slots of its shard. Open addressing
+//	over a fixed number of slots: when the CACHEPROBES slots of a key are taken, the first one is replaced.
+//
+class resultCache
+{
+	public:
+	resultCache(): m_mask(0)
+	{}
+	~resultCache()
+	{	release();	}
+
+	// Allocates the largest power of two of slots fitting in _bytes (no cache if too small)
+	void init(const size_t& _bytes)
+	{
+		release();
+		size_t nb = 0;
+		while (((size_t) 2 << nb) * sizeof(Entry) <= _bytes)
+		{	nb++;	}
+		if (_bytes < sizeof(Entry) * CACHESHARD)
+		{	return;	}
+		m_entries.resize((size_t) 1 << nb);
+		m_mask = m_entries.size() / CACHESHARD - 1;
+		m_hits.resize(m_mask + 1, 0);
+		m_lookups.resize(m_mask + 1, 0);
+#ifdef _OPENMP
+		m_locks.resize(m_mask + 1);
+		for(size_t t = 0; t < m_locks.size(); t++)
+		{	omp_init_lock(&m_locks[t]);	}
+#endif
+		reset();
+	}
+
+	void reset()
+	{
+		for(size_t t = 0; t < m_entries.size(); t++)
+		{	m_entries[t].length = 0;	}
+		for(size_t t = 0; t < m_hits.size(); t++)
+		{
+			m_hits[t] = 0;
+			m_lookups[t] = 0;
+		}
+	}
+
+	bool isEnabled() const
+	{	return !m_entries.empty();	}
+
+	bool find(const uint64_t& _key, const uint32_t& _length, ITYPE* _values)
+	{
+		const size_t shard = (_key >> 32) & m_mask;
+		bool found = false;
+		lock(shard);
+		m_lookups[shard]++;
+		for(size_t p = 0; p < CACHEPROBES; p++)
+		{
+			const Entry& e = m_entries[getSlot(shard, _key + p)];
+			if (e.length == 0)
+			{	break;	}
+			if (e.key == _key && e.length == _length)
+			{
+				for(size_t t = 0; t < NBCACHED; t++)
+				{	_values[t] = e.values[t];	}
+				m_hits[shard]++;
+				found = true;
+				break;
+			}
+		}
+		unlock(shard);
+		return found;
+	}
+
+	void insert(const uint64_t& _key, const uint32_t& _length, const ITYPE* _values)
+	{
+		const size_t shard = (_key >> 32) & m_mask;
+		size_t slot = getSlot(shard, _key);
+		lock(shard);
+		for(size_t p = 0; p < CACHEPROBES; p++)
+		{
+			if (m_entries[getSlot(shard, _key + p)].length == 0)
+			{
+				slot = getSlot(shard, _key + p);
+				break;
+			}
+		}
+		Entry& e = m_entries[slot];
+		e.key 	 = _key;
+		e.length = _length;
+		for(size_t t = 0; t < NBCACHED; t++)
+		{	e.values[t] = _values[t];	}
+		unlock(shard);
+	}
+
+	uint64_t getHits() const
+	{
+		uint64_t nb = 0;
+		for(size_t t = 0; t < m_hits.size(); t++)
+		{	nb += m_hits[t];	}
+		return nb;
+	}
+
+	uint64_t getLookups() const
+	{
+		uint64_t nb = 0;
+		for(size_t t = 0; t < m_lookups.size(); t++)
+		{	nb += m_lookups[t];	}
+		return nb;
+	}
+
+	private:
+	struct Entry
+	{
+		uint64_t	key;
+		uint32_t	length;	// 0 for an empty slot
+		ITYPE		values[NBCACHED];
+	};
+
+	resultCache(const resultCache&);
+	resultCache& operator=(const resultCache&);
+
+	size_t getSlot(const size_t& _shard, const uint64_t& _key) const
+	{	return _shard * CACHESHARD + (_key & (CACHESHARD - 1));	}
+
+	void lock(const size_t& _shard)
+	{
+#ifdef _OPENMP
+		omp_set_lock(&m_locks[_shard]);
+#endif
+	}
+
+	void unlock(const size_t& _shard)
+	{
+#ifdef _OPENMP
+		omp_unset_lock(&m_locks[_shard]);
+#endif
+	}
+
+	void release()
+	{
+#ifdef _OPENMP
+		for(size_t t = 0; t < m_locks.size(); t++)
+		{	omp_destroy_lock(&m_locks[t]);	}
+		m_locks.clear();
+#endif
+		m_entries.clear();
+		m_hits.clear();
+		m_lookups.clear();
+		m_mask = 0;
+	}
+
+	std::vector<Entry>	m_entries;
+	size_t			m_mask;		// Number of shards minus one
+	std::vector<uint64_t>	m_hits;		// Per shard
+	std::vector<uint64_t>	m_lookups;	// Per shard
+#ifdef _OPENMP
+	std::vector<omp_lock_t>	m_locks;
+#endif
+};
+
+#endif
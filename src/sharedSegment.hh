@@ -0,0 +1,304 @@
+/*
+ * CLARK, CLAssifier based on Reduced K-mers.
+ */
+
+/*
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+   Copyright 2013-2017, Rachid Ounit <clark.ucr.help at gmail.com>
+*/
+
+/*
+ * @author: Rachid Ounit, Ph.D Candidate.
+ * @project: CLARK, Metagenomic and Genomic Sequences Classification project.
+ * @note: C++ IMPLEMENTATION supported on latest Linux and Mac OS.
+ *
+ */
+
+#ifndef SHAREDSEGMENT_HH
+#define SHAREDSEGMENT_HH
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <cerrno>
+#include <iostream>
+#include <stdint.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define SHMMAGIC	0x4b52414c43ULL		// "CLARK"
+#define SHMVERSION	1			// Layout of the segment
+#define SHMHEADER	4096			// Bytes before the data
+#define SHMPREFIX	"clark_"
+#define SHMADDRESS	0x500000000000ULL	// Address hint of the mapping
+
+//	CLASS
+//	Name: sharedSegment
+//	Implementation notes: Named POSIX shared memory segment holding a loaded database, so that other
+//	processes attach it instead of loading their own copy. The data holds absolute pointers (the bucket
+//	headers), so every process maps the segment at the address chosen by the process that created it,
+//	which is recorded in the header; a process unable to map it there loads the database itself.
+//	The header also holds a stamp of the database files (version check), a reference count of the
+//	attached processes, the pid of the creator while the data is written, and the database path (evict).
+//	Segments stay in memory when no process is attached, until evict() (or a reboot). Segments still
+//	attached at exit() are detached by an atexit handler, to keep the reference count right.
+//
+class sharedSegment
+{
+	public:
+	sharedSegment(): m_header(NULL), m_base(NULL), m_size(0)
+	{}
+	~sharedSegment()
+	{	detach();	}
+
+	// Name of the segment of a database (path of its files, with the settings changing its content)
+	static std::string getName(const std::string& _path, const size_t& _settings)
+	{
+		uint64_t h = 1469598103934665603ULL;
+		for(size_t t = 0; t < _path.size(); t++)
+		{	h = (h ^ (uint8_t) _path[t]) * 1099511628211ULL;	}
+		h = (h ^ _settings) * 1099511628211ULL;
+		char name[64];
+		sprintf(name, "/%s%016llx", SHMPREFIX, (unsigned long long) h);
+		return name;
+	}
+
+	// Size, date and inode of a file of the database, combined into _stamp
+	static void addStamp(const char* _file, uint64_t& _stamp)
+	{
+		struct stat st;
+		if (stat(_file, &st) == 0)
+		{	_stamp = (_stamp ^ (uint64_t) st.st_size ^ ((uint64_t) st.st_mtime << 20) ^ ((uint64_t) st.st_ino << 40)) * 1099511628211ULL;	}
+	}
+
+	// Returns true if the segment _name, complete and of the same stamp, is now mapped read-only.
+	// A stale segment, or one left incomplete by a process that died, is removed.
+	bool attach(const std::string& _name, const uint64_t& _stamp)
+	{
+		while (true)
+		{
+			const int fd = shm_open(_name.c_str(), O_RDWR, 0);
+			if (fd == -1)
+			{	return false;	}
+			Header* header = mapHeader(fd);
+			if (header == NULL)
+			{
+				close(fd);
+				return false;
+			}
+			if (header->magic != SHMMAGIC || header->version != SHMVERSION || header->stamp != _stamp
+				|| (!header->ready && kill(header->pid, 0) != 0 && errno == ESRCH))
+			{
+				std::cerr << "Removing the shared database " << _name << " (outdated or incomplete)." << std::endl;
+				munmap(header, SHMHEADER);
+				close(fd);
+				shm_unlink(_name.c_str());
+				return false;
+			}
+			if (!header->ready)
+			{
+				// Being written by another process
+				munmap(header, SHMHEADER);
+				close(fd);
+				sleep(1);
+				continue;
+			}
+			void* p = mmap((void*) header->base, header->size, PROT_READ, MAP_SHARED | getFixed(), fd, 0);
+			close(fd);
+			if (p != (void*) header->base)
+			{
+				if (p != MAP_FAILED)
+				{	munmap(p, header->size);	}
+				std::cerr << "Failed to map the shared database at its address: loading it." << std::endl;
+				munmap(header, SHMHEADER);
+				return false;
+			}
+			m_header = header;
+			m_base 	 = (uint8_t*) p;
+			m_size 	 = header->size;
+			__sync_fetch_and_add(&m_header->refs, 1);
+			registerSegment();
+			return true;
+		}
+	}
+
+	// Creates the segment _name with _bytes of data (writable until publish()). False if it exists.
+	bool create(const std::string& _name, const size_t& _bytes, const uint64_t& _stamp, const std::string& _path)
+	{
+		const int fd = shm_open(_name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0644);
+		if (fd == -1)
+		{	return false;	}
+		const size_t size = SHMHEADER + _bytes;
+		void* p = MAP_FAILED;
+		if (ftruncate(fd, size) == 0)
+		{	p = mmap((void*) SHMADDRESS, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);	}
+		Header* header = p == MAP_FAILED ? NULL: mapHeader(fd);
+		close(fd);
+		if (header == NULL)
+		{
+			if (p != MAP_FAILED)
+			{	munmap(p, size);	}
+			shm_unlink(_name.c_str());
+			return false;
+		}
+		header->magic 	= SHMMAGIC;
+		header->version = SHMVERSION;
+		header->ready 	= 0;
+		header->pid 	= getpid();
+		header->stamp 	= _stamp;
+		header->base 	= (uint64_t) p;
+		header->size 	= size;
+		header->refs 	= 1;
+		strncpy(header->path, _path.c_str(), sizeof(header->path) - 1);
+		m_header = header;
+		m_base 	 = (uint8_t*) p;
+		m_size 	 = size;
+		registerSegment();
+		return true;
+	}
+
+	// Data complete: other processes may attach
+	void publish()
+	{
+		__sync_synchronize();
+		m_header->ready = 1;
+		mprotect(m_base, m_size, PROT_READ);
+	}
+
+	void detach()
+	{
+		if (m_header != NULL)
+		{
+			__sync_fetch_and_sub(&m_header->refs, 1);
+			munmap(m_header, SHMHEADER);
+			munmap(m_base, m_size);
+			std::vector<sharedSegment*>& segments = getSegments();
+			segments.erase(std::remove(segments.begin(), segments.end(), this), segments.end());
+		}
+		m_header = NULL;
+		m_base 	 = NULL;
+		m_size 	 = 0;
+	}
+
+	bool isAttached() const
+	{	return m_base != NULL;	}
+
+	uint8_t* data() const
+	{	return m_base + SHMHEADER;	}
+
+	size_t size() const
+	{	return m_size;	}
+
+	int64_t getRefs() const
+	{	return m_header->refs;	}
+
+	// Removes the segments of the databases in _folder (processes attached keep their mapping)
+	static size_t evict(const std::string& _folder)
+	{
+		size_t nb = 0;
+		DIR* dir = opendir("/dev/shm");
+		if (dir == NULL)
+		{	return 0;	}
+		struct dirent* e;
+		while ((e = readdir(dir)) != NULL)
+		{
+			if (strncmp(e->d_name, SHMPREFIX, strlen(SHMPREFIX)) != 0)
+			{	continue;	}
+			const std::string name = std::string("/") + e->d_name;
+			const int fd = shm_open(name.c_str(), O_RDONLY, 0);
+			if (fd == -1)
+			{	continue;	}
+			Header header;
+			const bool valid = pread(fd, &header, sizeof(header), 0) == sizeof(header) && header.magic == SHMMAGIC;
+			close(fd);
+			if (valid && strncmp(header.path, _folder.c_str(), _folder.size()) == 0 && shm_unlink(name.c_str()) == 0)
+			{
+				std::cerr << "Shared database " << header.path << " evicted (" << header.size / 1000000 << " MB, ";
+				std::cerr << header.refs << " process(es) attached)." << std::endl;
+				nb++;
+			}
+		}
+		closedir(dir);
+		return nb;
+	}
+
+	private:
+	struct Header
+	{
+		uint64_t	magic;
+		uint32_t	version;
+		volatile uint32_t ready;	// 1 once the data is complete
+		int64_t		pid;		// Creator
+		uint64_t	stamp;		// Database files
+		uint64_t	base;		// Address of the mapping
+		uint64_t	size;		// Bytes, header included
+		int64_t		refs;		// Processes attached
+		char		path[1024];	// Database
+	};
+
+	sharedSegment(const sharedSegment&);
+	sharedSegment& operator=(const sharedSegment&);
+
+	// Writable mapping of the header only (the data may be read-only)
+	static Header* mapHeader(const int& _fd)
+	{
+		void* p = mmap(0, SHMHEADER, PROT_READ | PROT_WRITE, MAP_SHARED, _fd, 0);
+		return p == MAP_FAILED ? NULL: (Header*) p;
+	}
+
+	static std::vector<sharedSegment*>& getSegments()
+	{
+		static std::vector<sharedSegment*> segments;
+		return segments;
+	}
+
+	static void detachAll()
+	{
+		while (!getSegments().empty())
+		{	getSegments().back()->detach();	}
+	}
+
+	void registerSegment()
+	{
+		// The list is built before the handler is registered, so destroyed after it runs
+		std::vector<sharedSegment*>& segments = getSegments();
+		static bool registered = false;
+		if (!registered)
+		{	registered = atexit(detachAll) == 0;	}
+		segments.push_back(this);
+	}
+
+	static int getFixed()
+	{
+#ifdef MAP_FIXED_NOREPLACE
+		return MAP_FIXED_NOREPLACE;
+#else
+		return 0;
+#endif
+	}
+
+	Header*		m_header;
+	uint8_t*	m_base;
+	size_t		m_size;
+};
+
+#endif
@@ -34,6 +34,7 @@
 #include <vector>
 #include <cstring>
 #include <stdint.h>
+#include "./kmersConversion.hh"
 
 class spacedKmer
 {
@@ -43,10 +44,12 @@ class spacedKmer
 	size_t		m_weight;
 	size_t		m_length;
 	bool 		m_mask[32];
-	int		m_table[256];
+	uint32_t	m_careF;
+	uint32_t	m_careR;
+	seedExtractor	m_extractor;
 	
 	public:
-	spacedKmer():  m_weight(22), m_length(31), m_name("T59575"), m_folder("T59575")
+	spacedKmer():  m_name("T59575"), m_folder("T59575"), m_weight(22), m_length(31)
 	{
 		init();
 		m_mask[1] = false;
@@ -58,14 +61,34 @@ class spacedKmer
                 m_mask[7] = false;
 		m_mask[8] = false;
 		m_mask[16] = false;
+		setCare();
 		//print();
 	}
+	// _name is either a predefined setting (T295, T38570, T58570) or the mask itself (e.g., 1111*111*...).
+	// A mask of a predefined setting takes its name (same database files).
 	spacedKmer(const std::string& _name): m_name(_name), m_folder(_name)
 	{
-		string _mask;
-		if (_name =="T295")     {_mask="1111*111*111**1*111**1*11*11111"; 	}
-		if (_name =="T38570")   {_mask="11111*1*111**1*11*111**11*11111";       }
-		if (_name =="T58570")   {_mask="11111*1**111*1*11*11**111*11111";       }
+		string _mask = getMask(_name);
+		if (_mask.empty())
+		{
+			if (!isSeedMask(_name))
+			{
+				cerr << "Failed to find the mask for the spaced seed requested: " << _name << endl;
+				exit(1);
+			}
+			_mask = _name;
+			string stars(_mask);
+			for(size_t t = 0; t < _mask.size(); t++)
+			{	m_name[t] = _mask[t] == '1' ? '1': '0';
+				stars[t] = _mask[t] == '1' ? '1': '*';	}
+			const char* names[3] = {"T295", "T38570", "T58570"};
+			for(size_t t = 0; t < 3; t++)
+			{
+				if (getMask(names[t]) == stars)
+				{	m_name = names[t];	}
+			}
+			m_folder = m_name;
+		}
 
 		init();
 		m_weight = _mask.size();
@@ -76,6 +99,7 @@ class spacedKmer
                         {       m_weight--;
                                 m_mask[t] = false;      }
                 }
+		setCare();
                 //print();
 	}
 
@@ -90,9 +114,25 @@ class spacedKmer
 			{	m_weight--;
 				m_mask[t] = false;	}
 		}
+		setCare();
 		//print();
 	}
 	~spacedKmer(){}
+
+	// Mask of a predefined setting (empty if _name is not one), masks of '1' and '*'
+	static std::string getMask(const std::string& _name)
+	{
+		std::string mask;
+		if (_name =="T295")     {mask="1111*111*111**1*111**1*11*11111"; 	}
+		if (_name =="T38570")   {mask="11111*1*111**1*11*111**11*11111";       }
+		if (_name =="T58570")   {mask="11111*1**111*1*11*11**111*11111";       }
+		return mask;
+	}
+
+	// Name of a predefined setting or mask
+	static bool isSeed(const std::string& _name)
+	{	return !getMask(_name).empty() || isSeedMask(_name);	}
+
 	std::string getFolder() const 
 	{	return m_folder;}
 
@@ -105,105 +145,35 @@ class spacedKmer
 	size_t getLength() const
         {       return m_length;}
 
-	bool isFwdValid(const uint8_t* _map, const size_t& _i, const size_t& _max, uint64_t& _kmf) const
+	// Positions (bit 0 = last base of the window) where an ambiguous base invalidates the seed
+	uint32_t getCareFwd() const
+	{	return m_careF;	}
+
+	uint32_t getCareRvs() const
+	{	return m_careR;	}
+
+	void getSpaced(const uint64_t& _km, uint64_t& _skm) const
+	{	m_extractor.extract(_km, _skm);	}
+
+	private:
+	void setCare()
 	{
-		if (_max - _i < m_length)
-                {
-		        return false;
-		}
-		size_t c = 0, i_c = _i;
-		_kmf = 0;
-		while (true)
+		string mask(m_length, '*');
+		m_careF = 0;
+		m_careR = 0;
+		for(size_t t = 0; t < m_length; t++)
 		{
-			if (c == m_length)
-			{	return true;	}
-			if (i_c == _max && c < m_length)
-                        {	return false;	}
-			if (m_table[_map[i_c]] == -10)
-			{	i_c++;
-				continue;
-			}
-			if (m_table[_map[i_c]] < 0)
-                        {       
-                                return false;
-                        }
-			if (m_table[_map[i_c]] != 4)
+			if (m_mask[t])
 			{
-				_kmf <<= 2;
-				_kmf ^= (m_table[_map[i_c]]);
-				i_c++;
-				c++;
-				continue;
+				mask[t] = '1';
+				m_careF |= 1UL << (m_length - 1 - t);
+				m_careR |= 1UL << t;
 			}
-			if (!m_mask[c])
-			{
-				_kmf <<= 2;
-                                _kmf ^= 0;
-				c++;
-				i_c++;	
-				continue;
-			}
-			return false;	
-		}
-	}
-	bool isRvsValid(const uint8_t* _map, const size_t& _i, const size_t& _max, uint64_t& _kmr) const
-	{
-		if (_max - _i < m_length)
-                {
-		        return false;
 		}
-                size_t c = 0, i_c = _i;
-                _kmr = 0;
-		while (true)
-                {
-                        if (c == m_length)
-                        {       return true;    }       
-                        if (i_c == _max && c < m_length)
-                        {       return false;   }
-                        if (m_table[_map[i_c]] == -10)
-                        {       i_c++;
-                                continue;
-                        }
-                        if (m_table[_map[i_c]] < 0)
-                        {
-                                return false;
-                        }
-                        if (m_table[_map[i_c]] != 4)
-                        {
-                                _kmr <<= 2;
-                                _kmr ^= (m_table[_map[i_c]]);
-                                i_c++;
-                                c++;
-                                continue;
-                        }
-                        if (!m_mask[m_length - 1 - c])
-                        {       
-                                _kmr <<= 2;
-                                _kmr ^= 0;
-                                c++;
-                                i_c++; 
-                                continue;
-                        }
-                        return false;
-                }
+		m_extractor.compile(mask);
 	}
-	private:
 	void init()
 	{
-		for(size_t u = 0; u < 256; u++)
-                {       
-                        m_table[u] = -1;
-                }
-                m_table['A']  = 3; m_table['C'] = 2; m_table['G'] = 1; m_table['T'] = 0; m_table['U'] = 0;
-                m_table['a']  = 3; m_table['c'] = 2; m_table['g'] = 1; m_table['t'] = 0; m_table['u'] = 0;
-                m_table['\n'] = -10;
-                m_table['n']  = 4; m_table['N'] = 4;
-
-		m_table['M']  = 4; m_table['R'] = 4; m_table['W'] = 4; m_table['V'] = 4; m_table['D'] = 4;
-                m_table['K']  = 4; m_table['Y'] = 4; m_table['S'] = 4; m_table['H'] = 4; m_table['B'] = 4;
-                m_table['m']  = 4; m_table['r'] = 4; m_table['w'] = 4; m_table['v'] = 4; m_table['d'] = 4;
-                m_table['k']  = 4; m_table['y'] = 4; m_table['s'] = 4; m_table['h'] = 4; m_table['b'] = 4;
-
 		for(size_t t = 0; t < 32 ; t++)
 		{
 			m_mask[t] = true;
@@ -0,0 +1,87 @@
+/*
+ * CLARK, CLAssifier based on Reduced K-mers.
+ */
+
+/*
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+   Copyright 2013-2017, Rachid Ounit <clark.ucr.help at gmail.com>
+*/
+
+/*
+ * @author: Rachid Ounit, Ph.D Candidate.
+ * @project: CLARK, Metagenomic and Genomic Sequences Classification project.
+ * @note: C++ IMPLEMENTATION supported on latest Linux and Mac OS.
+ *
+ */
+
+#ifndef SYNCMERFILTER_HH
+#define SYNCMERFILTER_HH
+
+#include <stdint.h>
+
+//	CLASS
+//	Name: syncmerFilter
+//	Implementation notes: Open syncmers: a k-mer is kept when the smallest of its s-mers (by hash) starts at
+//	the offset (k - s) / 2, which keeps about one k-mer out of k - s + 1. The test is made on the smallest of
+//	the two values given by kmerRoller (getFwd() of a k-mer is getRvs() of its reverse complement), so it does
+//	not depend on the strand and the k-mers of the database and of the objects are selected the same way.
+//	s = 0 keeps all k-mers.
+//
+class syncmerFilter
+{
+	public:
+	syncmerFilter(const size_t& _k = 0, const size_t& _s = 0): m_k(_k), m_s(_s), m_offset(_s > 0 && _s < _k ? (_k - _s) / 2: 0),
+		m_mask(_s > 0 && _s < 32 ? (((uint64_t) 1) << (_s << 1)) - 1: (uint64_t) -1)
+	{}
+
+	bool isEnabled() const
+	{	return m_s > 0;	}
+
+	size_t getS() const
+	{	return m_s;	}
+
+	bool isSelected(const uint64_t& _kmF, const uint64_t& _kmR) const
+	{
+		const uint64_t 	c = _kmF < _kmR ? _kmF: _kmR;
+		uint64_t	best = (uint64_t) -1, h = 0;
+		size_t		pos = 0;
+		for(size_t p = 0; p + m_s <= m_k; p++)
+		{
+			h = mix((c >> (p << 1)) & m_mask);
+			if (h < best)
+			{
+				best = h;
+				pos = p;
+			}
+		}
+		return pos == m_offset;
+	}
+
+	private:
+	static uint64_t mix(uint64_t _h)
+	{
+		_h ^= _h >> 33;
+		_h *= 0xff51afd7ed558ccdULL;
+		_h ^= _h >> 33;
+		return _h;
+	}
+
+	size_t		m_k;
+	size_t		m_s;
+	size_t		m_offset;
+	uint64_t	m_mask;
+};
+
+#endif